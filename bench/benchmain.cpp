@@ -0,0 +1,39 @@
+/*******************************************************************************
+ * File:			  benchmain.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "benchmarks.hpp"
+
+#include <QCoreApplication>
+
+#include <iostream>
+
+
+int main(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
+	QString name = (argc > 1) ? QString(argv[1]) : "all";
+	bool known = false;
+	bool passed = true;
+	if (name == "dct" || name == "all") {
+		known = true;
+		passed = benchmarkDCTFeatures() && passed;
+	}
+	if (name == "mjpeg" || name == "all") {
+		known = true;
+		passed = benchmarkMjpegPassthrough() && passed;
+	}
+	if (name == "projection" || name == "all") {
+		known = true;
+		passed = benchmarkFeatureProjection() && passed;
+	}
+	if (!known) {
+		std::cout << "Usage: datasetcreatorbench [dct|mjpeg|projection|all]" << std::endl;
+		return 2;
+	}
+	return passed ? 0 : 1;
+}
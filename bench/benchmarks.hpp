@@ -0,0 +1,25 @@
+/*******************************************************************************
+ * File:			  benchmarks.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+//Every benchmark prints its timings and returns false if the optimized path
+//does not match its reference
+bool benchmarkDCTFeatures(int iterations = 200);
+
+//Also checks that AviIndex finds every JPEG of hand written idx1 and OpenDML
+//files and that the passthrough copies them byte for byte
+bool benchmarkMjpegPassthrough(int numFrames = 200);
+
+//Only reports, projected clustering is approximate by design
+bool benchmarkFeatureProjection(int numSamples = 20000, int numCameras = 12,
+			int numClusters = 10);
+
+#endif
@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * File:			  dctfeaturebench.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "benchmarks.hpp"
+#include "dctfeatureextractor.hpp"
+
+#include <chrono>
+#include <iostream>
+using namespace std::chrono;
+
+static const double Tolerance = 1e-3;
+
+
+static bool checkFrame(DCTFeatureExtractor &extractor, const cv::Mat &frame,
+			const std::string &name) {
+	double maxDiff = cv::norm(extractor.compute(frame),
+				DCTFeatureExtractor::computeReference(frame), cv::NORM_INF);
+	bool passed = maxDiff <= Tolerance;
+	std::cout << "DCT features " << name << " " << frame.cols << "x" << frame.rows
+						<< ": max abs diff " << maxDiff << (passed ? "" : " FAILED")
+						<< std::endl;
+	return passed;
+}
+
+
+bool benchmarkDCTFeatures(int iterations) {
+	//Smoothed noise, so the low frequencies carry more than the mean
+	cv::RNG rng(0x4a415256);
+	cv::Mat frame(1024, 1280, CV_8UC3);
+	rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+	cv::GaussianBlur(frame, frame, cv::Size(0, 0), 8);
+
+	DCTFeatureExtractor extractor;
+	cv::Mat reference, fused;
+	auto start = high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		reference = DCTFeatureExtractor::computeReference(frame);
+	}
+	auto referenceDone = high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		fused = extractor.compute(frame);
+	}
+	auto fusedDone = high_resolution_clock::now();
+	double referenceTime = duration_cast<microseconds>(
+				referenceDone-start).count() / static_cast<double>(iterations);
+	double fusedTime = duration_cast<microseconds>(
+				fusedDone-referenceDone).count() / static_cast<double>(iterations);
+	std::cout << "DCT features " << frame.cols << "x" << frame.rows
+						<< " reference: " << referenceTime << " us/frame, fused: "
+						<< fusedTime << " us/frame" << std::endl;
+
+	//The fused path only handles BGR, everything else goes through the
+	//reference, both have to give the same features
+	bool passed = checkFrame(extractor, frame, "BGR");
+	cv::Mat odd;
+	cv::resize(frame, odd, cv::Size(641, 479));
+	passed = checkFrame(extractor, odd, "BGR odd size") && passed;
+	passed = checkFrame(extractor, frame(cv::Rect(13, 7, 800, 600)),
+				"BGR ROI") && passed;
+	cv::Mat small;
+	cv::resize(frame, small, cv::Size(120, 96));
+	passed = checkFrame(extractor, small, "BGR upscaled") && passed;
+	cv::Mat bgra, gray;
+	cv::cvtColor(frame, bgra, cv::COLOR_BGR2BGRA);
+	passed = checkFrame(extractor, bgra, "BGRA") && passed;
+	cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+	passed = checkFrame(extractor, gray, "gray") && passed;
+	return passed;
+}
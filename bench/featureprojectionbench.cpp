@@ -0,0 +1,88 @@
+/*******************************************************************************
+ * File:			  featureprojectionbench.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "benchmarks.hpp"
+#include "featureprojection.hpp"
+#include "featureclustering.hpp"
+#include "dctfeatureextractor.hpp"
+
+#include <QSet>
+
+#include <chrono>
+#include <iostream>
+using namespace std::chrono;
+
+
+bool benchmarkFeatureProjection(int numSamples, int numCameras,
+			int numClusters) {
+	//Postures live on a low dimensional manifold, every camera sees a different
+	//linear view of it plus sensor noise
+	const int numLatent = 24;
+	const int numDims = numCameras * DCTFeatureExtractor::FeatureWidth *
+				DCTFeatureExtractor::FeatureHeight;
+	cv::RNG rng(0x4a415256);
+	cv::Mat latent(numSamples, numLatent, CV_32FC1);
+	rng.fill(latent, cv::RNG::NORMAL, 0.0, 1.0);
+	for (int j = 0; j < numLatent; j++) {
+		latent.col(j) *= 4.0 / (1 + j);
+	}
+	cv::Mat views(numLatent, numDims, CV_32FC1);
+	rng.fill(views, cv::RNG::NORMAL, 0.0, 1.0);
+	cv::Mat noise(numSamples, numDims, CV_32FC1);
+	rng.fill(noise, cv::RNG::NORMAL, 0.0, 0.5);
+	cv::Mat features = latent*views + noise;
+	noise.release();
+
+	auto start = high_resolution_clock::now();
+	FeatureClustering fullClustering(numClusters);
+	QList<int> fullRows = fullClustering.representativeRows(features);
+	auto fullDone = high_resolution_clock::now();
+	FeatureProjection projection(64);
+	projection.fit(features);
+	cv::Mat reduced = projection.project(features);
+	auto fitDone = high_resolution_clock::now();
+	FeatureClustering reducedClustering(numClusters);
+	QList<int> reducedRows = reducedClustering.representativeRows(reduced);
+	auto reducedDone = high_resolution_clock::now();
+
+	//Selections are compared by how well they cover the full feature space and
+	//by how many frames both paths pick
+	cv::Mat norms;
+	FeatureClustering::squaredNorms(features, norms);
+	auto selectionCost = [&](const QList<int> &rows) {
+		cv::Mat selected;
+		for (const auto &row : rows) {
+			selected.push_back(features.row(row));
+		}
+		std::vector<int> labels;
+		return FeatureClustering::assign(features, norms, selected, labels) /
+					features.rows;
+	};
+	QSet<int> fullSet(fullRows.begin(), fullRows.end());
+	int overlap = 0;
+	for (const auto &row : reducedRows) {
+		if (fullSet.contains(row)) {
+			overlap++;
+		}
+	}
+	std::cout << "Feature projection " << numSamples << "x" << numDims << " -> "
+						<< reduced.cols << " dims, explained variance: "
+						<< projection.explainedVariance() << std::endl;
+	std::cout << "full clustering: "
+						<< duration_cast<milliseconds>(fullDone-start).count() << " ms, "
+						<< "fit + project: "
+						<< duration_cast<milliseconds>(fitDone-fullDone).count() << " ms, "
+						<< "reduced clustering: "
+						<< duration_cast<milliseconds>(reducedDone-fitDone).count()
+						<< " ms" << std::endl;
+	std::cout << "selection cost full: " << selectionCost(fullRows)
+						<< ", reduced: " << selectionCost(reducedRows) << ", overlap: "
+						<< overlap << "/" << fullRows.size() << " frames" << std::endl;
+	return true;
+}
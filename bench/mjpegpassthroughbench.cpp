@@ -0,0 +1,310 @@
+/*******************************************************************************
+ * File:			  mjpegpassthroughbench.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "benchmarks.hpp"
+#include "mjpegpassthrough.hpp"
+#include "aviindex.hpp"
+
+#include "opencv2/videoio/videoio.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+using namespace std::chrono;
+
+
+static cv::Mat syntheticFrame(cv::RNG &rng, const cv::Size &frameSize,
+			int index) {
+	//Some texture, so frames are not trivially small
+	cv::Mat noise(frameSize, CV_8UC3);
+	rng.fill(noise, cv::RNG::UNIFORM, 0, 64);
+	cv::Mat frame(frameSize, CV_8UC3, cv::Scalar(40, 80, 120));
+	cv::circle(frame, cv::Point(100 + 5*index % (frameSize.width - 200),
+				frameSize.height / 2), 80, cv::Scalar(255, 255, 255), -1);
+	return frame + noise;
+}
+
+
+static void appendLe(QByteArray &data, quint64 value, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		data.append(static_cast<char>((value >> (8*i)) & 0xFF));
+	}
+}
+
+
+static void setLe32(QByteArray &data, qint64 position, quint32 value) {
+	qToLittleEndian<quint32>(value, data.data() + position);
+}
+
+
+static void setLe64(QByteArray &data, qint64 position, quint64 value) {
+	qToLittleEndian<quint64>(value, data.data() + position);
+}
+
+
+static qint64 beginChunk(QByteArray &data, const char *fourcc,
+			const char *listType = nullptr) {
+	qint64 position = data.size();
+	data.append(fourcc, 4);
+	appendLe(data, 0, 4);
+	if (listType != nullptr) {
+		data.append(listType, 4);
+	}
+	return position;
+}
+
+
+static void endChunk(QByteArray &data, qint64 position) {
+	setLe32(data, position + 4, data.size() - position - 8);
+	if (data.size() & 1) {
+		data.append('\0');
+	}
+}
+
+
+//Minimal MJPEG AVI holding the given JPEGs, indexed either through idx1 or
+//through an OpenDML indx super index and one ix00 standard index
+static QByteArray buildAvi(const std::vector<QByteArray> &jpegs,
+			const cv::Size &frameSize, bool openDml,
+			std::vector<qint64> &payloadOffsets) {
+	quint32 numFrames = jpegs.size();
+	QByteArray data;
+	qint64 riff = beginChunk(data, "RIFF", "AVI ");
+	qint64 hdrl = beginChunk(data, "LIST", "hdrl");
+	qint64 avih = beginChunk(data, "avih");
+	for (quint32 value : {10000u, 0u, 0u, 0x10u, numFrames, 0u, 1u, 0u,
+				static_cast<quint32>(frameSize.width),
+				static_cast<quint32>(frameSize.height), 0u, 0u, 0u, 0u}) {
+		appendLe(data, value, 4);
+	}
+	endChunk(data, avih);
+	qint64 strl = beginChunk(data, "LIST", "strl");
+	qint64 strh = beginChunk(data, "strh");
+	data.append("vidsMJPG", 8);
+	appendLe(data, 0, 4);	//Flags
+	appendLe(data, 0, 4);	//Priority, language
+	for (quint32 value : {0u, 1u, 100u, 0u, numFrames, 0u, 0xFFFFFFFFu, 0u}) {
+		appendLe(data, value, 4);
+	}
+	appendLe(data, 0, 8);	//rcFrame
+	endChunk(data, strh);
+	qint64 strf = beginChunk(data, "strf");
+	appendLe(data, 40, 4);
+	appendLe(data, frameSize.width, 4);
+	appendLe(data, frameSize.height, 4);
+	appendLe(data, 1, 2);
+	appendLe(data, 24, 2);
+	data.append("MJPG", 4);
+	appendLe(data, frameSize.area()*3, 4);
+	appendLe(data, 0, 16);
+	endChunk(data, strf);
+	qint64 superIndexEntry = -1;
+	if (openDml) {
+		qint64 indx = beginChunk(data, "indx");
+		appendLe(data, 4, 2);	//Longs per entry
+		appendLe(data, 0, 1);
+		appendLe(data, 0, 1);	//AVI_INDEX_OF_INDEXES
+		appendLe(data, 1, 4);
+		data.append("00dc", 4);
+		appendLe(data, 0, 12);
+		superIndexEntry = data.size();
+		appendLe(data, 0, 8);	//Offset of ix00, filled in below
+		appendLe(data, 0, 4);
+		appendLe(data, numFrames, 4);
+		endChunk(data, indx);
+	}
+	endChunk(data, strl);
+	endChunk(data, hdrl);
+
+	qint64 movi = beginChunk(data, "LIST", "movi");
+	std::vector<qint64> chunkOffsets;
+	payloadOffsets.clear();
+	for (const auto &jpeg : jpegs) {
+		qint64 chunk = beginChunk(data, "00dc");
+		chunkOffsets.push_back(chunk);
+		payloadOffsets.push_back(data.size());
+		data.append(jpeg);
+		endChunk(data, chunk);
+	}
+	if (openDml) {
+		qint64 ix00 = beginChunk(data, "ix00");
+		appendLe(data, 2, 2);
+		appendLe(data, 0, 1);
+		appendLe(data, 1, 1);	//AVI_INDEX_OF_CHUNKS
+		appendLe(data, numFrames, 4);
+		data.append("00dc", 4);
+		appendLe(data, movi, 8);	//Base offset
+		appendLe(data, 0, 4);
+		for (quint32 i = 0; i < numFrames; i++) {
+			appendLe(data, payloadOffsets[i] - movi, 4);
+			appendLe(data, jpegs[i].size(), 4);
+		}
+		endChunk(data, ix00);
+		setLe64(data, superIndexEntry, ix00);
+		setLe32(data, superIndexEntry + 8, data.size() - ix00);
+	}
+	endChunk(data, movi);
+	if (!openDml) {
+		//Offsets relative to the movi fourcc, as most muxers write them
+		qint64 idx1 = beginChunk(data, "idx1");
+		for (quint32 i = 0; i < numFrames; i++) {
+			data.append("00dc", 4);
+			appendLe(data, 0x10, 4);
+			appendLe(data, chunkOffsets[i] - (movi + 8), 4);
+			appendLe(data, jpegs[i].size(), 4);
+		}
+		endChunk(data, idx1);
+	}
+	endChunk(data, riff);
+	return data;
+}
+
+
+static bool checkIndexedFile(const QString &directory, bool openDml) {
+	std::string name = openDml ? "OpenDML" : "idx1";
+	cv::Size frameSize(640, 480);
+	cv::RNG rng(0x4a415256);
+	std::vector<QByteArray> jpegs;
+	for (int i = 0; i < 12; i++) {
+		std::vector<uchar> buffer;
+		cv::imencode(".jpg", syntheticFrame(rng, frameSize, i), buffer);
+		jpegs.push_back(QByteArray(reinterpret_cast<const char*>(buffer.data()),
+					buffer.size()));
+	}
+	std::vector<qint64> payloadOffsets;
+	QString videoPath = directory + "/passthrough_" +
+				QString::fromStdString(name) + ".avi";
+	QFile file(videoPath);
+	if (!file.open(QIODevice::WriteOnly) ||
+				file.write(buildAvi(jpegs, frameSize, openDml, payloadOffsets)) < 0) {
+		std::cout << "MJPEG passthrough " << name << ": could not write "
+							<< videoPath.toStdString() << std::endl;
+		return false;
+	}
+	file.close();
+
+	AviIndex index(videoPath);
+	bool passed = index.isValid() && index.frames().size() == jpegs.size();
+	for (size_t i = 0; passed && i < jpegs.size(); i++) {
+		const AviFrame &frame = index.frames()[i];
+		passed = frame.offset == payloadOffsets[i] &&
+					frame.size == jpegs[i].size() && frame.keyFrame;
+	}
+	MjpegPassthrough passthrough(videoPath, jpegs.size());
+	passed = passed && passthrough.isValid();
+	for (size_t i = 0; passed && i < jpegs.size(); i++) {
+		QString framePath = directory + "/Frame_" + QString::number(i) + ".jpg";
+		QFile copied(framePath);
+		passed = passthrough.writeFrame(i, framePath) &&
+					copied.open(QIODevice::ReadOnly) && copied.readAll() == jpegs[i];
+	}
+	std::cout << "MJPEG passthrough " << name << " index: " << jpegs.size()
+						<< " frames " << (passed ? "match" : "FAILED") << std::endl;
+	return passed;
+}
+
+
+bool benchmarkMjpegPassthrough(int numFrames) {
+	QTemporaryDir directory;
+	if (!directory.isValid()) {
+		return false;
+	}
+	bool passed = checkIndexedFile(directory.path(), false);
+	passed = checkIndexedFile(directory.path(), true) && passed;
+
+	//Recording written by the OpenCV muxer
+	QString videoPath = directory.filePath("mjpeg_passthrough_benchmark.avi");
+	cv::Size frameSize(1280, 1024);
+	cv::VideoWriter writer(videoPath.toStdString(),
+				cv::VideoWriter::fourcc('M','J','P','G'), 100, frameSize);
+	if (!writer.isOpened()) {
+		std::cout << "MJPEG passthrough benchmark: could not write "
+							<< videoPath.toStdString() << std::endl;
+		return false;
+	}
+	cv::RNG rng(0x4a415256);
+	for (int i = 0; i < numFrames; i++) {
+		writer.write(syntheticFrame(rng, frameSize, i));
+	}
+	writer.release();
+
+	//Every index entry has to point right behind a 00dc chunk header of the
+	//same size
+	AviIndex index(videoPath);
+	QFile file(videoPath);
+	bool indexMatches = index.isValid() && file.open(QIODevice::ReadOnly);
+	for (const auto &frame : index.frames()) {
+		char header[8];
+		if (!indexMatches || !file.seek(frame.offset - 8) ||
+					file.read(header, 8) != 8) {
+			indexMatches = false;
+			break;
+		}
+		indexMatches = header[2] == 'd' && (header[3] == 'c' || header[3] == 'b') &&
+					qFromLittleEndian<quint32>(header + 4) ==
+					static_cast<quint32>(frame.size);
+	}
+	passed = indexMatches && passed;
+
+	QDir outputDir(directory.filePath("mjpeg_passthrough_benchmark"));
+	outputDir.mkpath(".");
+	cv::VideoCapture cap(videoPath.toStdString());
+	int frameCount = cap.get(cv::CAP_PROP_FRAME_COUNT);
+
+	auto start = high_resolution_clock::now();
+	cv::Mat decoded;
+	for (int i = 0; i < frameCount && cap.read(decoded); i++) {
+		cv::imwrite(outputDir.filePath("Decoded_" + QString::number(i) +
+					".jpg").toStdString(), decoded);
+	}
+	auto decodeDone = high_resolution_clock::now();
+	MjpegPassthrough passthrough(videoPath, frameCount);
+	int copiedFrames = 0;
+	for (int i = 0; i < frameCount; i++) {
+		if (passthrough.writeFrame(i, outputDir.filePath("Copied_" +
+					QString::number(i) + ".jpg"))) {
+			copiedFrames++;
+		}
+	}
+	auto copyDone = high_resolution_clock::now();
+
+	//The copied file holds the exact camera frame, so it has to match what the
+	//video decoder produces up to decoder rounding
+	double maxDiff = 0;
+	cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+	for (int i = 0; i < copiedFrames && cap.read(decoded); i++) {
+		cv::Mat copied = cv::imread(outputDir.filePath("Copied_" +
+					QString::number(i) + ".jpg").toStdString());
+		if (copied.size() != decoded.size()) {
+			maxDiff = 255;
+			break;
+		}
+		maxDiff = std::max(maxDiff, cv::norm(copied, decoded, cv::NORM_INF));
+	}
+	double decodeTime = duration_cast<microseconds>(
+				decodeDone-start).count() / static_cast<double>(frameCount);
+	double copyTime = duration_cast<microseconds>(
+				copyDone-decodeDone).count() / static_cast<double>(frameCount);
+	std::cout << "MJPEG passthrough " << frameSize.width << "x"
+						<< frameSize.height << " decode + encode: " << decodeTime
+						<< " us/frame, copy: " << copyTime << " us/frame, "
+						<< copiedFrames << "/" << frameCount << " frames copied, "
+						<< "index " << (indexMatches ? "matches" : "MISMATCH")
+						<< ", max abs diff: " << maxDiff << std::endl;
+	return passed && frameCount > 0 && copiedFrames == frameCount &&
+				maxDiff < 255;
+}
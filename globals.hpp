@@ -55,6 +55,7 @@ Q_DECLARE_METATYPE(SkeletonComponent)
 
 
 struct DatasetConfig {
+	bool debug = false;	//Log timings and sampling statistics once per recording
 	QString datasetName = "New Dataset";
 	QString datasetPath = ".";
 	QString videoFormat = "";
@@ -62,6 +63,43 @@ struct DatasetConfig {
 	int frameSetsRecording = 10;
 	QString samplingMethod = "kmeans";
 	QList<QString> validRecordingFormats = {"avi", "mp4", "mov", "wmv", "AVI", "MP4", "WMV"};
+	bool sequentialDecoding = true;	//grab() forward instead of seeking to every sampled frame
+	int gopLength = 250;	//Strides longer than this are reached by seeking
+	bool useFeatureCache = true;
+	QString featureCachePath = "";	//Empty uses the platform cache location
+	int featureCacheMaxMB = 2048;	//Least recently used cache files are evicted beyond this, 0 disables the cap
+	bool useJpegEncoderPool = true;
+	int encoderThreads = 0;	//0 uses one encoder per core
+	int encoderQueueSize = 32;
+	int jpegQuality = 95;
+	QString jpegSubsampling = "420";
+	bool chunkedScheduling = true;	//Split every camera into chunks for the work-stealing executor
+	int workerThreads = 0;	//0 uses one worker per core
+	int minChunkLength = 2000;	//Minimum number of video frames spanned by a feature chunk
+	int recordingsInFlight = 2;	//Recordings (or subsets) that are pipelined at the same time
+	int pipelineMemoryMB = 4096;	//Cap on the estimated feature memory of all recordings in flight
+	int clusteringBatchSize = 4096;	//More samples than this switch from full to mini-batch k-means
+	int clusteringIterations = 300;
+	int clusteringAttempts = 3;
+	bool mjpegPassthrough = true;	//Copy the JPEG payload of MJPEG AVI frames instead of decoding and re-encoding
+	bool useSeekIndex = true;	//Seek through the per-video keyframe index instead of CAP_PROP_POS_FRAMES
+	bool useSpillCache = false;	//Keep k-means candidate frames as JPEGs so extraction does not decode them again
+	int spillCacheMemoryMB = 1024;
+	int spillCacheDiskMB = 8192;
+	QString spillCachePath = "";	//Empty uses the system temp dir
+	bool singlePassSubsets = true;	//Decode each recording once for all of its subsets
+	bool keyframeFeatures = false;	//Compute k-means features on keyframes only, needs a parsable keyframe index
+	bool refineSelection = true;	//Re-sample densely around the representatives picked from keyframes
+	bool compareWithExhaustive = false;	//With debug, also run the dense pass and log how far the keyframe selection moved
+	QList<QString> referenceCameras = {};	//Cameras the k-means features are computed on, empty uses all cameras
+	int autoReferenceCameras = 0;	//Pick this many cameras with the highest feature variance in a quick probe, 0 disables
+	int referenceProbeFrames = 64;	//Frames per camera decoded by the probe
+	QString featureReduction = "none";	//"pca" or "random" projects the features down before clustering
+	int reducedDimensions = 64;
+	bool coarseToFine = false;	//Sample at a large stride first, then densely only around candidates and changes
+	int coarseStride = 8;	//Coarse stride in multiples of the subsampling rate
+	float coarseChangeThreshold = 2.0;	//Consecutive coarse samples further apart than this times the median distance are sampled densely
+	bool resumeCreation = true;	//Skip work the creation journal in the dataset folder records as done
 };
 
 struct TimeLineWindow {
@@ -107,6 +145,15 @@ struct CalibrationConfig {
 	QList<QString> cameraNames;
 	QList<QList<QString>> cameraPairs;
 	bool single_primary = false;
+	bool useDetectionCache = true;	//Keep board detections on disk for later runs, within a run they are always shared
+	QString detectionCachePath = "";	//Empty uses the platform cache location
+	int detectionThreads = 0;	//Board detectors shared by all cameras, 0 uses one per core
+	int detectionQueueSize = 8;	//Decoded frames per camera waiting for or in detection
+	bool boardPrefilter = false;	//Cheap checks in front of cbdetect that skip frames without a usable board
+	double prefilterBlurThreshold = 15.0;	//Minimum Laplacian variance of the downscaled frame, 0 disables the blur check
+	int prefilterWidth = 640;	//Width of the downscaled frame the checks run on
+	bool prefilterRoi = true;	//Run cbdetect only around the board found in the downscaled frame
+	bool prefilterAudit = false;	//Run the full detector on rejected frames too and count the boards the prefilter would have lost
 };
 
 struct AnnotationCount {
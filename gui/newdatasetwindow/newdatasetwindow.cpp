@@ -58,12 +58,65 @@ NewDatasetWindow::NewDatasetWindow(QWidget *parent) : QWidget(parent, Qt::Window
 	frameSetsRecordingBox->setMinimum(0);
 	frameSetsRecordingBox->setMaximum(9999999);
 	frameSetsRecordingBox->setValue(m_datasetConfig->frameSetsRecording);
-	LabelWithToolTip *samplingMethodLabel = new LabelWithToolTip("Sampling Method", "Kmeans picks framessets that are as visually distinct from one another as possible. Uniform should only be used for testing purposes");
+	LabelWithToolTip *samplingMethodLabel = new LabelWithToolTip("Sampling Method", "Kmeans picks framessets that are as visually distinct from one another as possible. Kcenter greedily picks the framesets farthest from all picked ones, it is deterministic and much faster on long recordings. Motion puts more framesets where there is a lot of movement. Uniform should only be used for testing purposes");
 	samplingMethodCombo = new QComboBox(configBox);
 	samplingMethodCombo->addItem("uniform");
 	samplingMethodCombo->addItem("kmeans");
+	samplingMethodCombo->addItem("kcenter");
+	samplingMethodCombo->addItem("motion");
 	samplingMethodCombo->setCurrentText(m_datasetConfig->samplingMethod);
 
+	Spoiler *advancedWidget = new Spoiler("Advanced Frame Selection", 300, configBox);
+	QGridLayout *advancedlayout = new QGridLayout();
+	LabelWithToolTip *spillCacheLabel = new LabelWithToolTip("Spill Cache", "Keep the candidate frames of the feature pass as JPEGs in memory and on disk, so extracting the selected framesets does not decode the videos a second time. Needs up to a few GB of temporary disk space.");
+	spillCacheRadioWidget = new YesNoRadioWidget(configBox);
+	spillCacheRadioWidget->setState(m_datasetConfig->useSpillCache);
+	LabelWithToolTip *keyframeFeaturesLabel = new LabelWithToolTip("Keyframe Features", "Compute the features for kmeans on the keyframes of the videos only and refine around the picked ones. Much faster on long recordings with regular keyframes, falls back to all frames if the videos have no usable keyframe index.");
+	keyframeFeaturesRadioWidget = new YesNoRadioWidget(configBox);
+	keyframeFeaturesRadioWidget->setState(m_datasetConfig->keyframeFeatures);
+	LabelWithToolTip *referenceCamerasLabel = new LabelWithToolTip("Reference Cameras", "Comma separated names of the cameras the features are computed on, framesets are still extracted from all cameras. Leave empty to use all cameras. Run 'AnnotationTool --dataset-compare-cameras <manifest>' on a planned shard manifest to check how well they cover the other cameras.");
+	referenceCamerasEdit = new QLineEdit(m_datasetConfig->referenceCameras.join(", "), configBox);
+	referenceCamerasEdit->setPlaceholderText("All Cameras");
+	LabelWithToolTip *autoReferenceCamerasLabel = new LabelWithToolTip("Automatic Reference Cameras", "If no reference cameras are given, pick this many cameras with the most varied views from a quick probe of each recording. 0 uses all cameras.");
+	autoReferenceCamerasBox = new QSpinBox(configBox);
+	autoReferenceCamerasBox->setRange(0,999);
+	autoReferenceCamerasBox->setValue(m_datasetConfig->autoReferenceCameras);
+	LabelWithToolTip *featureReductionLabel = new LabelWithToolTip("Feature Reduction", "Project the features down before kmeans and kcenter, which speeds up clustering recordings with many cameras. PCA keeps the most variance, random projection is cheaper to fit.");
+	featureReductionCombo = new QComboBox(configBox);
+	featureReductionCombo->addItem("none");
+	featureReductionCombo->addItem("pca");
+	featureReductionCombo->addItem("random");
+	featureReductionCombo->setCurrentText(m_datasetConfig->featureReduction);
+	LabelWithToolTip *reducedDimensionsLabel = new LabelWithToolTip("Reduced Dimensions", "Number of dimensions the features are projected to.");
+	reducedDimensionsBox = new QSpinBox(configBox);
+	reducedDimensionsBox->setRange(1,9999);
+	reducedDimensionsBox->setValue(m_datasetConfig->reducedDimensions);
+	LabelWithToolTip *coarseToFineLabel = new LabelWithToolTip("Coarse to Fine Sampling", "Compute the features at a large stride first and sample densely only around the candidates and where the recording changes a lot. Saves most of the decoding on long, mostly static recordings.");
+	coarseToFineRadioWidget = new YesNoRadioWidget(configBox);
+	coarseToFineRadioWidget->setState(m_datasetConfig->coarseToFine);
+	LabelWithToolTip *coarseStrideLabel = new LabelWithToolTip("Coarse Stride", "Stride of the coarse pass in multiples of the regular sampling stride.");
+	coarseStrideBox = new QSpinBox(configBox);
+	coarseStrideBox->setRange(1,999);
+	coarseStrideBox->setValue(m_datasetConfig->coarseStride);
+	int row = 0;
+	advancedlayout->addWidget(spillCacheLabel,row,0);
+	advancedlayout->addWidget(spillCacheRadioWidget,row++,1);
+	advancedlayout->addWidget(keyframeFeaturesLabel,row,0);
+	advancedlayout->addWidget(keyframeFeaturesRadioWidget,row++,1);
+	advancedlayout->addWidget(referenceCamerasLabel,row,0);
+	advancedlayout->addWidget(referenceCamerasEdit,row++,1);
+	advancedlayout->addWidget(autoReferenceCamerasLabel,row,0);
+	advancedlayout->addWidget(autoReferenceCamerasBox,row++,1);
+	advancedlayout->addWidget(featureReductionLabel,row,0);
+	advancedlayout->addWidget(featureReductionCombo,row++,1);
+	advancedlayout->addWidget(reducedDimensionsLabel,row,0);
+	advancedlayout->addWidget(reducedDimensionsBox,row++,1);
+	advancedlayout->addWidget(coarseToFineLabel,row,0);
+	advancedlayout->addWidget(coarseToFineRadioWidget,row++,1);
+	advancedlayout->addWidget(coarseStrideLabel,row,0);
+	advancedlayout->addWidget(coarseStrideBox,row++,1);
+	advancedWidget->setContentLayout(*advancedlayout);
+
 	QGroupBox *recordingsBox = new QGroupBox("Recordings");
 	QGridLayout *recordingslayout = new QGridLayout(recordingsBox);
 	recordingsTable = new RecordingsTable("Recordings", m_datasetConfig);
@@ -104,6 +157,10 @@ NewDatasetWindow::NewDatasetWindow(QWidget *parent) : QWidget(parent, Qt::Window
 	importButton->setMinimumSize(40,40);
 	importButton->setIcon(QIcon::fromTheme("download"));
 	connect(importButton, &QPushButton::clicked, this, &NewDatasetWindow::importPresetsClickedSlot);
+	planShardsButton = new QPushButton("Plan Shards");
+	planShardsButton->setMinimumSize(40,40);
+	planShardsButton->setToolTip("Write a manifest for creating the dataset with several worker processes, possibly on different machines sharing the dataset folder.");
+	connect(planShardsButton, &QPushButton::clicked, this, &NewDatasetWindow::planShardsClickedSlot);
 	QWidget *middleSpacer = new QWidget();
 	middleSpacer->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 	createButton = new QPushButton("Create");
@@ -113,8 +170,9 @@ NewDatasetWindow::NewDatasetWindow(QWidget *parent) : QWidget(parent, Qt::Window
 	buttonbarlayout->addWidget(saveButton, 0,0);
 	buttonbarlayout->addWidget(loadButton,0,1);
 	buttonbarlayout->addWidget(importButton,0,2);
-	buttonbarlayout->addWidget(middleSpacer,0,3);
-	buttonbarlayout->addWidget(createButton,0,4);
+	buttonbarlayout->addWidget(planShardsButton,0,3);
+	buttonbarlayout->addWidget(middleSpacer,0,4);
+	buttonbarlayout->addWidget(createButton,0,5);
 
 	configlayout->addWidget(datasetNameLabel,0,0);
 	configlayout->addWidget(datasetNameEdit,0,1,1,2);
@@ -124,6 +182,7 @@ NewDatasetWindow::NewDatasetWindow(QWidget *parent) : QWidget(parent, Qt::Window
 	configlayout->addWidget(frameSetsRecordingBox,2,1,1,2);
 	configlayout->addWidget(samplingMethodLabel,3,0);
 	configlayout->addWidget(samplingMethodCombo,3,1,1,2);
+	configlayout->addWidget(advancedWidget,4,0,1,3);
 
 	layout->addWidget(newDatasetLabel,0,0,1,3);
 	layout->addWidget(configBox,1,0,1,3);
@@ -141,6 +200,8 @@ NewDatasetWindow::NewDatasetWindow(QWidget *parent) : QWidget(parent, Qt::Window
 	connect(this, &NewDatasetWindow::createDataset, datasetCreator, &DatasetCreator::createDatasetSlot);
 	connect(datasetCreator, &DatasetCreator::datasetCreated, this, &NewDatasetWindow::datasetCreatedSot);
 	connect(datasetCreator, &DatasetCreator::datasetCreationFailed, this, &NewDatasetWindow::datasetCreationFailedSlot);
+	connect(this, &NewDatasetWindow::planShards, datasetCreator, &DatasetCreator::planShardsSlot);
+	connect(datasetCreator, &DatasetCreator::shardsPlanned, this, &NewDatasetWindow::shardsPlannedSlot);
 
 	//Signal relay
 
@@ -149,63 +210,113 @@ NewDatasetWindow::NewDatasetWindow(QWidget *parent) : QWidget(parent, Qt::Window
 }
 
 void NewDatasetWindow::createDatasetClickedSlot() {
+	if (!checkDatasetInputs()) {
+		return;
+	}
+	if (!checkDatasetExists(m_datasetConfig->datasetPath + "/" + m_datasetConfig->datasetName)) {
+		return;
+	}
+
+	emit createDataset(recordingsTable->getItems(), entitiesItemList->getItems(), keypointsItemList->getItems(), skeletonTable->getItems());
+	datasetProgressInfoWindow = new DatasetProgressInfoWindow(this);
+	connect(datasetProgressInfoWindow, &DatasetProgressInfoWindow::rejected, datasetCreator, &DatasetCreator::cancelCreationSlot, Qt::DirectConnection);
+	connect(datasetCreator, &DatasetCreator::dctProgress, datasetProgressInfoWindow, &DatasetProgressInfoWindow::dctProgressSlot);
+	connect(datasetCreator, &DatasetCreator::recordingBeingProcessedChanged, datasetProgressInfoWindow, &DatasetProgressInfoWindow::recordingBeingProcessedChangedSlot);
+	connect(datasetCreator, &DatasetCreator::currentSegmentChanged, datasetProgressInfoWindow, &DatasetProgressInfoWindow::segmentNameChangedSlot);
+	connect(datasetCreator, &DatasetCreator::startedClustering, datasetProgressInfoWindow, &DatasetProgressInfoWindow::startedClusteringSlot);
+	connect(datasetCreator, &DatasetCreator::finishedClustering, datasetProgressInfoWindow, &DatasetProgressInfoWindow::finishedClusteringSlot);
+	connect(datasetCreator, &DatasetCreator::copyImagesStatus, datasetProgressInfoWindow, &DatasetProgressInfoWindow::copyImagesStatusSlot);
+	datasetProgressInfoWindow->exec();
+}
+
+bool NewDatasetWindow::checkDatasetInputs() {
 	m_datasetConfig->datasetName = datasetNameEdit->text();
 	m_datasetConfig->datasetPath = datasetPathWidget->path();
 	m_datasetConfig->frameSetsRecording = frameSetsRecordingBox->value();
 	m_datasetConfig->samplingMethod = samplingMethodCombo->currentText();
+	m_datasetConfig->useSpillCache = spillCacheRadioWidget->state();
+	m_datasetConfig->keyframeFeatures = keyframeFeaturesRadioWidget->state();
+	m_datasetConfig->referenceCameras.clear();
+	for (const auto &camera : referenceCamerasEdit->text().split(",", Qt::SkipEmptyParts)) {
+		if (camera.trimmed() != "") {
+			m_datasetConfig->referenceCameras.append(camera.trimmed());
+		}
+	}
+	m_datasetConfig->autoReferenceCameras = autoReferenceCamerasBox->value();
+	m_datasetConfig->featureReduction = featureReductionCombo->currentText();
+	m_datasetConfig->reducedDimensions = reducedDimensionsBox->value();
+	m_datasetConfig->coarseToFine = coarseToFineRadioWidget->state();
+	m_datasetConfig->coarseStride = coarseStrideBox->value();
 
 	if (m_datasetConfig->datasetPath == "") {
 		m_errorMsg->showMessage("Dataset Path is empty. Dataset Creation aborted...");
-		return;
+		return false;
 	}
 	if (m_datasetConfig->datasetName == "") {
 		m_errorMsg->showMessage("Dataset Name is empty. Dataset Creation aborted...");
-		return;
+		return false;
 	}
 	if (recordingsTable->getItems().size() == 0) {
 		m_errorMsg->showMessage("No Recording selected. Dataset Creation aborted...");
-		return;
+		return false;
 	}
 	if (recordingsTable->getItems().size() == 0) {
 		m_errorMsg->showMessage("Add at least one entity to the list...");
-		return;
+		return false;
 	}
 	if (recordingsTable->getItems().size() == 0) {
 		m_errorMsg->showMessage("Add at least one recording...");
-		return;
+		return false;
 	}
 	if (entitiesItemList->getItems().size() == 0) {
 		m_errorMsg->showMessage("Add at least one entity...");
-		return;
+		return false;
 	}
 	if (keypointsItemList->getItems().size() == 0) {
 		m_errorMsg->showMessage("Add at least one keypoint...");
-		return;
+		return false;
 	}
-	if (!checkDatasetExists(m_datasetConfig->datasetPath + "/" + m_datasetConfig->datasetName)) {
+	return true;
+}
+
+
+void NewDatasetWindow::planShardsClickedSlot() {
+	if (!checkDatasetInputs()) {
 		return;
 	}
+	QString manifestPath = QFileDialog::getSaveFileName(this,
+				"Save shard manifest", m_datasetConfig->datasetPath + "/" +
+				m_datasetConfig->datasetName + "_shards.yaml", "YAML Files (*.yaml)");
+	if (manifestPath != "") {
+		emit planShards(recordingsTable->getItems(), entitiesItemList->getItems(), keypointsItemList->getItems(), skeletonTable->getItems(), manifestPath);
+	}
+}
 
-	emit createDataset(recordingsTable->getItems(), entitiesItemList->getItems(), keypointsItemList->getItems(), skeletonTable->getItems());
-	datasetProgressInfoWindow = new DatasetProgressInfoWindow(this);
-	connect(datasetProgressInfoWindow, &DatasetProgressInfoWindow::rejected, datasetCreator, &DatasetCreator::cancelCreationSlot);
-	connect(datasetCreator, &DatasetCreator::dctProgress, datasetProgressInfoWindow, &DatasetProgressInfoWindow::dctProgressSlot);
-	connect(datasetCreator, &DatasetCreator::recordingBeingProcessedChanged, datasetProgressInfoWindow, &DatasetProgressInfoWindow::recordingBeingProcessedChangedSlot);
-	connect(datasetCreator, &DatasetCreator::currentSegmentChanged, datasetProgressInfoWindow, &DatasetProgressInfoWindow::segmentNameChangedSlot);
-	connect(datasetCreator, &DatasetCreator::startedClustering, datasetProgressInfoWindow, &DatasetProgressInfoWindow::startedClusteringSlot);
-	connect(datasetCreator, &DatasetCreator::finishedClustering, datasetProgressInfoWindow, &DatasetProgressInfoWindow::finishedClusteringSlot);
-	connect(datasetCreator, &DatasetCreator::copyImagesStatus, datasetProgressInfoWindow, &DatasetProgressInfoWindow::copyImagesStatusSlot);
-	datasetProgressInfoWindow->exec();
+
+void NewDatasetWindow::shardsPlannedSlot(QString manifestPath, int numUnits) {
+	QMessageBox::information(this, "Shards planned", "Planned " +
+				QString::number(numUnits) + " work units. Start any number of workers with\n\n"
+				"AnnotationTool --dataset-worker " + manifestPath + "\n\n"
+				"The last worker to finish writes the dataset file, "
+				"--dataset-merge " + manifestPath + " writes it after the fact. "
+				"--dataset-compare-cameras " + manifestPath + " compares the frames "
+				"picked on the reference cameras with those picked on all cameras.");
 }
 
+
 void NewDatasetWindow::datasetCreatedSot() {
 	datasetProgressInfoWindow->accept();
 	delete datasetProgressInfoWindow;
+	datasetProgressInfoWindow = nullptr;
 }
 
 void NewDatasetWindow::datasetCreationFailedSlot(QString errorMsg) {
-	datasetProgressInfoWindow->accept();
-	delete datasetProgressInfoWindow;
+	//Planning shards fails without a progress window
+	if (datasetProgressInfoWindow != nullptr) {
+		datasetProgressInfoWindow->accept();
+		delete datasetProgressInfoWindow;
+		datasetProgressInfoWindow = nullptr;
+	}
 	m_errorMsg->showMessage(errorMsg + "\nDataset Creation aborted...");
 }
 
@@ -244,6 +355,10 @@ void NewDatasetWindow::importPresetsClickedSlot() {
 			skeleton.append(comp);
 		}
 		skeletonTable->setItems(skeleton);
+		if (datasetYaml["Sampling Method"]) {
+			samplingMethodCombo->setCurrentText(QString::fromStdString(
+						datasetYaml["Sampling Method"].as<std::string>()));
+		}
 	}
 }
 
@@ -19,6 +19,8 @@
 #include "datasetprogressinfowindow.hpp"
 #include "labelwithtooltip.hpp"
 #include "pathwidget.hpp"
+#include "yesnoradiowidget.hpp"
+#include "spoiler.hpp"
 #include "skeletontablewidget.hpp"
 
 
@@ -46,11 +48,16 @@ class NewDatasetWindow : public QWidget {
 						QList<QString> entities,
 						QList<QString> keypoints,
 						QList<SkeletonComponent> skeleton);
+		void planShards(QList<RecordingItem> recordings,
+						QList<QString> entities,
+						QList<QString> keypoints,
+						QList<SkeletonComponent> skeleton,
+						QString manifestPath);
 
 	private:
 		DatasetConfig	*m_datasetConfig;
 		DatasetCreator *datasetCreator;
-		DatasetProgressInfoWindow *datasetProgressInfoWindow;
+		DatasetProgressInfoWindow *datasetProgressInfoWindow = nullptr;
 		QSettings *settings;
 		PresetsWindow *loadPresetsWindow;
 		PresetsWindow *savePresetsWindow;
@@ -62,6 +69,14 @@ class NewDatasetWindow : public QWidget {
 		QRadioButton *imagesButton;
 		QSpinBox *frameSetsRecordingBox;
 		QComboBox *samplingMethodCombo;
+		YesNoRadioWidget *spillCacheRadioWidget;
+		YesNoRadioWidget *keyframeFeaturesRadioWidget;
+		QLineEdit *referenceCamerasEdit;
+		QSpinBox *autoReferenceCamerasBox;
+		QComboBox *featureReductionCombo;
+		QSpinBox *reducedDimensionsBox;
+		YesNoRadioWidget *coarseToFineRadioWidget;
+		QSpinBox *coarseStrideBox;
 
 		RecordingsTable *recordingsTable;
 		ConfigurableItemList *entitiesItemList;
@@ -72,16 +87,20 @@ class NewDatasetWindow : public QWidget {
 		QPushButton *loadButton;
 		QPushButton *saveButton;
 		QPushButton *importButton;
+		QPushButton *planShardsButton;
 		QPushButton *createButton;
 
 		QErrorMessage *m_errorMsg;
 
 		bool checkDatasetExists(const QString &path);
+		bool checkDatasetInputs();
 
 
 
 		private slots:
 			void createDatasetClickedSlot();
+			void planShardsClickedSlot();
+			void shardsPlannedSlot(QString manifestPath, int numUnits);
 			void datasetCreatedSot();
 			void datasetCreationFailedSlot(QString errorMsg);
 
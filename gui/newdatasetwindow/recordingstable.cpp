@@ -57,13 +57,7 @@ QList<RecordingItem> RecordingsTable::getItems() {
 
 
 int RecordingsTable::getNumberSubfolders(QString path) {
-	int count = 0;
-	for (QDirIterator it(path); it.hasNext();) {
-		QString subpath = it.next();
-		QString suffix = subpath.split('/').takeLast();
-		if (m_datasetConfig->validRecordingFormats.contains(subpath.split('.').takeLast())) count++;
-	}
-	return count;
+	return RecordingIndex::open(path, m_datasetConfig->validRecordingFormats)->videos().size();
 }
 
 
@@ -80,6 +74,7 @@ void RecordingsTable::addItemSlot() {
 		m_datasetConfig->numCameras = numValidRecordings;
 		recordingItem.name = dir.split("/").takeLast();
 		recordingItem.path = dir;
+		recordingItem.frameCount = RecordingIndex::open(dir, m_datasetConfig->validRecordingFormats)->frameCount();
 		m_recordingItems.append(recordingItem);
 		m_currentDir = QDir(dir);
 		m_currentDir.cdUp();
@@ -198,13 +193,8 @@ QImage RecordingsTable::createTimeLineImage(QList<TimeLineWindow> timeLineWindow
 
 QList<QString> RecordingsTable::getVideoPaths(const QString& path) {
 	QList<QString> videoPaths;
-	for (QDirIterator it(path); it.hasNext();) {
-		QString subpath = it.next();
-		QString suffix = subpath.split('/').takeLast();
-		if (suffix != "." && suffix != "..") {
-			suffix = suffix.split(".").takeLast();
-			if (m_datasetConfig->validRecordingFormats.contains(suffix)) videoPaths.append(subpath);
-		}
+	for (const auto &video : RecordingIndex::open(path, m_datasetConfig->validRecordingFormats)->videos()) {
+		videoPaths.append(video.path);
 	}
 	return videoPaths;
 }
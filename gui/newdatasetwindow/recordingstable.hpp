@@ -13,6 +13,7 @@
 #include "globals.hpp"
 #include "dataset.hpp"
 #include "videocutterwindow.hpp"
+#include "recordingindex.hpp"
 
 
 #include <QPushButton>
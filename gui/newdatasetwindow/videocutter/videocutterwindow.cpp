@@ -21,7 +21,7 @@
 #include <QFileDialog>
 #include <QErrorMessage>
 
-#include "opencv2/videoio/videoio.hpp"
+#include "recordingindex.hpp"
 
 VideoCutterWindow::VideoCutterWindow(QList<TimeLineWindow> timeLineWindows, QWidget *parent)
 	: m_timeLineWindows(timeLineWindows), QWidget(parent, Qt::Window) {
@@ -221,11 +221,12 @@ void VideoCutterWindow::updateSize() {
 }
 
 void VideoCutterWindow::openVideo(const QString &path) {
-		cv::VideoCapture cap(path.toStdString());
-    m_frameCount = cap.get(cv::CAP_PROP_FRAME_COUNT);
-    m_frameRate = cap.get(cv::CAP_PROP_FPS);
-		m_duration = cap.get(cv::CAP_PROP_FRAME_COUNT)*1000/cap.get(cv::CAP_PROP_FPS);
-		cap.release();
+		QFileInfo fileInfo(path);
+		VideoInfo video = RecordingIndex::open(fileInfo.absolutePath(), {fileInfo.suffix()})->video(
+					fileInfo.fileName().split(".").takeFirst());
+    m_frameCount = video.frameCount;
+    m_frameRate = video.frameRate;
+		m_duration = video.frameCount*1000/video.frameRate;
     timeLine->setFrameCount(m_frameCount);
 		rangeOverview->setFrameCount(m_frameCount);
     rangeSlider->setRange(0, m_frameCount);
@@ -250,11 +251,16 @@ bool VideoCutterWindow::openVideos(QList<QString> videoPaths) {
 		int frameRate = 0;
 		QDir d = QFileInfo(videoPaths[0]).absoluteDir();
 		m_recordingsPath  = d.absolutePath();
+		QList<QString> formats;
+		for (const auto &path : videoPaths) {
+			if (!formats.contains(QFileInfo(path).suffix())) formats.append(QFileInfo(path).suffix());
+		}
+		QSharedPointer<RecordingIndex> recordingIndex = RecordingIndex::open(m_recordingsPath, formats);
 		for (const auto &path : videoPaths)
 		{
-			cv::VideoCapture cap(path.toStdString());
-			int fc = cap.get(cv::CAP_PROP_FRAME_COUNT);
-			int fr = cap.get(cv::CAP_PROP_FPS);
+			VideoInfo video = recordingIndex->video(QFileInfo(path).fileName().split(".").takeFirst());
+			int fc = video.frameCount;
+			int fr = video.frameRate;
 			if (frameCount == 0) frameCount = fc;
 			else if (frameCount != fc) {
 				return false;
@@ -263,7 +269,6 @@ bool VideoCutterWindow::openVideos(QList<QString> videoPaths) {
 			else if (frameRate != fr) {
 				return false;
 			}
-			cap.release();
 		}
 		m_frameCount = frameCount;
 		m_frameRate = frameRate;
@@ -10,8 +10,10 @@
 #include "globals.hpp"
 #include "DarkStyle.hpp"
 #include "mainwindow.hpp"
+#include "datasetcreator.hpp"
 
 #include <iostream>
+#include <algorithm>
 #include <QApplication>
 #include <QSplashScreen>
 #include <QSettings>
@@ -184,6 +186,61 @@ void initPresets() {
 }
 
 
+int runDatasetShardCommand(int argc, char **argv, const QString &command,
+			const QString &manifestPath) {
+	//Headless, several workers can be started on one or more machines sharing
+	//the dataset folder
+	QCoreApplication app(argc, argv);
+	DatasetConfig datasetConfig;
+	DatasetCreator datasetCreator(&datasetConfig);
+	QObject::connect(&datasetCreator, &DatasetCreator::datasetCreationFailed,
+				[](QString errorMsg) {
+		std::cout << errorMsg.toStdString() << std::endl;
+	});
+	QObject::connect(&datasetCreator, &DatasetCreator::referenceCamerasCompared,
+				[](QString subset, double referenceCost, double allCamerasCost) {
+		std::cout << subset.toStdString() << ": reference camera selection cost "
+							<< referenceCost << ", all camera selection cost "
+							<< allCamerasCost << " ("
+							<< referenceCost / std::max(allCamerasCost, 1e-12) << "x)"
+							<< std::endl;
+	});
+	QObject::connect(&datasetCreator, &DatasetCreator::decodingPathsCompared,
+				[](QString unit, QString path, bool framesMatch, bool selectionsMatch,
+				double maxFeatureDiff) {
+		std::cout << unit.toStdString() << ", " << path.toStdString() << ": "
+							<< (framesMatch ? "same" : "DIFFERENT") << " sampled frames, "
+							<< "max feature diff " << maxFeatureDiff << ", "
+							<< (selectionsMatch ? "same" : "DIFFERENT") << " selection"
+							<< std::endl;
+	});
+	bool merged = false;
+	QObject::connect(&datasetCreator, &DatasetCreator::datasetCreated, [&]() {
+		merged = true;
+		std::cout << "All units finished, wrote " <<
+					datasetConfig.datasetName.toStdString() << ".yaml" << std::endl;
+	});
+	bool success;
+	if (command == "--dataset-worker") {
+		success = datasetCreator.runShardWorker(manifestPath);
+		if (success && !merged) {
+			std::cout << "Merge deferred, units of other workers are not finished "
+								<< "yet" << std::endl;
+		}
+	}
+	else if (command == "--dataset-compare-cameras") {
+		success = datasetCreator.compareReferenceCameras(manifestPath);
+	}
+	else if (command == "--dataset-compare-decoding") {
+		success = datasetCreator.compareDecodingPaths(manifestPath);
+	}
+	else {
+		success = datasetCreator.mergeShards(manifestPath);
+	}
+	return success ? 0 : 1;
+}
+
+
 int main(int argc, char **argv) {
 	// This makes relative paths work in C++ in Xcode by changing directory to the Resources folder inside the .app bundle
 	#ifdef __APPLE__
@@ -216,6 +273,16 @@ int main(int argc, char **argv) {
 	QCoreApplication::setOrganizationDomain("JARVIS-MoCap");
 	QCoreApplication::setApplicationName("Annotation Tool");
 
+	for (int i = 1; i+1 < argc; i++) {
+		QString arg = argv[i];
+		if (arg == "--dataset-worker" || arg == "--dataset-merge" ||
+					arg == "--dataset-compare-cameras" ||
+					arg == "--dataset-compare-decoding") {
+			qRegisterMetaType< cv::Mat >();
+			return runDatasetShardCommand(argc, argv, arg, argv[i+1]);
+		}
+	}
+
 	// qRegisterMetaTypeStreamOperators<QList<QString> >("QList<QString>");
   // qRegisterMetaTypeStreamOperators<QList<QList<QString>>>("QList<QList<QString>>");
   // qRegisterMetaTypeStreamOperators<QMap<int,int> >("QMap<int,int>");
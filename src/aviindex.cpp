@@ -0,0 +1,230 @@
+/*******************************************************************************
+ * File:			  aviindex.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "aviindex.hpp"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static const quint32 KeyFrameFlag = 0x10;	//AVIIF_KEYFRAME in idx1
+static const quint32 NotKeyFrameBit = 0x80000000;	//OpenDML standard index
+
+
+static quint16 le16(const char *data) {
+	return qFromLittleEndian<quint16>(data);
+}
+
+
+static quint32 le32(const char *data) {
+	return qFromLittleEndian<quint32>(data);
+}
+
+
+static quint64 le64(const char *data) {
+	return qFromLittleEndian<quint64>(data);
+}
+
+
+static bool readAt(QFile &file, qint64 position, char *data, qint64 size) {
+	return file.seek(position) && file.read(data, size) == size;
+}
+
+
+AviIndex::AviIndex(const QString &videoPath) {
+	QFile file(videoPath);
+	if (file.open(QIODevice::ReadOnly)) {
+		m_valid = parse(file);
+	}
+}
+
+
+bool AviIndex::parse(QFile &file) {
+	char header[12];
+	if (!readAt(file, 0, header, 12) || std::memcmp(header, "RIFF", 4) != 0 ||
+				std::memcmp(header + 8, "AVI ", 4) != 0) {
+		return false;
+	}
+	qint64 riffEnd = std::min(file.size(), 8 + static_cast<qint64>(le32(header + 4)));
+	qint64 moviPos = -1;
+	qint64 idx1Pos = -1;
+	qint64 idx1Size = 0;
+	qint64 position = 12;
+	while (position + 8 <= riffEnd) {
+		char chunk[12];
+		if (!readAt(file, position, chunk, 8)) {
+			return false;
+		}
+		qint64 size = le32(chunk + 4);
+		if (std::memcmp(chunk, "LIST", 4) == 0) {
+			if (!readAt(file, position + 8, chunk + 8, 4)) {
+				return false;
+			}
+			if (std::memcmp(chunk + 8, "hdrl", 4) == 0) {
+				parseHeaderList(file, position + 12, position + 8 + size);
+			}
+			else if (std::memcmp(chunk + 8, "movi", 4) == 0) {
+				moviPos = position + 8;
+			}
+		}
+		else if (std::memcmp(chunk, "idx1", 4) == 0) {
+			idx1Pos = position + 8;
+			idx1Size = size;
+		}
+		position += 8 + size + (size & 1);
+	}
+	if (m_videoStream < 0) {
+		return false;
+	}
+
+	//OpenDML indices cover files beyond the 1 GB idx1 limit, prefer them
+	if (!m_standardIndices.empty()) {
+		for (const auto &indexPosition : m_standardIndices) {
+			if (!parseStandardIndex(file, indexPosition)) {
+				m_frames.clear();
+				break;
+			}
+		}
+		if (!m_frames.empty()) {
+			return true;
+		}
+	}
+	if (idx1Pos >= 0 && moviPos >= 0) {
+		return parseIdx1(file, idx1Pos, idx1Size, moviPos);
+	}
+	return false;
+}
+
+
+void AviIndex::parseHeaderList(QFile &file, qint64 begin, qint64 end) {
+	int stream = 0;
+	qint64 position = begin;
+	while (position + 8 <= end) {
+		char chunk[12];
+		if (!readAt(file, position, chunk, 8)) {
+			return;
+		}
+		qint64 size = le32(chunk + 4);
+		if (std::memcmp(chunk, "LIST", 4) == 0 &&
+					readAt(file, position + 8, chunk + 8, 4) &&
+					std::memcmp(chunk + 8, "strl", 4) == 0) {
+			parseStreamList(file, position + 12, position + 8 + size, stream++);
+		}
+		position += 8 + size + (size & 1);
+	}
+}
+
+
+void AviIndex::parseStreamList(QFile &file, qint64 begin, qint64 end,
+			int stream) {
+	bool isVideo = false;
+	qint64 position = begin;
+	while (position + 8 <= end) {
+		char chunk[8];
+		if (!readAt(file, position, chunk, 8)) {
+			return;
+		}
+		qint64 size = le32(chunk + 4);
+		if (std::memcmp(chunk, "strh", 4) == 0 && size >= 8) {
+			char streamHeader[8];
+			if (readAt(file, position + 8, streamHeader, 8) &&
+						std::memcmp(streamHeader, "vids", 4) == 0 && m_videoStream < 0) {
+				m_videoStream = stream;
+				isVideo = true;
+			}
+		}
+		else if (std::memcmp(chunk, "strf", 4) == 0 && isVideo && size >= 20) {
+			//BITMAPINFOHEADER
+			char bitmapInfo[20];
+			if (readAt(file, position + 8, bitmapInfo, 20)) {
+				m_width = static_cast<qint32>(le32(bitmapInfo + 4));
+				m_height = std::abs(static_cast<qint32>(le32(bitmapInfo + 8)));
+				m_codec = QString::fromLatin1(bitmapInfo + 16, 4);
+			}
+		}
+		else if (std::memcmp(chunk, "indx", 4) == 0 && isVideo && size >= 24) {
+			//OpenDML super index, every entry points to an ix## standard index
+			QByteArray superIndex(size, 0);
+			if (readAt(file, position + 8, superIndex.data(), size) &&
+						superIndex[3] == 0) {
+				quint32 numEntries = le32(superIndex.constData() + 4);
+				for (quint32 i = 0; i < numEntries && 24 + (i+1)*16 <= size; i++) {
+					m_standardIndices.push_back(le64(superIndex.constData() + 24 + i*16));
+				}
+			}
+		}
+		position += 8 + size + (size & 1);
+	}
+}
+
+
+bool AviIndex::parseIdx1(QFile &file, qint64 begin, qint64 size,
+			qint64 moviPos) {
+	QByteArray entries(size, 0);
+	if (!readAt(file, begin, entries.data(), size)) {
+		return false;
+	}
+	int numEntries = size / 16;
+	if (numEntries == 0) {
+		return false;
+	}
+	//Offsets are either relative to the movi fourcc or absolute, depending on
+	//the muxer. Relative ones are smaller than the position of movi itself.
+	qint64 base = (le32(entries.constData() + 8) < moviPos) ? moviPos : 0;
+	for (int i = 0; i < numEntries; i++) {
+		const char *entry = entries.constData() + i*16;
+		if (!isVideoChunk(entry)) {
+			continue;
+		}
+		AviFrame frame;
+		frame.offset = base + le32(entry + 8) + 8;
+		frame.size = le32(entry + 12);
+		frame.keyFrame = (le32(entry + 4) & KeyFrameFlag) != 0;
+		m_frames.push_back(frame);
+	}
+	return !m_frames.empty();
+}
+
+
+bool AviIndex::parseStandardIndex(QFile &file, qint64 position) {
+	char header[32];
+	if (!readAt(file, position, header, 32) || header[0] != 'i' ||
+				header[1] != 'x' || header[11] != 1) {
+		return false;
+	}
+	quint16 longsPerEntry = le16(header + 8);
+	quint32 numEntries = le32(header + 12);
+	quint64 baseOffset = le64(header + 20);
+	if (longsPerEntry != 2) {
+		return false;
+	}
+	QByteArray entries(numEntries*8, 0);
+	if (!readAt(file, position + 32, entries.data(), entries.size())) {
+		return false;
+	}
+	for (quint32 i = 0; i < numEntries; i++) {
+		const char *entry = entries.constData() + i*8;
+		quint32 size = le32(entry + 4);
+		AviFrame frame;
+		frame.offset = baseOffset + le32(entry);
+		frame.size = size & ~NotKeyFrameBit;
+		frame.keyFrame = (size & NotKeyFrameBit) == 0;
+		m_frames.push_back(frame);
+	}
+	return true;
+}
+
+
+bool AviIndex::isVideoChunk(const char *chunkId) const {
+	return chunkId[0] == '0' + m_videoStream / 10 &&
+				chunkId[1] == '0' + m_videoStream % 10 &&
+				chunkId[2] == 'd' && (chunkId[3] == 'c' || chunkId[3] == 'b');
+}
@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * File:			  aviindex.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef AVIINDEX_H
+#define AVIINDEX_H
+
+#include "globals.hpp"
+
+#include <QFile>
+
+#include <vector>
+
+
+struct AviFrame {
+	qint64 offset;	//Start of the payload, behind the chunk header
+	qint32 size;
+	bool keyFrame;
+};
+
+
+class AviIndex {
+	public:
+		explicit AviIndex(const QString &videoPath);
+		bool isValid() const {return m_valid;}
+		const std::vector<AviFrame> &frames() const {return m_frames;}
+		QString codec() const {return m_codec;}
+		int width() const {return m_width;}
+		int height() const {return m_height;}
+
+	private:
+		bool m_valid = false;
+		std::vector<AviFrame> m_frames;
+		QString m_codec;
+		int m_width = 0;
+		int m_height = 0;
+		int m_videoStream = -1;
+		std::vector<qint64> m_standardIndices;
+
+		bool parse(QFile &file);
+		void parseHeaderList(QFile &file, qint64 begin, qint64 end);
+		void parseStreamList(QFile &file, qint64 begin, qint64 end, int stream);
+		bool parseIdx1(QFile &file, qint64 begin, qint64 size, qint64 moviPos);
+		bool parseStandardIndex(QFile &file, qint64 position);
+		bool isVideoChunk(const char *chunkId) const;
+};
+
+#endif
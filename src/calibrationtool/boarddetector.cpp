@@ -0,0 +1,263 @@
+/*******************************************************************************
+ * File:			  boarddetector.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "boarddetector.hpp"
+
+#include <opencv2/aruco/charuco.hpp>
+
+#include <algorithm>
+
+
+BoardDetector::BoardDetector(CalibrationConfig *calibrationConfig,
+			BoardPrefilter *prefilter) : m_calibrationConfig(calibrationConfig),
+			m_prefilter(prefilter) {
+	m_charucoPattern = cv::Mat(cv::Size(m_calibrationConfig->patternWidth+1,
+				m_calibrationConfig->patternHeight+1), CV_32SC1);
+	m_charucoPattern = -1;
+	int id_count = 0;
+	for (int i = 0; i < m_calibrationConfig->patternWidth+1; i++) {
+		for (int j = 0; j < m_calibrationConfig->patternHeight+1; j++) {
+			if ((i+j)%2 != 0) {
+				m_charucoPattern.at<int>(j,i) = id_count;
+				id_count++;
+			}
+		}
+	}
+}
+
+
+bool BoardDetector::find(const cv::Mat &img,
+			std::vector<cv::Point2f> &corners) const {
+	//Called from several detector threads at once, all state is local
+	cv::Rect fullFrame(0, 0, img.cols, img.rows);
+	if (m_prefilter == nullptr) {
+		return detect(img, fullFrame, corners);
+	}
+	cv::Rect roi;
+	BoardPrefilter::Stage stage = m_prefilter->check(img, roi);
+	if (stage != BoardPrefilter::Passed) {
+		if (!m_prefilter->isAuditing()) {
+			return false;
+		}
+		bool patternFound = detect(img, fullFrame, corners);
+		if (patternFound) {
+			m_prefilter->reportMissedBoard(stage);
+		}
+		return patternFound;
+	}
+	bool patternFound = detect(img, roi, corners);
+	if (!patternFound && roi != fullFrame && m_prefilter->isAuditing()) {
+		patternFound = detect(img, fullFrame, corners);
+		if (patternFound) {
+			m_prefilter->reportRoiMiss();
+		}
+	}
+	return patternFound;
+}
+
+
+bool BoardDetector::detect(const cv::Mat &img, const cv::Rect &roi,
+			std::vector<cv::Point2f> &corners) const {
+	corners.clear();
+	cv::Mat crop = (roi.size() == img.size()) ? img : img(roi).clone();
+	cbdetect::Corner cbCorners;
+	std::vector<cbdetect::Board> boards;
+	cbdetect::Params params;
+	params.corner_type = cbdetect::SaddlePoint;
+	params.show_processing = false;
+	params.show_debug_image = false;
+	cbdetect::find_corners(crop, cbCorners, params);
+	bool patternFound = (cbCorners.p.size() >=
+				m_calibrationConfig->patternHeight *
+				m_calibrationConfig->patternWidth);
+
+	if (patternFound) {
+		cbdetect::boards_from_corners(crop, cbCorners, boards, params);
+		if (boards.size() == 1) {
+			patternFound = boardToCorners(boards[0], cbCorners, corners);
+		}
+		else {
+			patternFound = false;
+		}
+	}
+	if (!patternFound) {
+		corners.clear();
+		return false;
+	}
+	for (auto &corner : corners) {
+		corner += cv::Point2f(roi.x, roi.y);
+	}
+	return checkRotation(corners, img);
+}
+
+
+bool BoardDetector::checkRotation(std::vector<cv::Point2f> &corners,
+			const cv::Mat &img) const {
+	if (m_calibrationConfig->boardType == "Standard") {
+		int width = m_calibrationConfig->patternWidth;
+		int height = m_calibrationConfig->patternHeight;
+		cv::Point2i ctestd;
+		cv::Point2f p1 = corners[width*height-1];
+		cv::Point2f p2 = corners[width*height-2];
+		cv::Point2f p3 = corners[width*(height-1)-1];
+		cv::Point2f p4 = corners[width*(height-1)-2];
+		ctestd.x = (p1.x + p2.x + p3.x + p4.x) / 4;
+		ctestd.y = (p1.y + p2.y + p3.y + p4.y) / 4;
+
+		cv::Point2i ctestl;
+		p1 = corners[0];
+		p2 = corners[1];
+		p3 = corners[width];
+		p4 = corners[width+1];
+		ctestl.x = (p1.x + p2.x + p3.x + p4.x) / 4;
+		ctestl.y = (p1.y + p2.y + p3.y + p4.y) / 4;
+
+		cv::Vec3b colord = img.at<cv::Vec3b>(ctestd.y,ctestd.x);
+		int color_sum_d = colord[0]+colord[1]+colord[2];
+		cv::Vec3b colorl = img.at<cv::Vec3b>(ctestl.y,ctestl.x);
+		int color_sum_l = colorl[0]+colorl[1]+colorl[2];
+
+		if (color_sum_d > color_sum_l) {
+			std::reverse(corners.begin(),corners.end());
+		}
+		return true;
+	}
+	else {
+		cv::Ptr<cv::aruco::Dictionary> dictionary =
+					cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_50);
+		cv::Ptr<cv::aruco::CharucoBoard> board =
+					cv::aruco::CharucoBoard::create(7, 5, 0.04f, 0.02f, dictionary);
+		cv::Ptr<cv::aruco::DetectorParameters> params =
+					cv::aruco::DetectorParameters::create();
+
+		params->cornerRefinementMethod = cv::aruco::CORNER_REFINE_CONTOUR;
+		std::vector<int> markerIds;
+		std::vector<std::vector<cv::Point2f>> markerCorners;
+		cv::aruco::detectMarkers(img, board->dictionary, markerCorners, markerIds,
+					params);
+		if (markerIds.size() == 0) {
+			return false;
+		}
+
+		cv::Mat detectedPattern(m_charucoPattern.size(), CV_32SC1, cv::Scalar(-1));
+		for (int i = 0; i < markerCorners.size(); i++) {
+			cv::Point2i markerPosition = getPositionOfMarkerOnBoard(corners,
+						markerCorners[i]);
+			if (markerPosition.x != -1) {
+				detectedPattern.at<int>(markerPosition.y+1,markerPosition.x+1) =
+							markerIds[i];
+			}
+		}
+		int match = matchPattern(detectedPattern);
+		if (match == 0) {
+			return false;
+		}
+		else if (match == 2) {
+			std::reverse(corners.begin(),corners.end());
+		}
+		return true;
+	}
+}
+
+
+int BoardDetector::matchPattern(const cv::Mat &detectedPattern) const {
+	int unrotCount = 0;
+	int rotCount = 0;
+	for (int i = 0; i < m_calibrationConfig->patternWidth+1; i++) {
+		for (int j = 0; j < m_calibrationConfig->patternHeight+1; j++) {
+			if (m_charucoPattern.at<int>(j,i) != -1) {
+				if (m_charucoPattern.at<int>(j,i) == detectedPattern.at<int>(j,i)) {
+					unrotCount++;
+				}
+				if (m_charucoPattern.at<int>(j,i) ==
+							detectedPattern.at<int>(m_calibrationConfig->patternHeight-j,
+							m_calibrationConfig->patternWidth-i)) {
+					rotCount++;
+				}
+			}
+		}
+	}
+	if (unrotCount == rotCount) {
+		return 0;
+	}
+	else if (unrotCount > rotCount) {
+		return 1;
+	}
+	else {
+		return 2;
+	}
+}
+
+
+cv::Point2i BoardDetector::getPositionOfMarkerOnBoard(
+			const std::vector<cv::Point2f> &cornersBoard,
+			const std::vector<cv::Point2f> &markerCorners) const {
+	int width = m_calibrationConfig->patternWidth;
+	int height = m_calibrationConfig->patternHeight;
+	cv::Point2i position(-1, -1);
+	cv::Point2f markerCenter;
+	markerCenter.x = (markerCorners[0].x+markerCorners[2].x)/2;
+	markerCenter.y = (markerCorners[0].y+markerCorners[2].y)/2;
+	for (int i = 0; i < width-1; i++) {
+		for (int j = 0; j < height-1; j++) {
+			cv::Point2f p1 = cornersBoard[j*width+i];
+			cv::Point2f p2 = cornersBoard[(j+1)*width+(i+1)];
+
+			if (((p1.x < p2.x && markerCenter.x > p1.x && markerCenter.x < p2.x) ||
+						(p1.x > p2.x && markerCenter.x < p1.x && markerCenter.x > p2.x)) &&
+						((p1.y < p2.y && markerCenter.y > p1.y && markerCenter.y < p2.y) ||
+						(p1.y > p2.y && markerCenter.y < p1.y && markerCenter.y > p2.y))) {
+				position.x = i;
+				position.y = height-2-j;
+			}
+		}
+	}
+	return position;
+}
+
+
+bool BoardDetector::boardToCorners(const cbdetect::Board &board,
+			const cbdetect::Corner &cbCorners,
+			std::vector<cv::Point2f> &corners) const {
+	if (board.idx.size()-2 == m_calibrationConfig->patternHeight) {
+		for (int i = 1; i < board.idx.size() - 1; ++i) {
+			if (board.idx[i].size()-2 == m_calibrationConfig->patternWidth) {
+				for (int j = 1; j < board.idx[i].size() - 1; ++j) {
+					if (board.idx[i][j] < 0 || board.idx[i][j] >= cbCorners.p.size()) {
+						return false;
+					}
+					corners.push_back(static_cast<cv::Point2f>(
+								cbCorners.p[board.idx[i][j]]));
+				}
+			}
+			else {
+				return false;
+			}
+		}
+	}
+	else {
+		for (int j = 1; j < board.idx[0].size() - 1; ++j) {
+			for (int i = 1; i < board.idx.size() - 1; ++i) {
+				int row = board.idx.size() - 1 - i;
+				if (board.idx.size()-2 == m_calibrationConfig->patternWidth &&
+							board.idx[i].size()-2 == m_calibrationConfig->patternHeight) {
+					if (board.idx[row][j] < 0 || board.idx[row][j] >= cbCorners.p.size()) {
+						return false;
+					}
+					corners.push_back(static_cast<cv::Point2f>(
+								cbCorners.p[board.idx[row][j]]));
+				}
+				else {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
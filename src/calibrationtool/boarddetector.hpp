@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * File:			  boarddetector.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef BOARDDETECTOR_H
+#define BOARDDETECTOR_H
+
+#include "globals.hpp"
+#include "boardprefilter.hpp"
+
+#include "boards_from_corners.h"
+#include "config.h"
+#include "find_corners.h"
+
+#include "opencv2/core.hpp"
+
+#include <vector>
+
+
+class BoardDetector {
+	public:
+		//Detector name in the detection cache key, every calibrator finding
+		//checkerboard corners goes through this class
+		static constexpr const char *Name = "cbdetect";
+
+		explicit BoardDetector(CalibrationConfig *calibrationConfig,
+					BoardPrefilter *prefilter = nullptr);
+		bool find(const cv::Mat &img, std::vector<cv::Point2f> &corners) const;
+
+	private:
+		CalibrationConfig *m_calibrationConfig;
+		BoardPrefilter *m_prefilter;
+		cv::Mat m_charucoPattern;
+
+		bool detect(const cv::Mat &img, const cv::Rect &roi,
+					std::vector<cv::Point2f> &corners) const;
+		bool checkRotation(std::vector<cv::Point2f> &corners,
+					const cv::Mat &img) const;
+		cv::Point2i getPositionOfMarkerOnBoard(
+					const std::vector<cv::Point2f> &cornersBoard,
+					const std::vector<cv::Point2f> &markerCorners) const;
+		int matchPattern(const cv::Mat &detectedPattern) const;
+		bool boardToCorners(const cbdetect::Board &board,
+					const cbdetect::Corner &cbCorners,
+					std::vector<cv::Point2f> &corners) const;
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * File:			  boardprefilter.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "boardprefilter.hpp"
+
+#include "opencv2/imgproc.hpp"
+#include "opencv2/calib3d.hpp"
+#include <opencv2/aruco.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+
+BoardPrefilter::BoardPrefilter(CalibrationConfig *calibrationConfig) :
+			m_calibrationConfig(calibrationConfig) {
+}
+
+
+BoardPrefilter::Stage BoardPrefilter::check(const cv::Mat &img, cv::Rect &roi) {
+	m_frames++;
+	roi = cv::Rect(0, 0, img.cols, img.rows);
+	cv::Mat gray;
+	if (img.channels() == 3) {
+		cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+	}
+	else {
+		gray = img;
+	}
+	double scale = std::min(1.0, m_calibrationConfig->prefilterWidth /
+				static_cast<double>(img.cols));
+	cv::Mat small;
+	cv::resize(gray, small, cv::Size(), scale, scale, cv::INTER_AREA);
+
+	if (m_calibrationConfig->prefilterBlurThreshold > 0) {
+		//Variance of the Laplacian, motion blur wipes out the board edges first
+		cv::Mat laplacian;
+		cv::Laplacian(small, laplacian, CV_16S);
+		cv::Scalar mean, stddev;
+		cv::meanStdDev(laplacian, mean, stddev);
+		if (stddev[0]*stddev[0] < m_calibrationConfig->prefilterBlurThreshold) {
+			m_blurRejected++;
+			return Blur;
+		}
+	}
+
+	cv::Rect smallRoi;
+	if (!findPresence(small, smallRoi)) {
+		m_presenceRejected++;
+		return Presence;
+	}
+	if (!smallRoi.empty()) {
+		roi = cv::Rect(smallRoi.x / scale, smallRoi.y / scale,
+					smallRoi.width / scale, smallRoi.height / scale) &
+					cv::Rect(0, 0, img.cols, img.rows);
+		m_roiFound++;
+	}
+	return Passed;
+}
+
+
+bool BoardPrefilter::findPresence(const cv::Mat &small, cv::Rect &roi) {
+	int width = m_calibrationConfig->patternWidth;
+	int height = m_calibrationConfig->patternHeight;
+	if (m_calibrationConfig->boardType == "Standard") {
+		cv::Size patternSize(width, height);
+		if (!cv::checkChessboard(small, patternSize)) {
+			return false;
+		}
+		std::vector<cv::Point2f> corners;
+		if (m_calibrationConfig->prefilterRoi && cv::findChessboardCorners(small,
+					patternSize, corners, cv::CALIB_CB_ADAPTIVE_THRESH |
+					cv::CALIB_CB_NORMALIZE_IMAGE)) {
+			//The outer corners cbdetect needs sit one square beyond the inner ones
+			cv::Rect box = cv::boundingRect(corners);
+			int square = std::max(box.width / std::max(1, width-1),
+						box.height / std::max(1, height-1));
+			roi = box + cv::Size(4*square, 4*square) - cv::Point(2*square, 2*square);
+		}
+		return true;
+	}
+	else {
+		//checkRotation() rejects ChAruco boards without a single marker anyway
+		cv::Ptr<cv::aruco::Dictionary> dictionary =
+					cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_50);
+		std::vector<int> markerIds;
+		std::vector<std::vector<cv::Point2f>> markerCorners;
+		cv::aruco::detectMarkers(small, dictionary, markerCorners, markerIds);
+		if (markerIds.size() == 0) {
+			return false;
+		}
+		if (m_calibrationConfig->prefilterRoi) {
+			std::vector<cv::Point2f> points;
+			double markerSide = 0;
+			for (const auto &marker : markerCorners) {
+				points.insert(points.end(), marker.begin(), marker.end());
+				markerSide += cv::norm(marker[0] - marker[2]) / std::sqrt(2.0);
+			}
+			int pad = 2*markerSide / markerCorners.size();
+			roi = cv::boundingRect(points) + cv::Size(2*pad, 2*pad) -
+						cv::Point(pad, pad);
+		}
+		return true;
+	}
+}
+
+
+void BoardPrefilter::reportMissedBoard(Stage stage) {
+	if (stage == Blur) {
+		m_blurMissed++;
+	}
+	else if (stage == Presence) {
+		m_presenceMissed++;
+	}
+}
+
+
+void BoardPrefilter::reportRoiMiss() {
+	m_roiMissed++;
+}
+
+
+void BoardPrefilter::printStats(const std::string &name) const {
+	int frames = m_frames;
+	int blurRejected = m_blurRejected;
+	int presenceRejected = m_presenceRejected;
+	std::cout << name << ": Prefilter checked " << frames << " frames, blur "
+						<< "rejected " << blurRejected << ", presence rejected "
+						<< presenceRejected << ", " << frames - blurRejected - presenceRejected
+						<< " passed (" << m_roiFound << " with ROI)" << std::endl;
+	if (isAuditing()) {
+		std::cout << name << ": Prefilter audit, boards lost to blur check "
+							<< m_blurMissed << ", to presence check " << m_presenceMissed
+							<< ", to ROI " << m_roiMissed << std::endl;
+	}
+}
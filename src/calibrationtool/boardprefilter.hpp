@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * File:			  boardprefilter.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef BOARDPREFILTER_H
+#define BOARDPREFILTER_H
+
+#include "globals.hpp"
+
+#include "opencv2/core.hpp"
+
+#include <atomic>
+#include <string>
+
+
+class BoardPrefilter {
+	public:
+		enum Stage {
+			Passed,
+			Blur,
+			Presence
+		};
+
+		explicit BoardPrefilter(CalibrationConfig *calibrationConfig);
+		Stage check(const cv::Mat &img, cv::Rect &roi);
+		bool isAuditing() const {return m_calibrationConfig->prefilterAudit;}
+		void reportMissedBoard(Stage stage);
+		void reportRoiMiss();
+		void printStats(const std::string &name) const;
+
+	private:
+		CalibrationConfig *m_calibrationConfig;
+		std::atomic<int> m_frames {0};
+		std::atomic<int> m_blurRejected {0};
+		std::atomic<int> m_presenceRejected {0};
+		std::atomic<int> m_roiFound {0};
+		//Only counted when auditing, rejected frames on which the full detector
+		//still found a board
+		std::atomic<int> m_blurMissed {0};
+		std::atomic<int> m_presenceMissed {0};
+		std::atomic<int> m_roiMissed {0};
+
+		bool findPresence(const cv::Mat &small, cv::Rect &roi);
+};
+
+#endif
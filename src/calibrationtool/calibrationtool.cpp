@@ -14,6 +14,7 @@
 #include <sys/types.h>
 
 #include <QThreadPool>
+#include <QThread>
 #include <QDir>
 
 
@@ -23,6 +24,13 @@ CalibrationTool::CalibrationTool(CalibrationConfig *calibrationConfig) :
 
 
 void CalibrationTool::makeCalibrationSet()  {
+  if (m_runningJobs > 0) {
+    //Calibrators of a canceled run still use the detection store, the new
+    //run starts once the last of them has returned
+    m_startPending = true;
+    return;
+  }
+  m_startPending = false;
 	m_intrinsicParameters.clear();
 	m_extrinsicParameters.clear();
 	QDir dir;
@@ -33,60 +41,101 @@ void CalibrationTool::makeCalibrationSet()  {
   m_calibrationCanceled = false;
   m_intrinsicsReproErrors.clear();
   m_extrinsicsReproErrors.clear();
+  m_pairLaunched.fill(false, m_calibrationConfig->cameraPairs.size());
   if (!m_calibrationConfig->seperateIntrinsics) {
     m_calibrationConfig->intrinsicsPath = m_calibrationConfig->extrinsicsPath;
   }
-  QThreadPool *threadPool = QThreadPool::globalInstance();
+  //The calibrators only decode, the detection of all cameras shares this pool
+  m_detectorPool.reset(new QThreadPool());
+  m_detectorPool->setMaxThreadCount(
+        m_calibrationConfig->detectionThreads > 0 ?
+        m_calibrationConfig->detectionThreads : QThread::idealThreadCount());
+  //Every video frame is detected at most once per calibration, no matter
+  //how many intrinsics and pair calibrations look at it
+  m_detectionStore.reset(new DetectionStore(m_calibrationConfig));
   int thread = 0;
 	for (const auto& cam : m_calibrationConfig->cameraNames) {
 		IntrinsicsCalibrator *intrinsicsCalibrator =
-          new IntrinsicsCalibrator(m_calibrationConfig, cam, thread++);
+          new IntrinsicsCalibrator(m_calibrationConfig, cam, thread++,
+          m_detectionStore.data(), m_detectorPool.data());
     connect(intrinsicsCalibrator, &IntrinsicsCalibrator::intrinsicsProgress,
             this, &CalibrationTool::intrinsicsProgress);
     connect(intrinsicsCalibrator, &IntrinsicsCalibrator::finishedIntrinsics,
             this, &CalibrationTool::finishedIntrinsicsSlot);
-    connect(intrinsicsCalibrator, &IntrinsicsCalibrator::calibrationError,
-            this, &CalibrationTool::calibrationErrorSlot);
-    connect(this, &CalibrationTool::calibrationCanceled,
-            intrinsicsCalibrator,
-            &IntrinsicsCalibrator::calibrationCanceledSlot);
-		threadPool->start(intrinsicsCalibrator);
+    startJob(intrinsicsCalibrator);
 	}
-  while (!threadPool->waitForDone(10)) {
-    QCoreApplication::instance()->processEvents();
+  //Pairs are launched from finishedIntrinsicsSlot() as soon as all of their
+  //cameras are calibrated, completion is reported from jobFinishedSlot()
+  if (m_runningJobs == 0) {
+    checkCalibrationDone();
   }
-	while (m_intrinsicParameters.size() != m_calibrationConfig->cameraNames.size() && !m_calibrationCanceled) {
-		QCoreApplication::instance()->processEvents();
-	}
+}
+
+
+template <typename Calibrator>
+void CalibrationTool::startJob(Calibrator *calibrator) {
+  connect(calibrator, &Calibrator::calibrationError,
+          this, &CalibrationTool::calibrationErrorSlot);
+  connect(this, &CalibrationTool::calibrationCanceled,
+          calibrator, &Calibrator::calibrationCanceledSlot);
+  //The pool deletes the calibrator once run() returns, on success, error
+  //and cancellation alike. Being emitted after all of the calibrator's
+  //other signals, this arrives last in our queue
+  connect(calibrator, &QObject::destroyed,
+          this, &CalibrationTool::jobFinishedSlot);
+  m_runningJobs++;
+  QThreadPool::globalInstance()->start(calibrator);
+}
+
+
+void CalibrationTool::launchReadyPairs() {
   if (m_calibrationCanceled) return;
-  threadPool->clear();
-  thread = 0;
-  for (const auto & pair : m_calibrationConfig->cameraPairs) {
+  for (int i = 0; i < m_calibrationConfig->cameraPairs.size(); i++) {
+    const QList<QString> &pair = m_calibrationConfig->cameraPairs[i];
+    if (m_pairLaunched[i]) continue;
+    bool ready = true;
+    for (const auto &cam : pair) {
+      ready = ready && m_intrinsicParameters.contains(cam);
+    }
+    if (!ready) continue;
+    m_pairLaunched[i] = true;
     ExtrinsicsCalibrator *extrinsicsCalibrator =
-          new ExtrinsicsCalibrator(m_calibrationConfig, m_intrinsicParameters, pair, thread++);
+          new ExtrinsicsCalibrator(m_calibrationConfig, m_intrinsicParameters, pair, i,
+          m_detectionStore.data());
     connect(extrinsicsCalibrator, &ExtrinsicsCalibrator::extrinsicsProgress,
             this, &CalibrationTool::extrinsicsProgress);
     connect(extrinsicsCalibrator, &ExtrinsicsCalibrator::finishedExtrinsics,
             this, &CalibrationTool::finishedExtrinsicsSlot);
-    connect(extrinsicsCalibrator, &ExtrinsicsCalibrator::calibrationError,
-            this, &CalibrationTool::calibrationErrorSlot);
-    connect(this, &CalibrationTool::calibrationCanceled,
-            extrinsicsCalibrator,
-            &ExtrinsicsCalibrator::calibrationCanceledSlot);
+    startJob(extrinsicsCalibrator);
+  }
+}
 
-    threadPool->start(extrinsicsCalibrator);
+
+void CalibrationTool::checkCalibrationDone() {
+  if (m_calibrationCanceled) return;
+  for (int i = 0; i < m_pairLaunched.size(); i++) {
+    if (!m_pairLaunched[i]) {
+      //All intrinsics returned but one of this pair's cameras without result
+      const QList<QString> &pair = m_calibrationConfig->cameraPairs[i];
+      calibrationErrorSlot("Camera pair [" + pair.join(", ") + "] could not be "
+            "calibrated, intrinsics are missing.");
+      return;
+    }
   }
-  while (!threadPool->waitForDone(10)) {
-    QCoreApplication::instance()->processEvents();
+  emit calibrationFinished();
+  saveCalibration();
+}
+
+
+void CalibrationTool::jobFinishedSlot() {
+  m_runningJobs--;
+  if (m_runningJobs > 0) return;
+  if (m_startPending) {
+    makeCalibrationSet();
   }
-	while (m_extrinsicParameters.size() != m_calibrationConfig->cameraPairs.size() && !m_calibrationCanceled) {
-		QCoreApplication::instance()->processEvents();
-	}
-  if (!m_calibrationCanceled) {
-    emit calibrationFinished();
+  else {
+    checkCalibrationDone();
   }
-
-  saveCalibration();
 }
 
 
@@ -115,6 +164,7 @@ void CalibrationTool::finishedIntrinsicsSlot(cv::Mat K, cv::Mat D, double reproE
 	intrinsics["K"] = K;
 	intrinsics["D"] = D;
 	m_intrinsicParameters[m_calibrationConfig->cameraNames[threadNumber]] = intrinsics;
+  launchReadyPairs();
 }
 
 
@@ -136,7 +186,10 @@ void CalibrationTool::cancelCalibrationSlot() {
 
 void CalibrationTool::calibrationErrorSlot(const QString &errorMsg) {
   if(!m_calibrationCanceled) {
+    //Stop the remaining jobs, once they are done checkCalibrationDone() sees
+    //the flag and neither reports success nor saves a partial calibration
     m_calibrationCanceled = true;
+    emit calibrationCanceled();
     emit calibrationError(errorMsg);
   }
 }
@@ -13,6 +13,10 @@
 #include "globals.hpp"
 #include "intrinsicscalibrator.hpp"
 #include "extrinsicscalibrator.hpp"
+#include "detectioncache.hpp"
+
+#include <QScopedPointer>
+#include <QThreadPool>
 
 #include "opencv2/core.hpp"
 #include "opencv2/imgproc.hpp"
@@ -48,6 +52,9 @@ class CalibrationTool : public QObject {
 
   private:
 		void saveCalibration();
+		template <typename Calibrator> void startJob(Calibrator *calibrator);
+		void launchReadyPairs();
+		void checkCalibrationDone();
 
     CalibrationConfig *m_calibrationConfig;
 		QMap<int, double> m_intrinsicsReproErrors;
@@ -55,11 +62,17 @@ class CalibrationTool : public QObject {
 		QMap<QString, QMap<QString, cv::Mat>> m_intrinsicParameters;
 		QMap<QString, QMap<QString, cv::Mat>> m_extrinsicParameters;
 		bool m_calibrationCanceled = false;
+		QScopedPointer<DetectionStore> m_detectionStore;
+		QScopedPointer<QThreadPool> m_detectorPool;
+		QList<bool> m_pairLaunched;
+		int m_runningJobs = 0;	//Calibrators started and not yet returned
+		bool m_startPending = false;
 
 	private slots:
 		void finishedIntrinsicsSlot(cv::Mat K, cv::Mat D, double reproError, int threadNumber);
 		void finishedExtrinsicsSlot(cv::Mat R, cv::Mat T, double reproError, int threadNumber);
 		void calibrationErrorSlot(const QString &errorMsg);
+		void jobFinishedSlot();
 };
 
 
@@ -0,0 +1,234 @@
+/*******************************************************************************
+ * File:			  detectioncache.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "detectioncache.hpp"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+
+static const quint32 CacheMagic = 0x4a434244;	//"JCBD"
+static const qint32 CacheVersion = 1;
+//Written out every so often so a crashed run keeps most of its detections
+static const int SaveInterval = 250;
+
+
+DetectionCache::DetectionCache(const QString &videoPath, const QString &boardKey,
+			const QString &cacheDir, bool persistent) {
+	QFileInfo videoInfo(videoPath);
+	m_videoSize = videoInfo.size();
+	m_videoMTime = videoInfo.lastModified().toMSecsSinceEpoch();
+	if (!persistent) {
+		//Only shared within the running calibration
+		return;
+	}
+	QString dir = (cacheDir == "") ? defaultCacheDir() : cacheDir;
+	QDir().mkpath(dir);
+	QString key = QCryptographicHash::hash(
+				(videoInfo.absoluteFilePath() + "|" + boardKey).toUtf8(),
+				QCryptographicHash::Sha1).toHex();
+	m_cachePath = dir + "/" + key + ".det";
+	load();
+}
+
+
+DetectionCache::~DetectionCache() {
+	save();
+}
+
+
+QString DetectionCache::defaultCacheDir() {
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+				"/boarddetections";
+}
+
+
+QString DetectionCache::boardKey(CalibrationConfig *calibrationConfig,
+			const QString &detector) {
+	//Everything that changes what a detection on a given frame looks like
+	QStringList fields = {detector, calibrationConfig->boardType,
+				QString::number(calibrationConfig->patternWidth),
+				QString::number(calibrationConfig->patternHeight)};
+	if (detector != "cbdetect") {
+		fields << QString::number(calibrationConfig->charucoPatternIdx)
+					 << QString::number(calibrationConfig->patternSize);
+	}
+	if (detector == "charuco") {
+		fields << QString::number(calibrationConfig->patternSideLength)
+					 << QString::number(calibrationConfig->markerSideLength);
+	}
+	else if (detector == "cbdetect" && calibrationConfig->boardPrefilter &&
+				!calibrationConfig->prefilterAudit) {
+		//Frames the prefilter rejects are recorded as holding no board
+		fields << "prefilter"
+					 << QString::number(calibrationConfig->prefilterBlurThreshold)
+					 << QString::number(calibrationConfig->prefilterWidth)
+					 << QString::number(calibrationConfig->prefilterRoi);
+	}
+	return fields.join(",");
+}
+
+
+bool DetectionCache::lookup(int frameNumber, Detection &detection) const {
+	QMutexLocker locker(&m_mutex);
+	auto it = m_detections.constFind(frameNumber);
+	if (it == m_detections.constEnd()) {
+		return false;
+	}
+	detection = it.value();
+	return true;
+}
+
+
+bool DetectionCache::acquire(int frameNumber, Detection &detection) {
+	//A frame another thread is detecting on right now is waited for instead of
+	//being detected twice. Frames the calling thread still has in flight are
+	//not, that would never return.
+	QMutexLocker locker(&m_mutex);
+	while (m_claimed.contains(frameNumber) &&
+				m_claimed[frameNumber] != QThread::currentThread()) {
+		m_inserted.wait(&m_mutex);
+	}
+	auto it = m_detections.constFind(frameNumber);
+	if (it != m_detections.constEnd()) {
+		detection = it.value();
+		return true;
+	}
+	m_claimed[frameNumber] = QThread::currentThread();
+	return false;
+}
+
+
+void DetectionCache::release(int frameNumber) {
+	QMutexLocker locker(&m_mutex);
+	m_claimed.remove(frameNumber);
+	m_inserted.wakeAll();
+}
+
+
+void DetectionCache::insert(int frameNumber, const Detection &detection) {
+	{
+		QMutexLocker locker(&m_mutex);
+		m_detections[frameNumber] = detection;
+		m_claimed.remove(frameNumber);
+		m_inserted.wakeAll();
+		m_unsaved++;
+		if (m_unsaved < SaveInterval) {
+			return;
+		}
+	}
+	save();
+}
+
+
+int DetectionCache::size() const {
+	QMutexLocker locker(&m_mutex);
+	return m_detections.size();
+}
+
+
+bool DetectionCache::save() {
+	QMutexLocker locker(&m_mutex);
+	if (m_unsaved == 0 || m_cachePath == "") {
+		return true;
+	}
+	QSaveFile file(m_cachePath);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	QDataStream out(&file);
+	out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+	out << CacheMagic << CacheVersion << m_videoSize << m_videoMTime
+			<< static_cast<qint64>(m_detections.size());
+	for (auto it = m_detections.constBegin(); it != m_detections.constEnd(); ++it) {
+		const Detection &detection = it.value();
+		out << static_cast<qint32>(it.key()) << detection.found
+				<< static_cast<quint32>(detection.corners.size());
+		for (const auto &corner : detection.corners) {
+			out << corner.x << corner.y;
+		}
+		out << static_cast<quint32>(detection.ids.size());
+		for (const auto &id : detection.ids) {
+			out << static_cast<qint32>(id);
+		}
+	}
+	if (!file.commit()) {
+		return false;
+	}
+	m_unsaved = 0;
+	return true;
+}
+
+
+void DetectionCache::load() {
+	QFile file(m_cachePath);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	QDataStream in(&file);
+	in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+	quint32 magic;
+	qint32 version;
+	qint64 videoSize, videoMTime, count;
+	in >> magic >> version >> videoSize >> videoMTime >> count;
+	if (in.status() != QDataStream::Ok || magic != CacheMagic ||
+				version != CacheVersion || videoSize != m_videoSize ||
+				videoMTime != m_videoMTime) {
+		//Stale cache, the video changed since the detections were made
+		return;
+	}
+	QMap<int, Detection> detections;
+	for (qint64 i = 0; i < count; i++) {
+		qint32 frameNumber;
+		quint32 numCorners, numIds;
+		Detection detection;
+		in >> frameNumber >> detection.found >> numCorners;
+		for (quint32 j = 0; j < numCorners && in.status() == QDataStream::Ok; j++) {
+			cv::Point2f corner;
+			in >> corner.x >> corner.y;
+			detection.corners.push_back(corner);
+		}
+		in >> numIds;
+		for (quint32 j = 0; j < numIds && in.status() == QDataStream::Ok; j++) {
+			qint32 id;
+			in >> id;
+			detection.ids.push_back(id);
+		}
+		if (in.status() != QDataStream::Ok) {
+			return;
+		}
+		detections[frameNumber] = detection;
+	}
+	m_detections = detections;
+}
+
+
+DetectionStore::DetectionStore(CalibrationConfig *calibrationConfig) :
+			m_calibrationConfig(calibrationConfig) {
+}
+
+
+QSharedPointer<DetectionCache> DetectionStore::cache(const QString &videoPath,
+			const QString &detector) {
+	QString boardKey = DetectionCache::boardKey(m_calibrationConfig, detector);
+	QString key = QFileInfo(videoPath).absoluteFilePath() + "|" + boardKey;
+	QMutexLocker locker(&m_mutex);
+	if (!m_caches.contains(key)) {
+		m_caches[key] = QSharedPointer<DetectionCache>(new DetectionCache(
+					videoPath, boardKey, m_calibrationConfig->detectionCachePath,
+					m_calibrationConfig->useDetectionCache));
+	}
+	return m_caches[key];
+}
@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * File:			  detectioncache.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef DETECTIONCACHE_H
+#define DETECTIONCACHE_H
+
+#include "globals.hpp"
+
+#include "opencv2/core.hpp"
+
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <vector>
+
+
+class DetectionCache {
+	public:
+		struct Detection {
+			bool found = false;	//False records that the frame holds no usable board
+			std::vector<cv::Point2f> corners;
+			std::vector<int> ids;	//Only set for ChArUco corners
+		};
+
+		explicit DetectionCache(const QString &videoPath, const QString &boardKey,
+					const QString &cacheDir = "", bool persistent = true);
+		~DetectionCache();
+		bool lookup(int frameNumber, Detection &detection) const;
+		bool acquire(int frameNumber, Detection &detection);
+		void release(int frameNumber);
+		void insert(int frameNumber, const Detection &detection);
+		bool save();
+		int size() const;
+		static QString boardKey(CalibrationConfig *calibrationConfig,
+					const QString &detector);
+		static QString defaultCacheDir();
+
+	private:
+		QString m_cachePath;
+		qint64 m_videoSize = 0;
+		qint64 m_videoMTime = 0;
+		QMap<int, Detection> m_detections;
+		QMap<int, QThread*> m_claimed;	//Frames being detected and by whom
+		int m_unsaved = 0;
+		mutable QMutex m_mutex;
+		QWaitCondition m_inserted;
+
+		void load();
+};
+
+
+class DetectionStore {
+	public:
+		explicit DetectionStore(CalibrationConfig *calibrationConfig);
+		QSharedPointer<DetectionCache> cache(const QString &videoPath,
+					const QString &detector);
+
+	private:
+		CalibrationConfig *m_calibrationConfig;
+		QMap<QString, QSharedPointer<DetectionCache>> m_caches;
+		QMutex m_mutex;
+};
+
+#endif
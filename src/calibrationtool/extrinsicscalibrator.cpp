@@ -8,6 +8,10 @@
  ******************************************************************************/
 
 #include "extrinsicscalibrator.hpp"
+#include "seekindex.hpp"
+#include "boardprefilter.hpp"
+#include "boarddetector.hpp"
+#include "detectioncache.hpp"
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -18,10 +22,11 @@
 
 ExtrinsicsCalibrator::ExtrinsicsCalibrator(CalibrationConfig *calibrationConfig,
       QMap<QString, QMap<QString, cv::Mat>> intrinsicParameters,
-			QList<QString> cameraPair, int threadNumber) :
+			QList<QString> cameraPair, int threadNumber,
+			DetectionStore *detectionStore) :
       m_calibrationConfig(calibrationConfig),
 			m_intrinsicParameters(intrinsicParameters), m_cameraPair(cameraPair),
-      m_threadNumber(threadNumber) {
+      m_threadNumber(threadNumber), m_detectionStore(detectionStore) {
   QDir dir;
   // dir.mkpath(m_calibrationConfig->calibrationSetPath + "/" +
   //            m_calibrationConfig->calibrationSetName + "/Intrinsics");
@@ -40,21 +45,11 @@ ExtrinsicsCalibrator::ExtrinsicsCalibrator(CalibrationConfig *calibrationConfig,
   }
   m_parametersSavePath = (m_calibrationConfig->calibrationSetPath + "/" +
         m_calibrationConfig->calibrationSetName).toStdString();
-
-  m_charucoPattern = cv::Mat(cv::Size( m_calibrationConfig->patternWidth+1,
-        m_calibrationConfig->patternHeight+1), CV_32SC1);
-  m_detectedPattern = cv::Mat(cv::Size( m_calibrationConfig->patternWidth+1,
-        m_calibrationConfig->patternHeight+1), CV_32SC1);
-  m_charucoPattern = -1;
-  int id_count = 0;
-  for (int i = 0; i < m_calibrationConfig->patternWidth+1; i++) {
-    for (int j = 0; j <  m_calibrationConfig->patternHeight+1; j++) {
-      if ((i+j)%2 != 0) {
-        m_charucoPattern.at<int>(j,i) = id_count;
-        id_count++;
-      }
-    }
+  if (m_calibrationConfig->boardPrefilter) {
+    m_prefilter.reset(new BoardPrefilter(m_calibrationConfig));
   }
+  m_boardDetector.reset(new BoardDetector(m_calibrationConfig,
+        m_prefilter.data()));
 }
 
 
@@ -165,39 +160,43 @@ bool ExtrinsicsCalibrator::calibrateExtrinsicsPair(QList<QString> cameraPair,
   std::vector<std::vector<cv::Point3f>> objectPointsAll, objectPoints;
   std::vector<std::vector<cv::Point2f>> imagePointsAll1, imagePointsAll2,
                                         imagePoints1, imagePoints2;
-  std::vector<cv::Point2f> corners1, corners2;
 	cv::Size size;
-  std::vector<cbdetect::Board> boards1, boards2;
-  cbdetect::Params params;
-  params.corner_type = cbdetect::SaddlePoint;
-  params.show_processing = false;
-  params.show_debug_image = false;
 	int iteration = 0;
 	int skipIndex;
 
+	//Shared with the intrinsics and all other pairs on the same videos
+	QSharedPointer<DetectionCache> detectionCache1 = m_detectionStore->cache(
+				QString::fromStdString(cap1Path), BoardDetector::Name);
+	QSharedPointer<DetectionCache> detectionCache2 = m_detectionStore->cache(
+				QString::fromStdString(cap2Path), BoardDetector::Name);
+
 	while (objectPointsAll.size() < m_calibrationConfig->framesForExtrinsics) {
 		cv::VideoCapture cap1(cap1Path);
 	  cv::VideoCapture cap2(cap2Path);
+		QSharedPointer<SeekIndex> seekIndex1 = SeekIndex::open(
+					QString::fromStdString(cap1Path));
+		QSharedPointer<SeekIndex> seekIndex2 = SeekIndex::open(
+					QString::fromStdString(cap2Path));
 		int frameCount = cap1.get(cv::CAP_PROP_FRAME_COUNT);
 		if (iteration == 0) {
 			skipIndex = frameCount/(m_calibrationConfig->framesForExtrinsics*1.5);
 			skipIndex = std::max(1, skipIndex-skipIndex%4);
 		}
 		else if (iteration% 2 == 1 && iteration < 4 && skipIndex > 1) {
-			cap1.set(cv::CAP_PROP_POS_FRAMES, skipIndex/2);
-			cap2.set(cv::CAP_PROP_POS_FRAMES, skipIndex/2);
+			seekIndex1->seek(&cap1, skipIndex/2);
+			seekIndex2->seek(&cap2, skipIndex/2);
 		}
 		else if (iteration == 2 && skipIndex > 3) {
-			cap1.set(cv::CAP_PROP_POS_FRAMES, skipIndex/4);
-			cap2.set(cv::CAP_PROP_POS_FRAMES, skipIndex/4);
+			seekIndex1->seek(&cap1, skipIndex/4);
+			seekIndex2->seek(&cap2, skipIndex/4);
 			skipIndex = skipIndex/2;
 		}
 		else if (iteration < 5) {
       imagePointsAll1.clear();
       imagePointsAll2.clear();
       objectPointsAll.clear();
-      cap1.set(cv::CAP_PROP_POS_FRAMES, 0);
-      cap2.set(cv::CAP_PROP_POS_FRAMES, 0);
+      seekIndex1->seek(&cap1, 0);
+      seekIndex2->seek(&cap2, 0);
       skipIndex = 5;
 		}
     else {
@@ -207,56 +206,41 @@ bool ExtrinsicsCalibrator::calibrateExtrinsicsPair(QList<QString> cameraPair,
 
 	  bool read_success = true;
 	  int counter = 0;
-	  cv::Mat img1,img2;
+	  size = cv::Size(cap1.get(cv::CAP_PROP_FRAME_WIDTH),
+	        cap1.get(cv::CAP_PROP_FRAME_HEIGHT));
 	  while (read_success && !m_interrupt) {
-	    bool read_success1 = cap1.read(img1);
-	    bool read_success2 = cap2.read(img2);
+	    bool read_success1 = cap1.grab();
+	    bool read_success2 = cap2.grab();
 	    read_success = read_success1 && read_success2;
 	    if (read_success) {
 	      int frameIndex = cap1.get(cv::CAP_PROP_POS_FRAMES);
-	      cap1.set(cv::CAP_PROP_POS_FRAMES, frameIndex+skipIndex);
-	      cap2.set(cv::CAP_PROP_POS_FRAMES, frameIndex+skipIndex);
-	      if (frameIndex > frameCount) read_success = false;
-	      corners1.clear();
-	      corners2.clear();
-	      size = img1.size();
-
-	      cbdetect::Corner cbCorners1, cbCorners2;
-	      cbdetect::find_corners(img1, cbCorners1, params);
-	      cbdetect::find_corners(img2, cbCorners2, params);
-
-	      bool patternFound1 = (cbCorners1.p.size() >=
-	                            m_calibrationConfig->patternHeight *
-	                            m_calibrationConfig->patternWidth);
-	      bool patternFound2 = (cbCorners2.p.size() >=
-	                            m_calibrationConfig->patternHeight *
-	                            m_calibrationConfig->patternWidth);
-
-	      if (patternFound1 && patternFound2) {
-	        cbdetect::boards_from_corners(img1, cbCorners1, boards1, params);
-	        cbdetect::boards_from_corners(img2, cbCorners2, boards2, params);
-	        if (boards1.size() == 1) {
-	          patternFound1 = boardToCorners(boards1[0], cbCorners1, corners1);
-	        }
-	        else {
-	          patternFound1 = false;
-	        }
-	        if (boards2.size() == 1) {
-	          patternFound2 = boardToCorners(boards2[0], cbCorners2, corners2);
-	        }
-	        else {
-	          patternFound2 = false;
-	        }
-	        if (patternFound1 && patternFound2 && checkRotation(corners1, img1) &&
-	              checkRotation(corners2, img2)) {
-	          if (m_calibrationConfig->debug) {
-	            saveCheckerboard(cameraPair, img1,img2,corners1,corners2,counter);
-	          }
-	          imagePointsAll1.push_back(corners1);
-	          imagePointsAll2.push_back(corners2);
-	          objectPointsAll.push_back(checkerBoardPoints);
+	      cv::Mat img1,img2;
+	      DetectionCache::Detection detection1, detection2;
+	      //The second view is only needed if the first one has a board, unless
+	      //the prefilter audit wants to see every frame
+	      read_success = detectView(cap1, detectionCache1.data(), frameIndex-1,
+	            img1, detection1, nullptr);
+	      if (read_success && (detection1.found || (!m_prefilter.isNull() &&
+	            m_prefilter->isAuditing()))) {
+	        read_success = detectView(cap2, detectionCache2.data(), frameIndex-1,
+	              img2, detection2, nullptr);
+	      }
+	      if (!img1.empty()) size = img1.size();
+	      if (detection1.found && detection2.found) {
+	        if (m_calibrationConfig->debug) {
+	          //Detections made by another calibrator come without the frame
+	          if (img1.empty()) cap1.retrieve(img1);
+	          if (img2.empty()) cap2.retrieve(img2);
+	          saveCheckerboard(cameraPair, img1,img2,detection1.corners,
+	                detection2.corners,counter);
 	        }
+	        imagePointsAll1.push_back(detection1.corners);
+	        imagePointsAll2.push_back(detection2.corners);
+	        objectPointsAll.push_back(checkerBoardPoints);
 	      }
+	      seekIndex1->seek(&cap1, frameIndex+skipIndex, frameIndex);
+	      seekIndex2->seek(&cap2, frameIndex+skipIndex, frameIndex);
+	      if (frameIndex > frameCount) read_success = false;
 	      emit extrinsicsProgress(counter*(skipIndex+1), frameCount,
 	            m_threadNumber);
 	      counter++;
@@ -267,6 +251,10 @@ bool ExtrinsicsCalibrator::calibrateExtrinsicsPair(QList<QString> cameraPair,
 	  if (m_interrupt) return false;
 	}
 
+  if (!m_prefilter.isNull()) {
+    m_prefilter->printStats((cameraPair[0] + "-" + cameraPair[1]).toStdString());
+  }
+
   if(objectPointsAll.size() < m_calibrationConfig->framesForExtrinsics) {
     emit calibrationError("Camera pair [" + cameraPair[0] + ", "
           + cameraPair[1] +  "]: Found only " +
@@ -315,6 +303,57 @@ bool ExtrinsicsCalibrator::calibrateExtrinsicsPair(QList<QString> cameraPair,
 }
 
 
+bool ExtrinsicsCalibrator::detectView(cv::VideoCapture &cap,
+      DetectionCache *detectionCache, int frameNumber, cv::Mat &img,
+      DetectionCache::Detection &detection,
+      cv::Ptr<cv::aruco::CharucoBoard> board) {
+  //Every frame is detected once per calibration run, by whichever calibrator
+  //gets to it first
+  if (detectionCache->acquire(frameNumber, detection)) {
+    return true;
+  }
+  if (!cap.retrieve(img)) {
+    detectionCache->release(frameNumber);
+    return false;
+  }
+  if (board) {
+    detection = detectCharuco(img, board);
+  }
+  else {
+    detection.found = m_boardDetector->find(img, detection.corners);
+    if (!detection.found) {
+      detection.corners.clear();
+    }
+  }
+  detectionCache->insert(frameNumber, detection);
+  return true;
+}
+
+
+DetectionCache::Detection ExtrinsicsCalibrator::detectCharuco(
+      const cv::Mat &img, cv::Ptr<cv::aruco::CharucoBoard> board) {
+  DetectionCache::Detection detection;
+  cv::Ptr<cv::aruco::DetectorParameters> charucoParams =
+        cv::aruco::DetectorParameters::create();
+  std::vector<int> markerIds;
+  std::vector<std::vector<cv::Point2f>> markerCorners;
+  cv::aruco::detectMarkers(img, board->dictionary, markerCorners, markerIds, charucoParams);
+  if (markerIds.size() > 5) {
+    std::vector<cv::Point2f> charucoCorners;
+    std::vector<int> charucoIds;
+    cv::aruco::interpolateCornersCharuco(markerCorners, markerIds, img, board,
+          charucoCorners, charucoIds);
+    if (charucoIds.size() > m_calibrationConfig->patternHeight - 1 &&
+        charucoIds.size() > m_calibrationConfig->patternWidth - 1) {
+      detection.found = true;
+      detection.corners = charucoCorners;
+      detection.ids = charucoIds;
+    }
+  }
+  return detection;
+}
+
+
 bool ExtrinsicsCalibrator::calibrateExtrinsicsPairCharuco(QList<QString> cameraPair,
       Extrinsics &e, double &mean_repro_error) {
 
@@ -330,11 +369,12 @@ bool ExtrinsicsCalibrator::calibrateExtrinsicsPairCharuco(QList<QString> cameraP
     dictionary = cv::aruco::getPredefinedDictionary(m_calibrationConfig->charucoPatternIdx);
   }
 
+  //Same board and detector parameters as the intrinsics, so both share one
+  //detection cache. The marker to square ratio moves the interpolated corners.
   cv::Ptr<cv::aruco::CharucoBoard> board =
   cv::aruco::CharucoBoard::create(m_calibrationConfig->patternWidth,
-  m_calibrationConfig->patternHeight, 0.04f, 0.02f, dictionary);
-  cv::Ptr<cv::aruco::DetectorParameters> charucoParams =
-  cv::aruco::DetectorParameters::create();
+  m_calibrationConfig->patternHeight, m_calibrationConfig->patternSideLength,
+        m_calibrationConfig->markerSideLength, dictionary);
 
   std::vector<cv::Point3f> checkerBoardPoints;
   for (int i = 0; i < m_calibrationConfig->patternHeight-1; i++)
@@ -375,29 +415,38 @@ bool ExtrinsicsCalibrator::calibrateExtrinsicsPairCharuco(QList<QString> cameraP
 	int iteration = 0;
 	int skipIndex;
 
+	QSharedPointer<DetectionCache> detectionCache1 = m_detectionStore->cache(
+				QString::fromStdString(cap1Path), "charuco");
+	QSharedPointer<DetectionCache> detectionCache2 = m_detectionStore->cache(
+				QString::fromStdString(cap2Path), "charuco");
+
 	while (objectPointsAll.size() < m_calibrationConfig->framesForExtrinsics) {
 		cv::VideoCapture cap1(cap1Path);
 	  cv::VideoCapture cap2(cap2Path);
+		QSharedPointer<SeekIndex> seekIndex1 = SeekIndex::open(
+					QString::fromStdString(cap1Path));
+		QSharedPointer<SeekIndex> seekIndex2 = SeekIndex::open(
+					QString::fromStdString(cap2Path));
 		int frameCount = cap1.get(cv::CAP_PROP_FRAME_COUNT);
 		if (iteration == 0) {
 			skipIndex = frameCount/(m_calibrationConfig->framesForExtrinsics*1.5);
 			skipIndex = std::max(1, skipIndex-skipIndex%4);
 		}
 		else if (iteration% 2 == 1 && iteration < 4 && skipIndex > 1) {
-			cap1.set(cv::CAP_PROP_POS_FRAMES, skipIndex/2);
-			cap2.set(cv::CAP_PROP_POS_FRAMES, skipIndex/2);
+			seekIndex1->seek(&cap1, skipIndex/2);
+			seekIndex2->seek(&cap2, skipIndex/2);
 		}
 		else if (iteration == 2 && skipIndex > 3) {
-			cap1.set(cv::CAP_PROP_POS_FRAMES, skipIndex/4);
-			cap2.set(cv::CAP_PROP_POS_FRAMES, skipIndex/4);
+			seekIndex1->seek(&cap1, skipIndex/4);
+			seekIndex2->seek(&cap2, skipIndex/4);
 			skipIndex = skipIndex/2;
 		}
 		else if (iteration < 5) {
       imagePointsAll1.clear();
       imagePointsAll2.clear();
       objectPointsAll.clear();
-      cap1.set(cv::CAP_PROP_POS_FRAMES, 0);
-      cap2.set(cv::CAP_PROP_POS_FRAMES, 0);
+      seekIndex1->seek(&cap1, 0);
+      seekIndex2->seek(&cap2, 0);
       skipIndex = 5;
 		}
     else {
@@ -407,42 +456,29 @@ bool ExtrinsicsCalibrator::calibrateExtrinsicsPairCharuco(QList<QString> cameraP
 
 	  bool read_success = true;
 	  int counter = 0;
-	  cv::Mat img1,img2;
+	  size = cv::Size(cap1.get(cv::CAP_PROP_FRAME_WIDTH),
+	        cap1.get(cv::CAP_PROP_FRAME_HEIGHT));
 	  while (read_success && !m_interrupt) {
-	    bool read_success1 = cap1.read(img1);
-	    bool read_success2 = cap2.read(img2);
+	    bool read_success1 = cap1.grab();
+	    bool read_success2 = cap2.grab();
 	    read_success = read_success1 && read_success2;
 	    if (read_success) {
 	      int frameIndex = cap1.get(cv::CAP_PROP_POS_FRAMES);
-	      cap1.set(cv::CAP_PROP_POS_FRAMES, frameIndex+skipIndex);
-	      cap2.set(cv::CAP_PROP_POS_FRAMES, frameIndex+skipIndex);
-	      if (frameIndex > frameCount) read_success = false;
-	      size = img1.size();
-
-        bool patternFound1 = false;
-        bool patternFound2 = false;
-
-        std::vector<int> markerIds1, markerIds2;
-        std::vector<std::vector<cv::Point2f>> markerCorners1, markerCorners2;
-        std::vector<cv::Point2f> charucoCorners1, charucoCorners2;
-        std::vector<int> charucoIds1,charucoIds2;
-        cv::aruco::detectMarkers(img1, board->dictionary, markerCorners1, markerIds1, charucoParams);
-        if (markerIds1.size() > 5) {
-             cv::aruco::interpolateCornersCharuco(markerCorners1, markerIds1, img1, board, charucoCorners1, charucoIds1);
-        if (charucoIds1.size() > m_calibrationConfig->patternHeight - 1 &&
-            charucoIds1.size() > m_calibrationConfig->patternWidth - 1) {
-                 cv::Scalar color = cv::Scalar(255, 0, 0);
-                 patternFound1 = true;
-             }
-         }
-         cv::aruco::detectMarkers(img2, board->dictionary, markerCorners2, markerIds2, charucoParams);
-          if (markerIds2.size() > 5) {
-              cv::aruco::interpolateCornersCharuco(markerCorners2, markerIds2, img2, board, charucoCorners2, charucoIds2);
-              if (charucoIds2.size() > m_calibrationConfig->patternHeight - 1 &&
-                  charucoIds2.size() > m_calibrationConfig->patternWidth - 1) {
-                  patternFound2 = true;
-              }
-          }
+	      cv::Mat img1,img2;
+	      DetectionCache::Detection detection1, detection2;
+	      read_success = detectView(cap1, detectionCache1.data(), frameIndex-1,
+	            img1, detection1, board);
+	      if (read_success && detection1.found) {
+	        read_success = detectView(cap2, detectionCache2.data(), frameIndex-1,
+	              img2, detection2, board);
+	      }
+	      if (!img1.empty()) size = img1.size();
+	      bool patternFound1 = detection1.found;
+	      bool patternFound2 = detection2.found;
+	      const std::vector<cv::Point2f> &charucoCorners1 = detection1.corners;
+	      const std::vector<cv::Point2f> &charucoCorners2 = detection2.corners;
+	      const std::vector<int> &charucoIds1 = detection1.ids;
+	      const std::vector<int> &charucoIds2 = detection2.ids;
 	      if (patternFound1 && patternFound2) {
           std::vector<cv::Point2f> commonCorners1, commonCorners2;
           std::vector<int> commonIds;
@@ -458,16 +494,16 @@ bool ExtrinsicsCalibrator::calibrateExtrinsicsPairCharuco(QList<QString> cameraP
           if (commonIds.size() > m_calibrationConfig->patternHeight - 1 &&
               commonIds.size() > m_calibrationConfig->patternWidth - 1) {
               if (m_calibrationConfig->debug) {
+                  //Detections made by another calibrator come without the
+                  //frame and without the marker outlines
+                  if (img1.empty()) cap1.retrieve(img1);
+                  if (img2.empty()) cap2.retrieve(img2);
                   cv::Mat imageCopy1, imageCopy2, debugImg;
                   img1.copyTo(imageCopy1);
                   img2.copyTo(imageCopy2);
                   cv::Scalar color = cv::Scalar(255, 0, 255);
-                  cv::aruco::drawDetectedMarkers(imageCopy1, markerCorners1,
-                                                 markerIds1);
                   cv::aruco::drawDetectedCornersCharuco(
                       imageCopy1, charucoCorners1, charucoIds1, color);
-                  cv::aruco::drawDetectedMarkers(imageCopy2, markerCorners2,
-                                                 markerIds2);
                   cv::aruco::drawDetectedCornersCharuco(
                       imageCopy2, charucoCorners2, charucoIds2, color);
                   cv::resize(imageCopy2, imageCopy2, imageCopy1.size());
@@ -490,6 +526,9 @@ bool ExtrinsicsCalibrator::calibrateExtrinsicsPairCharuco(QList<QString> cameraP
               objectPointsAll.push_back(objectPointsDetected);
           }
         }
+	      seekIndex1->seek(&cap1, frameIndex+skipIndex, frameIndex);
+	      seekIndex2->seek(&cap2, frameIndex+skipIndex, frameIndex);
+	      if (frameIndex > frameCount) read_success = false;
 	      emit extrinsicsProgress(counter*(skipIndex+1), frameCount,
 	            m_threadNumber);
 	      counter++;
@@ -592,182 +631,6 @@ QString ExtrinsicsCalibrator::getFormat(const QString& path,
 
 
 
-bool ExtrinsicsCalibrator::checkRotation(std::vector< cv::Point2f> &corners1,
-      cv::Mat &img1) {
-  if (m_calibrationConfig->boardType == "Standard") {
-    int width = m_calibrationConfig->patternWidth;
-    int height = m_calibrationConfig->patternHeight;
-    cv::Point2i ctestd;
-    cv::Point2f p1 = corners1[width*height-1];
-    cv::Point2f p2 = corners1[width*height-2];
-    cv::Point2f p3 = corners1[width*(height-1)-1];
-    cv::Point2f p4 = corners1[width*(height-1)-2];
-    ctestd.x = (p1.x + p2.x + p3.x + p4.x) / 4;
-    ctestd.y = (p1.y + p2.y + p3.y + p4.y) / 4;
-
-    cv::Point2i ctestl;
-    p1 = corners1[0];
-    p2 = corners1[1];
-    p3 = corners1[width];
-    p4 = corners1[width+1];
-    ctestl.x = (p1.x + p2.x + p3.x + p4.x) / 4;
-    ctestl.y = (p1.y + p2.y + p3.y + p4.y) / 4;
-
-    cv::Vec3b colord = img1.at<cv::Vec3b>(ctestd.y,ctestd.x);
-    int color_sum_d = colord[0]+colord[1]+colord[2];
-    cv::Vec3b colorl = img1.at<cv::Vec3b>(ctestl.y,ctestl.x);
-    int color_sum_l = colorl[0]+colorl[1]+colorl[2];
-
-    if (color_sum_d > color_sum_l) {
-      std::reverse(corners1.begin(),corners1.end());
-    }
-    return true;
-  }
-  else {
-    cv::Ptr<cv::aruco::Dictionary> dictionary =
-          cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_50);
-    cv::Ptr<cv::aruco::CharucoBoard> board =
-          cv::aruco::CharucoBoard::create(7, 5, 0.04f, 0.02f, dictionary);
-    cv::Ptr<cv::aruco::DetectorParameters> params =
-          cv::aruco::DetectorParameters::create();
-
-    params->cornerRefinementMethod = cv::aruco::CORNER_REFINE_CONTOUR;
-    cv::Mat  imageCopy;
-    img1.copyTo(imageCopy);
-    std::vector<int> markerIds;
-    std::vector<std::vector<cv::Point2f> > markerCorners;
-    cv::aruco::detectMarkers(img1, board->dictionary, markerCorners, markerIds,
-          params);
-    if (markerIds.size() == 0) return false;
-    // cv::aruco::drawDetectedMarkers(imageCopy, markerCorners, markerIds);
-    // cv::imwrite(m_parametersSavePath  + "test.jpg", imageCopy);
-
-    m_detectedPattern = -1;
-    for (int i = 0; i < markerCorners.size(); i++) {
-      cv::Point2i markerPosition = getPositionOfMarkerOnBoard(corners1,
-            markerCorners[i]);
-      if (markerPosition.x != -1) {
-        m_detectedPattern.at<int>(markerPosition.y+1,markerPosition.x+1) =
-              markerIds[i];
-      }
-    }
-    int match = matchPattern();
-    if (match == 0) {
-      return false;
-    }
-    else if (match == 2) {
-      std::reverse(corners1.begin(),corners1.end());
-    }
-
-    return true;
-  }
-}
-
-int ExtrinsicsCalibrator::matchPattern() {
-  int unrotCount = 0;
-  int rotCount = 0;
-  for (int i = 0; i < m_calibrationConfig->patternWidth+1; i++) {
-    for (int j = 0; j <  m_calibrationConfig->patternHeight+1; j++) {
-      if (m_charucoPattern.at<int>(j,i) != -1) {
-        if (m_charucoPattern.at<int>(j,i) == m_detectedPattern.at<int>(j,i) ||
-              m_charucoPattern.at<int>(j,i) == m_detectedPattern.at<int>(j,i)) {
-          unrotCount++;
-        }
-        if ((m_charucoPattern.at<int>(j,i) == m_detectedPattern.at<int>(
-              m_calibrationConfig->patternHeight-j,
-              m_calibrationConfig->patternWidth-i))) {
-          rotCount++;
-        }
-      }
-    }
-  }
-  if (unrotCount == rotCount) {
-    return 0;
-  }
-  else if (unrotCount > rotCount) {
-    return 1;
-  }
-  else if (unrotCount < rotCount) {
-    return 2;
-  }
-}
-
-
-
-cv::Point2i ExtrinsicsCalibrator::getPositionOfMarkerOnBoard(
-      std::vector< cv::Point2f>&cornersBoard,
-      std::vector<cv::Point2f>&markerCorners) {
-  int width = m_calibrationConfig->patternWidth;
-  int height = m_calibrationConfig->patternHeight;
-  cv::Point2i position;
-  position.x = -1;
-  position.y = -1;
-  for (int i = 0; i < width-1; i++) {
-    for (int j = 0; j < height-1; j++) {
-      cv::Point2f markerCenter;
-      markerCenter.x = (markerCorners[0].x+markerCorners[2].x)/2;
-      markerCenter.y = (markerCorners[0].y+markerCorners[2].y)/2;
-      cv::Point2f p1 = cornersBoard[j*width+i];
-      cv::Point2f p2 = cornersBoard[(j+1)*width+(i+1)];
-
-      if (((p1.x < p2.x && markerCenter.x > p1.x && markerCenter.x < p2.x) ||
-            (p1.x > p2.x && markerCenter.x < p1.x && markerCenter.x > p2.x))  &&
-            ((p1.y < p2.y && markerCenter.y > p1.y && markerCenter.y < p2.y) ||
-            (p1.y > p2.y && markerCenter.y < p1.y && markerCenter.y > p2.y))) {
-        position.x = i;
-        position.y = m_calibrationConfig->patternHeight-2-j;
-      }
-    }
-  }
-  return position;
-}
-
-
-bool ExtrinsicsCalibrator::boardToCorners(cbdetect::Board &board,
-      cbdetect::Corner &cbCorners, std::vector<cv::Point2f> &corners) {
-  if (board.idx.size()-2 == m_calibrationConfig->patternHeight) {
-    for(int i = 1; i < board.idx.size() - 1; ++i) {
-      if (board.idx[i].size()-2 == m_calibrationConfig->patternWidth) {
-        for(int j = 1; j < board.idx[i].size() - 1; ++j) {
-          if(board.idx[i][j] < 0) {
-            return false;
-          }
-          if (board.idx[i][j] >= cbCorners.p.size()) {
-            return false;
-          }
-          corners.push_back(static_cast<cv::Point2f>(
-                cbCorners.p[board.idx[i][j]]));
-        }
-      }
-      else {
-        return false;
-      }
-    }
-  }
-  else {
-    for(int j = 1; j < board.idx[0].size() - 1; ++j) {
-      for(int i = 1; i < board.idx.size() - 1; ++i) {
-        if (board.idx.size()-2 == m_calibrationConfig->patternWidth &&
-            board.idx[i].size()-2 == m_calibrationConfig->patternHeight) {
-          if(board.idx[board.idx.size() - 1 -i][j] < 0) {
-            return false;
-          }
-          if (board.idx[board.idx.size() - 1 -i][j] >= cbCorners.p.size()) {
-            return false;
-          }
-          corners.push_back(static_cast<cv::Point2f>(
-                cbCorners.p[board.idx[board.idx.size() - 1 -i][j]]));
-        }
-        else {
-          return false;
-        }
-      }
-    }
-  }
-  return true;
-}
-
-
 void ExtrinsicsCalibrator::calibrationCanceledSlot() {
   m_interrupt = true;
 }
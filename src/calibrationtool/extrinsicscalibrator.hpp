@@ -12,28 +12,28 @@
 
 #include "globals.hpp"
 #include "colormap.hpp"
-
-
-#include "boards_from_corners.h"
-#include "config.h"
-#include "find_corners.h"
+#include "boardprefilter.hpp"
+#include "boarddetector.hpp"
+#include "detectioncache.hpp"
 
 #include "opencv2/core.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/calib3d.hpp"
+#include "opencv2/videoio.hpp"
 #include <opencv2/aruco/charuco.hpp>
 #include <string>
 #include <vector>
 
 #include <QRunnable>
+#include <QScopedPointer>
 
 
 class ExtrinsicsCalibrator : public QObject, public QRunnable {
 	Q_OBJECT
 
 	public:
-		explicit ExtrinsicsCalibrator(CalibrationConfig *calibrationConfig, QMap<QString, QMap<QString, cv::Mat>> intrinsicParameters, QList<QString> cameraPair, int threadNumber);
+		explicit ExtrinsicsCalibrator(CalibrationConfig *calibrationConfig, QMap<QString, QMap<QString, cv::Mat>> intrinsicParameters, QList<QString> cameraPair, int threadNumber, DetectionStore *detectionStore);
 		void run();
 		void run_standard();
 		void run_charuco();
@@ -59,9 +59,6 @@ class ExtrinsicsCalibrator : public QObject, public QRunnable {
       cv::Mat F;
     };
 
-		cv::Mat m_charucoPattern;
-		cv::Mat m_detectedPattern;
-
     std::vector<cv::Point3f> m_checkerBoardPoints;
     CalibrationConfig *m_calibrationConfig;
 		QMap<QString, QMap<QString, cv::Mat>> m_intrinsicParameters;
@@ -69,6 +66,9 @@ class ExtrinsicsCalibrator : public QObject, public QRunnable {
 		QList<QString> m_cameraPair;
 		int m_threadNumber;
 		bool m_interrupt = false;
+		QScopedPointer<BoardPrefilter> m_prefilter;
+		QScopedPointer<BoardDetector> m_boardDetector;
+		DetectionStore *m_detectionStore;
 		QList<QString> m_validRecordingFormats = {"avi", "mp4", "mov", "wmv", "AVI", "MP4", "WMV"};
 
 
@@ -76,10 +76,9 @@ class ExtrinsicsCalibrator : public QObject, public QRunnable {
 		bool calibrateExtrinsicsPairCharuco(QList<QString> cameraPair, Extrinsics &e, double &mean_repro_error);
 		double stereoCalibrationStep(std::vector<std::vector<cv::Point3f>> &objectPoints, std::vector<std::vector<cv::Point2f>> &imagePoints1,
 		      std::vector<std::vector<cv::Point2f>> &imagePoints2, Intrinsics &i1, Intrinsics &i2, Extrinsics &e, cv::Size size, double thresholdFactor);
-		bool checkRotation(std::vector< cv::Point2f> &corners1, cv::Mat &img1);
-		cv::Point2i getPositionOfMarkerOnBoard(std::vector< cv::Point2f>&cornersBoard, std::vector<cv::Point2f>&markerCorners);
-		int matchPattern();
-		bool boardToCorners(cbdetect::Board &board, cbdetect::Corner &cbCorners, std::vector<cv::Point2f> &corners);
+		bool detectView(cv::VideoCapture &cap, DetectionCache *detectionCache, int frameNumber, cv::Mat &img,
+		      DetectionCache::Detection &detection, cv::Ptr<cv::aruco::CharucoBoard> board);
+		DetectionCache::Detection detectCharuco(const cv::Mat &img, cv::Ptr<cv::aruco::CharucoBoard> board);
 		QString getFormat(const QString& path, const QString& cameraName);
 		void saveCheckerboard(QList<QString> cameraPair, const cv::Mat &img1, const cv::Mat &img2, const std::vector<cv::Point2f> &corners1, const std::vector<cv::Point2f> &corners2, int counter);
 
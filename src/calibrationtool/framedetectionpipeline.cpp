@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * File:			  framedetectionpipeline.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "framedetectionpipeline.hpp"
+
+#include <algorithm>
+
+
+FrameDetectionPipeline::FrameDetectionPipeline(QThreadPool *pool,
+			DetectFunction detect, int queueSize) : m_pool(pool), m_detect(detect),
+			m_queueSize(std::max(1, queueSize)), m_state(new State) {
+}
+
+
+FrameDetectionPipeline::~FrameDetectionPipeline() {
+	//Workers call m_detect, none of them may still be detecting afterwards
+	waitForDone();
+}
+
+
+void FrameDetectionPipeline::detect(int frameNumber, const cv::Mat &frame) {
+	qint64 index;
+	{
+		QMutexLocker locker(&m_state->mutex);
+		while (m_state->inFlight >= m_queueSize) {
+			m_state->finished.wait(&m_state->mutex);
+		}
+		index = m_state->nextSubmitted++;
+		m_state->inFlight++;
+	}
+	QSharedPointer<State> state = m_state;
+	DetectFunction detect = m_detect;
+	m_pool->start([state, detect, index, frameNumber, frame]() {
+		Result result;
+		result.frameNumber = frameNumber;
+		result.detected = true;
+		result.detection = detect(frame, frameNumber);
+		QMutexLocker locker(&state->mutex);
+		state->results[index] = result;
+		state->inFlight--;
+		state->finished.wakeAll();
+	});
+}
+
+
+void FrameDetectionPipeline::addResult(int frameNumber,
+			const DetectionCache::Detection &detection) {
+	QMutexLocker locker(&m_state->mutex);
+	Result result;
+	result.frameNumber = frameNumber;
+	result.detected = false;
+	result.detection = detection;
+	m_state->results[m_state->nextSubmitted++] = result;
+}
+
+
+QList<FrameDetectionPipeline::Result> FrameDetectionPipeline::takeResults() {
+	//Results come back in the order the frames were handed in, no matter
+	//which worker finished first
+	QMutexLocker locker(&m_state->mutex);
+	QList<Result> results;
+	auto it = m_state->results.find(m_state->nextTaken);
+	while (it != m_state->results.end()) {
+		results.append(it.value());
+		m_state->results.erase(it);
+		it = m_state->results.find(++m_state->nextTaken);
+	}
+	return results;
+}
+
+
+void FrameDetectionPipeline::waitForDone() {
+	QMutexLocker locker(&m_state->mutex);
+	while (m_state->inFlight > 0) {
+		m_state->finished.wait(&m_state->mutex);
+	}
+}
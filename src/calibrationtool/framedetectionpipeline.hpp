@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * File:			  framedetectionpipeline.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef FRAMEDETECTIONPIPELINE_H
+#define FRAMEDETECTIONPIPELINE_H
+
+#include "globals.hpp"
+#include "detectioncache.hpp"
+
+#include "opencv2/core.hpp"
+
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <functional>
+
+
+class FrameDetectionPipeline {
+	public:
+		typedef std::function<DetectionCache::Detection(const cv::Mat &frame,
+					int frameNumber)> DetectFunction;
+
+		struct Result {
+			int frameNumber;
+			bool detected;	//False if the detection was handed in from the cache
+			DetectionCache::Detection detection;
+		};
+
+		explicit FrameDetectionPipeline(QThreadPool *pool, DetectFunction detect,
+					int queueSize);
+		~FrameDetectionPipeline();
+		void detect(int frameNumber, const cv::Mat &frame);
+		void addResult(int frameNumber, const DetectionCache::Detection &detection);
+		QList<Result> takeResults();
+		void waitForDone();
+
+	private:
+		//Held by every worker as well, so a worker can still unlock it after the
+		//pipeline was destroyed right behind its last wakeAll()
+		struct State {
+			int inFlight = 0;
+			qint64 nextSubmitted = 0;
+			qint64 nextTaken = 0;
+			QMap<qint64, Result> results;
+			QMutex mutex;
+			QWaitCondition finished;
+		};
+
+		QThreadPool *m_pool;
+		DetectFunction m_detect;
+		int m_queueSize;
+		QSharedPointer<State> m_state;
+};
+
+#endif
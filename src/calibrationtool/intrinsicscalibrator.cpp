@@ -9,6 +9,11 @@
 
 #include "intrinsicscalibrator.hpp"
 #include "colormap.hpp"
+#include "seekindex.hpp"
+#include "detectioncache.hpp"
+#include "framedetectionpipeline.hpp"
+#include "boardprefilter.hpp"
+#include "boarddetector.hpp"
 
 
 #include <sys/stat.h>
@@ -19,9 +24,11 @@
 
 
 IntrinsicsCalibrator::IntrinsicsCalibrator(CalibrationConfig *calibrationConfig,
-      const QString& cameraName, int threadNumber) :
+      const QString& cameraName, int threadNumber,
+      DetectionStore *detectionStore, QThreadPool *detectorPool) :
       m_calibrationConfig(calibrationConfig),
-      m_cameraName(cameraName.toStdString()), m_threadNumber(threadNumber){
+      m_cameraName(cameraName.toStdString()), m_threadNumber(threadNumber),
+      m_detectionStore(detectionStore), m_detectorPool(detectorPool) {
   QDir dir;
   // dir.mkpath(m_calibrationConfig->calibrationSetPath + "/" +
   //            m_calibrationConfig->calibrationSetName + "/Intrinsics");
@@ -32,21 +39,6 @@ IntrinsicsCalibrator::IntrinsicsCalibrator(CalibrationConfig *calibrationConfig,
   }
   m_parametersSavePath = (m_calibrationConfig->calibrationSetPath + "/" +
         m_calibrationConfig->calibrationSetName).toStdString();
-
-  m_charucoPattern = cv::Mat(cv::Size( m_calibrationConfig->patternWidth+1,
-        m_calibrationConfig->patternHeight+1), CV_32SC1);
-  m_detectedPattern = cv::Mat(cv::Size( m_calibrationConfig->patternWidth+1,
-        m_calibrationConfig->patternHeight+1), CV_32SC1);
-  m_charucoPattern = -1;
-  int id_count = 0;
-  for (int i = 0; i < m_calibrationConfig->patternWidth+1; i++) {
-    for (int j = 0; j <  m_calibrationConfig->patternHeight+1; j++) {
-      if ((i+j)%2 != 0) {
-        m_charucoPattern.at<int>(j,i) = id_count;
-        id_count++;
-      }
-    }
-  }
 }
 
 
@@ -72,20 +64,29 @@ void IntrinsicsCalibrator::run_standard() {
 
   std::vector< std::vector< cv::Point3f > > objectPointsAll, objectPoints;
   std::vector< std::vector< cv::Point2f > > imagePointsAll, imagePoints;
-  std::vector< cv::Point2f > corners;
   cv::Size size;
-  cbdetect::Corner cbCorners;
-  std::vector<cbdetect::Board> boards;
-  cbdetect::Params params;
-  params.corner_type = cbdetect::SaddlePoint;
-  params.show_processing = false;
-  params.show_debug_image = false;
 	int iteration = 0;
 	int skipIndex;
 
+	if (m_calibrationConfig->boardPrefilter) {
+		m_prefilter.reset(new BoardPrefilter(m_calibrationConfig));
+	}
+	m_boardDetector.reset(new BoardDetector(m_calibrationConfig,
+				m_prefilter.data()));
+
+	//Later passes, the extrinsics of the same video and reruns only detect on
+	//frames nobody has looked at yet
+	QSharedPointer<DetectionCache> detectionCache = m_detectionStore->cache(
+				m_calibrationConfig->intrinsicsPath + "/" +
+				QString::fromStdString(m_cameraName) + "." + format,
+				BoardDetector::Name);
+
 	while (objectPointsAll.size() < m_calibrationConfig->framesForIntrinsics) {
-		cv::VideoCapture cap(m_calibrationConfig->intrinsicsPath.toStdString() + "/" +
-												 m_cameraName + "." + format.toStdString());
+		std::string videoPath = m_calibrationConfig->intrinsicsPath.toStdString() +
+					"/" + m_cameraName + "." + format.toStdString();
+		cv::VideoCapture cap(videoPath);
+		QSharedPointer<SeekIndex> seekIndex = SeekIndex::open(
+					QString::fromStdString(videoPath));
 		int frameCount = cap.get(cv::CAP_PROP_FRAME_COUNT);
 
 		if (iteration == 0) {
@@ -93,16 +94,16 @@ void IntrinsicsCalibrator::run_standard() {
 			skipIndex = skipIndex-skipIndex%4;
 		}
 		else if (iteration% 2 == 1 && iteration < 4) {
-			cap.set(cv::CAP_PROP_POS_FRAMES, skipIndex/2);
+			seekIndex->seek(&cap, skipIndex/2);
 		}
 		else if (iteration == 2) {
-			cap.set(cv::CAP_PROP_POS_FRAMES, skipIndex/4);
+			seekIndex->seek(&cap, skipIndex/4);
 			skipIndex = skipIndex/2;
 		}
 		else if (iteration < 5) {
       imagePointsAll.clear();
       objectPointsAll.clear();
-      cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+      seekIndex->seek(&cap, 0);
       skipIndex = 1;
 		}
     else {
@@ -112,45 +113,62 @@ void IntrinsicsCalibrator::run_standard() {
 
 	  bool read_success = true;
 	  int counter = 0;
-	  cv::Mat img;
+	  size = cv::Size(cap.get(cv::CAP_PROP_FRAME_WIDTH),
+	        cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+	  //This thread only decodes, the detection runs on the shared detector pool
+	  FrameDetectionPipeline pipeline(m_detectorPool, [this](const cv::Mat &frame,
+	        int frameNumber) {return detectStandard(frame, frameNumber);},
+	        m_calibrationConfig->detectionQueueSize);
+	  auto collectResults = [&]() {
+	    for (const auto &result : pipeline.takeResults()) {
+	      if (result.detected) {
+	        detectionCache->insert(result.frameNumber, result.detection);
+	      }
+	      if (result.detection.found) {
+	        imagePointsAll.push_back(result.detection.corners);
+	        objectPointsAll.push_back(checkerBoardPoints);
+	      }
+	    }
+	  };
 	  while (read_success && !m_interrupt) {
-	    read_success = cap.read(img);
+	    read_success = cap.grab();
 	    if (read_success) {
-	      corners.clear();
-	      size = img.size();
 	      int frameIndex = cap.get(cv::CAP_PROP_POS_FRAMES);
-	      cap.set(cv::CAP_PROP_POS_FRAMES, frameIndex+skipIndex);
+	      DetectionCache::Detection detection;
+	      bool cached = detectionCache->acquire(frameIndex-1, detection);
+	      //Only frames that are actually detected on get converted, every frame
+	      //gets its own buffer since the workers hold on to it
+	      cv::Mat img;
+	      bool decoded = !cached && cap.retrieve(img);
+	      if (!cached && !decoded) {
+	        detectionCache->release(frameIndex-1);
+	        read_success = false;
+	      }
+	      seekIndex->seek(&cap, frameIndex+skipIndex, frameIndex);
 	      if (frameIndex > frameCount) read_success = false;
-	      cbdetect::find_corners(img, cbCorners, params);
-	      bool patternFound = (cbCorners.p.size() >=
-	            m_calibrationConfig->patternHeight *
-	            m_calibrationConfig->patternWidth);
-
-	      if (patternFound) {
-	        cbdetect::boards_from_corners(img, cbCorners, boards, params);
-	        if(boards.size() == 1) {
-	          patternFound = boardToCorners(boards[0], cbCorners, corners);
-	        }
-	        else {
-	          patternFound = false;
-	        }
+	      if (cached) {
+	        pipeline.addResult(frameIndex-1, detection);
 	      }
-	      if (patternFound && checkRotation(corners, img)) {
-	        if (m_calibrationConfig->debug) {
-	          saveCheckerboard(img, corners, counter);
-	        }
-	        imagePointsAll.push_back(corners);
-	        objectPointsAll.push_back(checkerBoardPoints);
+	      else if (decoded) {
+	        size = img.size();
+	        pipeline.detect(frameIndex-1, img);
 	      }
+	      collectResults();
 	      emit intrinsicsProgress(counter * (skipIndex + 1), frameCount,
 	            m_threadNumber);
 	      counter++;
 	    }
 	  }
+	  pipeline.waitForDone();
+	  collectResults();
 		cap.release();
 	  if (m_interrupt) return;
 	}
 
+  if (!m_prefilter.isNull()) {
+    m_prefilter->printStats(m_cameraName);
+  }
+
   if (objectPointsAll.size() < m_calibrationConfig->framesForIntrinsics) {
       emit calibrationError("Camera " + QString::fromStdString(m_cameraName) +
       ": Found only " + QString::number(objectPointsAll.size()) +
@@ -197,6 +215,57 @@ void IntrinsicsCalibrator::run_standard() {
   emit finishedIntrinsics(K, D, repro_error, m_threadNumber);
 }
 
+DetectionCache::Detection IntrinsicsCalibrator::detectStandard(
+      const cv::Mat &img, int frameNumber) {
+  //Runs on the detector pool, everything but the config is local
+  DetectionCache::Detection detection;
+  std::vector<cv::Point2f> corners;
+  if (m_boardDetector->find(img, corners)) {
+    if (m_calibrationConfig->debug) {
+      saveCheckerboard(img, corners, frameNumber);
+    }
+    detection.found = true;
+    detection.corners = corners;
+  }
+  return detection;
+}
+
+
+DetectionCache::Detection IntrinsicsCalibrator::detectCharuco(
+      const cv::Mat &img, int frameNumber,
+      cv::Ptr<cv::aruco::CharucoBoard> board,
+      cv::Ptr<cv::aruco::DetectorParameters> charucoParams) {
+  DetectionCache::Detection detection;
+  std::vector<int> markerIds;
+  std::vector<std::vector<cv::Point2f>> markerCorners;
+  cv::aruco::detectMarkers(img, board->dictionary, markerCorners, markerIds, charucoParams);
+  if (markerIds.size() > 5) {
+    std::vector<cv::Point2f> charucoCorners;
+    std::vector<int> charucoIds;
+    cv::aruco::interpolateCornersCharuco(markerCorners, markerIds, img, board, charucoCorners, charucoIds);
+    if (charucoIds.size() > m_calibrationConfig->patternHeight-1 &&
+        charucoIds.size() > m_calibrationConfig->patternWidth-1) {
+      detection.found = true;
+      detection.corners = charucoCorners;
+      detection.ids = charucoIds;
+      if (m_calibrationConfig->debug) {
+        cv::Mat imageCopy;
+        img.copyTo(imageCopy);
+        cv::Scalar color = cv::Scalar(255, 0, 255);
+        cv::aruco::drawDetectedCornersCharuco(
+            imageCopy, charucoCorners, charucoIds, color);
+        cv::aruco::drawDetectedMarkers(imageCopy, markerCorners, markerIds);
+        cv::imwrite(m_parametersSavePath + "/debug/Intrinsics/" +
+                    m_cameraName + "/Frame_" +
+                    QString::number(frameNumber).toStdString() + ".jpg",
+                    imageCopy);
+      }
+    }
+  }
+  return detection;
+}
+
+
 double IntrinsicsCalibrator::intrinsicsCalibrationStep(std::vector<std::vector<cv::Point3f>> &objectPoints,
       std::vector<std::vector<cv::Point2f>> &imagePoints, cv::Size size, double thresholdFactor) {
   cv::Mat K, D;
@@ -262,9 +331,17 @@ void IntrinsicsCalibrator::run_charuco() {
   std::vector<std::vector<cv::Point2f>> charucoCornersAll, charucoCorners;
 
 
+	QSharedPointer<DetectionCache> detectionCache = m_detectionStore->cache(
+				m_calibrationConfig->intrinsicsPath + "/" +
+				QString::fromStdString(m_cameraName) + "." + format,
+				"charuco");
+
 	while (charucoIdsAll.size() < m_calibrationConfig->framesForIntrinsics) {
-		cv::VideoCapture cap(m_calibrationConfig->intrinsicsPath.toStdString() + "/" +
-												 m_cameraName + "." + format.toStdString());
+		std::string videoPath = m_calibrationConfig->intrinsicsPath.toStdString() +
+					"/" + m_cameraName + "." + format.toStdString();
+		cv::VideoCapture cap(videoPath);
+		QSharedPointer<SeekIndex> seekIndex = SeekIndex::open(
+					QString::fromStdString(videoPath));
 		int frameCount = cap.get(cv::CAP_PROP_FRAME_COUNT);
 
 
@@ -273,16 +350,16 @@ void IntrinsicsCalibrator::run_charuco() {
 			skipIndex = skipIndex-skipIndex%4;
 		}
 		else if (iteration% 2 == 1 && iteration < 4) {
-			cap.set(cv::CAP_PROP_POS_FRAMES, skipIndex/2);
+			seekIndex->seek(&cap, skipIndex/2);
 		}
 		else if (iteration == 2) {
-			cap.set(cv::CAP_PROP_POS_FRAMES, skipIndex/4);
+			seekIndex->seek(&cap, skipIndex/4);
 			skipIndex = skipIndex/2;
 		}
     else if (iteration < 5) {
       charucoIdsAll.clear();
       charucoCornersAll.clear();
-      cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+      seekIndex->seek(&cap, 0);
       skipIndex = 10;
 		}
     else {
@@ -292,45 +369,52 @@ void IntrinsicsCalibrator::run_charuco() {
 
 	  bool read_success = true;
 	  int counter = 0;
-	  cv::Mat img;
+	  size = cv::Size(cap.get(cv::CAP_PROP_FRAME_WIDTH),
+	        cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+	  FrameDetectionPipeline pipeline(m_detectorPool, [this, board, charucoParams](
+	        const cv::Mat &frame, int frameNumber) {
+	        return detectCharuco(frame, frameNumber, board, charucoParams);},
+	        m_calibrationConfig->detectionQueueSize);
+	  auto collectResults = [&]() {
+	    for (const auto &result : pipeline.takeResults()) {
+	      if (result.detected) {
+	        detectionCache->insert(result.frameNumber, result.detection);
+	      }
+	      if (result.detection.found) {
+	        charucoCornersAll.push_back(result.detection.corners);
+	        charucoIdsAll.push_back(result.detection.ids);
+	      }
+	    }
+	  };
 	  while (read_success && !m_interrupt) {
-	    read_success = cap.read(img);
+	    read_success = cap.grab();
 	    if (read_success) {
-	      size = img.size();
 	      int frameIndex = cap.get(cv::CAP_PROP_POS_FRAMES);
-	      cap.set(cv::CAP_PROP_POS_FRAMES, frameIndex+skipIndex);
+	      DetectionCache::Detection detection;
+	      bool cached = detectionCache->acquire(frameIndex-1, detection);
+	      cv::Mat img;
+	      bool decoded = !cached && cap.retrieve(img);
+	      if (!cached && !decoded) {
+	        detectionCache->release(frameIndex-1);
+	        read_success = false;
+	      }
+	      seekIndex->seek(&cap, frameIndex+skipIndex, frameIndex);
 	      if (frameIndex > frameCount) read_success = false;
-        std::vector<int> markerIds;
-        std::vector<std::vector<cv::Point2f>> markerCorners;
-        cv::aruco::detectMarkers(img, board->dictionary, markerCorners, markerIds, charucoParams);
-         if (markerIds.size() > 5) {
-             std::vector<cv::Point2f> charucoCorners;
-             std::vector<int> charucoIds;
-             cv::aruco::interpolateCornersCharuco(markerCorners, markerIds, img, board, charucoCorners, charucoIds);
-             if (charucoIds.size() > m_calibrationConfig->patternHeight-1 &&
-                 charucoIds.size() > m_calibrationConfig->patternWidth-1) {
-                 charucoCornersAll.push_back(charucoCorners);
-                 charucoIdsAll.push_back(charucoIds);
-                 if (m_calibrationConfig->debug) {
-                     img.copyTo(imageCopy);
-                     cv::Scalar color = cv::Scalar(255, 0, 255);
-                     cv::aruco::drawDetectedCornersCharuco(
-                         imageCopy, charucoCorners, charucoIds, color);
-                     cv::aruco::drawDetectedMarkers(imageCopy, markerCorners,
-                                                    markerIds);
-                     cv::imwrite(m_parametersSavePath + "/debug/Intrinsics/" +
-                                     m_cameraName + "/Frame_" +
-                                     QString::number(counter).toStdString() +
-                                     ".jpg",
-                                 imageCopy);
-                 }
-             }
-        }
+	      if (cached) {
+	        pipeline.addResult(frameIndex-1, detection);
+	      }
+	      else if (decoded) {
+	        size = img.size();
+	        pipeline.detect(frameIndex-1, img);
+	      }
+	      collectResults();
 	      emit intrinsicsProgress(counter * (skipIndex + 1), frameCount,
 	            m_threadNumber);
 	      counter++;
 	    }
 	  }
+	  pipeline.waitForDone();
+	  collectResults();
 		cap.release();
 	  if (m_interrupt) return;
 	}
@@ -425,179 +509,6 @@ QString IntrinsicsCalibrator::getFormat(const QString& path,
 
 
 
-bool IntrinsicsCalibrator::checkRotation(std::vector< cv::Point2f> &corners1,
-      cv::Mat &img1) {
-  if (m_calibrationConfig->boardType == "Standard") {
-    int width = m_calibrationConfig->patternWidth;
-    int height = m_calibrationConfig->patternHeight;
-    cv::Point2i ctestd;
-    cv::Point2f p1 = corners1[width*height-1];
-    cv::Point2f p2 = corners1[width*height-2];
-    cv::Point2f p3 = corners1[width*(height-1)-1];
-    cv::Point2f p4 = corners1[width*(height-1)-2];
-    ctestd.x = (p1.x + p2.x + p3.x + p4.x) / 4;
-    ctestd.y = (p1.y + p2.y + p3.y + p4.y) / 4;
-
-    cv::Point2i ctestl;
-    p1 = corners1[0];
-    p2 = corners1[1];
-    p3 = corners1[width];
-    p4 = corners1[width+1];
-    ctestl.x = (p1.x + p2.x + p3.x + p4.x) / 4;
-    ctestl.y = (p1.y + p2.y + p3.y + p4.y) / 4;
-
-    cv::Vec3b colord = img1.at<cv::Vec3b>(ctestd.y,ctestd.x);
-    int color_sum_d = colord[0]+colord[1]+colord[2];
-    cv::Vec3b colorl = img1.at<cv::Vec3b>(ctestl.y,ctestl.x);
-    int color_sum_l = colorl[0]+colorl[1]+colorl[2];
-
-    if (color_sum_d > color_sum_l) {
-      std::reverse(corners1.begin(),corners1.end());
-    }
-    return true;
-  }
-  else {
-    cv::Ptr<cv::aruco::Dictionary> dictionary =
-          cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_50);
-    cv::Ptr<cv::aruco::CharucoBoard> board =
-          cv::aruco::CharucoBoard::create(7, 5, 0.04f, 0.02f, dictionary);
-    cv::Ptr<cv::aruco::DetectorParameters> params =
-          cv::aruco::DetectorParameters::create();
-
-    params->cornerRefinementMethod = cv::aruco::CORNER_REFINE_CONTOUR;
-    cv::Mat  imageCopy;
-    img1.copyTo(imageCopy);
-    std::vector<int> markerIds;
-    std::vector<std::vector<cv::Point2f> > markerCorners;
-    cv::aruco::detectMarkers(img1, board->dictionary, markerCorners, markerIds,
-          params);
-    if (markerIds.size() == 0) return false;
-    // cv::aruco::drawDetectedMarkers(imageCopy, markerCorners, markerIds);
-    // cv::imwrite(m_parametersSavePath  + "test.jpg", imageCopy);
-
-    m_detectedPattern = -1;
-    for (int i = 0; i < markerCorners.size(); i++) {
-      cv::Point2i markerPosition = getPositionOfMarkerOnBoard(corners1,
-            markerCorners[i]);
-      if (markerPosition.x != -1) {
-        m_detectedPattern.at<int>(markerPosition.y+1,markerPosition.x+1) =
-              markerIds[i];
-      }
-    }
-    int match = matchPattern();
-    if (match == 0) {
-      return false;
-    }
-    else if (match == 2) {
-      std::reverse(corners1.begin(),corners1.end());
-    }
-
-    return true;
-  }
-}
-
-int IntrinsicsCalibrator::matchPattern() {
-  int unrotCount = 0;
-  int rotCount = 0;
-  for (int i = 0; i < m_calibrationConfig->patternWidth+1; i++) {
-    for (int j = 0; j <  m_calibrationConfig->patternHeight+1; j++) {
-      if (m_charucoPattern.at<int>(j,i) != -1) {
-        if (m_charucoPattern.at<int>(j,i) == m_detectedPattern.at<int>(j,i) ||
-              m_charucoPattern.at<int>(j,i) == m_detectedPattern.at<int>(j,i)) {
-          unrotCount++;
-        }
-        if ((m_charucoPattern.at<int>(j,i) ==
-              m_detectedPattern.at<int>(m_calibrationConfig->patternHeight-j,
-              m_calibrationConfig->patternWidth-i))) {
-          rotCount++;
-        }
-      }
-    }
-  }
-  if (unrotCount == rotCount) {
-    return 0;
-  }
-  else if (unrotCount > rotCount) {
-    return 1;
-  }
-  else if (unrotCount < rotCount) {
-    return 2;
-  }
-}
-
-
-
-cv::Point2i IntrinsicsCalibrator::getPositionOfMarkerOnBoard(
-      std::vector< cv::Point2f>&cornersBoard,
-      std::vector<cv::Point2f>&markerCorners) {
-  int width = m_calibrationConfig->patternWidth;
-  int height = m_calibrationConfig->patternHeight;
-  cv::Point2i position;
-  position.x = -1;
-  position.y = -1;
-  for (int i = 0; i < width-1; i++) {
-    for (int j = 0; j < height-1; j++) {
-      cv::Point2f markerCenter;
-      markerCenter.x = (markerCorners[0].x+markerCorners[2].x)/2;
-      markerCenter.y = (markerCorners[0].y+markerCorners[2].y)/2;
-      cv::Point2f p1 = cornersBoard[j*width+i];
-      cv::Point2f p2 = cornersBoard[(j+1)*width+(i+1)];
-
-      if (((p1.x < p2.x && markerCenter.x > p1.x && markerCenter.x < p2.x) ||
-            (p1.x > p2.x && markerCenter.x < p1.x && markerCenter.x > p2.x))  &&
-            ((p1.y < p2.y && markerCenter.y > p1.y && markerCenter.y < p2.y) ||
-            (p1.y > p2.y && markerCenter.y < p1.y && markerCenter.y > p2.y))) {
-        position.x = i;
-        position.y = m_calibrationConfig->patternHeight-2-j;
-      }
-    }
-  }
-  return position;
-}
-
-
-bool IntrinsicsCalibrator::boardToCorners(cbdetect::Board &board,
-      cbdetect::Corner &cbCorners, std::vector<cv::Point2f> &corners) {
-  if (board.idx.size()-2 == m_calibrationConfig->patternHeight) {
-    for(int i = 1; i < board.idx.size() - 1; ++i) {
-      if (board.idx[i].size()-2 == m_calibrationConfig->patternWidth) {
-        for(int j = 1; j < board.idx[i].size() - 1; ++j) {
-          if(board.idx[i][j] < 0 || board.idx[i][j] >= cbCorners.p.size()) {
-            return false;
-          }
-          corners.push_back(static_cast<cv::Point2f>(
-                cbCorners.p[board.idx[i][j]]));
-        }
-      }
-      else {
-        return false;
-      }
-    }
-  }
-  else {
-    for(int j = 1; j < board.idx[0].size() - 1; ++j) {
-      for(int i = 1; i < board.idx.size() - 1; ++i) {
-        if (board.idx.size()-2 == m_calibrationConfig->patternWidth &&
-            board.idx[i].size()-2 == m_calibrationConfig->patternHeight) {
-          if(board.idx[board.idx.size() - 1 -i][j] < 0) {
-            return false;
-          }
-          if (board.idx[board.idx.size() - 1 -i][j] >= cbCorners.p.size()) {
-            return false;
-          }
-          corners.push_back(static_cast<cv::Point2f>(
-                cbCorners.p[board.idx[board.idx.size() - 1 -i][j]]));
-        }
-        else {
-          return false;
-        }
-      }
-    }
-  }
-  return true;
-}
-
-
 void IntrinsicsCalibrator::calibrationCanceledSlot() {
   m_interrupt = true;
 }
@@ -11,10 +11,9 @@
 #define INTRINSICSCALIBRATOR_H
 
 #include "globals.hpp"
-
-#include "boards_from_corners.h"
-#include "config.h"
-#include "find_corners.h"
+#include "detectioncache.hpp"
+#include "boardprefilter.hpp"
+#include "boarddetector.hpp"
 
 #include "opencv2/core.hpp"
 #include "opencv2/imgproc.hpp"
@@ -29,6 +28,8 @@
 #include <vector>
 
 #include <QRunnable>
+#include <QThreadPool>
+#include <QScopedPointer>
 
 
 class IntrinsicsCalibrator : public QObject, public QRunnable {
@@ -36,7 +37,8 @@ class IntrinsicsCalibrator : public QObject, public QRunnable {
 
 	public:
 		explicit IntrinsicsCalibrator(CalibrationConfig *calibrationConfig,
-					const QString& cameraName, int threadNumber);
+					const QString& cameraName, int threadNumber,
+					DetectionStore *detectionStore, QThreadPool *detectorPool);
 		void run();
 
 	signals:
@@ -53,20 +55,26 @@ class IntrinsicsCalibrator : public QObject, public QRunnable {
 		cv::Mat D;
 		};
 
-			cv::Mat m_charucoPattern;
-			cv::Mat m_detectedPattern;
-
 		std::vector<cv::Point3f> m_checkerBoardPoints;
 		CalibrationConfig *m_calibrationConfig;
 			std::string m_parametersSavePath;
 			std::string m_cameraName;
 			int m_threadNumber;
 			bool m_interrupt = false;
+			QScopedPointer<BoardPrefilter> m_prefilter;
+			QScopedPointer<BoardDetector> m_boardDetector;
+			DetectionStore *m_detectionStore;
+			QThreadPool *m_detectorPool;
 			QList<QString> m_validRecordingFormats = {"avi", "mp4", "mov", "wmv",
 																								"AVI", "MP4", "WMV"};
 
 			void run_standard();
 			void run_charuco();
+			DetectionCache::Detection detectStandard(const cv::Mat &img,
+						int frameNumber);
+			DetectionCache::Detection detectCharuco(const cv::Mat &img,
+						int frameNumber, cv::Ptr<cv::aruco::CharucoBoard> board,
+						cv::Ptr<cv::aruco::DetectorParameters> charucoParams);
 
 			double intrinsicsCalibrationStep(
 						std::vector<std::vector<cv::Point3f>> &objectPoints,
@@ -79,13 +87,6 @@ class IntrinsicsCalibrator : public QObject, public QRunnable {
 						cv::Ptr<cv::aruco::CharucoBoard> board,
 						cv::Size size, double thresholdFactor);
 
-			bool checkRotation(std::vector< cv::Point2f> &corners1, cv::Mat &img1);
-			cv::Point2i getPositionOfMarkerOnBoard(
-						std::vector< cv::Point2f>&cornersBoard,
-						std::vector<cv::Point2f>&markerCorners);
-			int matchPattern();
-			bool boardToCorners(cbdetect::Board &board, cbdetect::Corner &cbCorners,
-						std::vector<cv::Point2f> &corners);
 			QString getFormat(const QString& path, const QString& cameraName);
 			void saveCheckerboard(const cv::Mat &img,
 						const std::vector<cv::Point2f> &corners, int counter);
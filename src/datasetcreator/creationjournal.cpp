@@ -0,0 +1,221 @@
+/*******************************************************************************
+ * File:			  creationjournal.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "creationjournal.hpp"
+
+#include "yaml-cpp/yaml.h"
+
+#include <QDir>
+#include <QFile>
+#include <QLockFile>
+#include <QSaveFile>
+
+#include <iostream>
+
+static const int JournalVersion = 1;
+
+
+CreationJournal::CreationJournal(const QString &datasetFolder, bool resume) :
+			m_resume(resume) {
+	QDir().mkpath(datasetFolder);
+	m_journalPath = datasetFolder + "/creation_journal.yaml";
+	if (resume) {
+		m_entries = read(m_journalPath);
+	}
+}
+
+
+bool CreationJournal::begin(const QString &key, const QString &fingerprint) {
+	//Anything recorded for different inputs or settings is stale
+	QMutexLocker locker(&m_mutex);
+	m_ownedKeys.insert(key);
+	if (m_resume) {
+		//Another worker might have finished the entry since the journal was read
+		QMap<QString, Entry> entries = read(m_journalPath);
+		if (entries.contains(key)) {
+			m_entries[key] = entries[key];
+		}
+	}
+	auto it = m_entries.find(key);
+	if (it != m_entries.end() && it->fingerprint == fingerprint) {
+		it->resumed = true;
+		return true;
+	}
+	Entry entry;
+	entry.fingerprint = fingerprint;
+	m_entries[key] = entry;
+	save();
+	return false;
+}
+
+
+bool CreationJournal::isResumed(const QString &key) const {
+	QMutexLocker locker(&m_mutex);
+	return m_entries.value(key).resumed;
+}
+
+
+bool CreationJournal::hasFrameNumbers(const QString &key) const {
+	QMutexLocker locker(&m_mutex);
+	return m_entries.value(key).hasFrameNumbers;
+}
+
+
+QList<int> CreationJournal::frameNumbers(const QString &key) const {
+	QMutexLocker locker(&m_mutex);
+	return m_entries.value(key).frameNumbers;
+}
+
+
+void CreationJournal::setFrameNumbers(const QString &key,
+			const QList<int> &frameNumbers) {
+	QMutexLocker locker(&m_mutex);
+	Entry &entry = m_entries[key];
+	entry.featuresDone = true;
+	entry.hasFrameNumbers = true;
+	entry.frameNumbers = frameNumbers;
+	save();
+}
+
+
+bool CreationJournal::isExtracted(const QString &key,
+			const QString &camera) const {
+	QMutexLocker locker(&m_mutex);
+	return m_entries.value(key).extractedCameras.contains(camera);
+}
+
+
+void CreationJournal::setExtracted(const QString &key, const QString &camera) {
+	QMutexLocker locker(&m_mutex);
+	Entry &entry = m_entries[key];
+	if (!entry.extractedCameras.contains(camera)) {
+		entry.extractedCameras.append(camera);
+		save();
+	}
+}
+
+
+void CreationJournal::setAnnotationsWritten(const QString &key) {
+	QMutexLocker locker(&m_mutex);
+	m_entries[key].annotationsWritten = true;
+	save();
+}
+
+
+bool CreationJournal::isComplete(const QString &key,
+			const QList<QString> &cameras) const {
+	QMutexLocker locker(&m_mutex);
+	auto it = m_entries.constFind(key);
+	if (it == m_entries.constEnd() || !it->hasFrameNumbers ||
+				!it->annotationsWritten) {
+		return false;
+	}
+	for (const auto &camera : cameras) {
+		if (!it->extractedCameras.contains(camera)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool CreationJournal::isValidJpeg(const QString &path) {
+	//SOI at the start and EOI at the end catch missing and truncated frames
+	//without decoding anything
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly) || file.size() < 4) {
+		return false;
+	}
+	QByteArray start = file.read(2);
+	if (!file.seek(file.size() - 2)) {
+		return false;
+	}
+	QByteArray end = file.read(2);
+	return start == QByteArray("\xFF\xD8", 2) && end == QByteArray("\xFF\xD9", 2);
+}
+
+
+QMap<QString, CreationJournal::Entry> CreationJournal::read(
+			const QString &journalPath) {
+	QMap<QString, Entry> entries;
+	if (!QFile::exists(journalPath)) {
+		return entries;
+	}
+	try {
+		YAML::Node journal = YAML::LoadFile(journalPath.toStdString());
+		if (!journal["Version"] || journal["Version"].as<int>() != JournalVersion) {
+			return entries;
+		}
+		for (const auto &unit : journal["Units"]) {
+			Entry entry;
+			entry.fingerprint = QString::fromStdString(
+						unit.second["Fingerprint"].as<std::string>());
+			entry.featuresDone = unit.second["Features"].as<bool>(false);
+			if (unit.second["Frame Numbers"]) {
+				entry.hasFrameNumbers = true;
+				for (const auto &frameNumber : unit.second["Frame Numbers"]) {
+					entry.frameNumbers.append(frameNumber.as<int>());
+				}
+			}
+			for (const auto &camera : unit.second["Extracted Cameras"]) {
+				entry.extractedCameras.append(
+							QString::fromStdString(camera.as<std::string>()));
+			}
+			entry.annotationsWritten = unit.second["Annotations"].as<bool>(false);
+			entries[QString::fromStdString(unit.first.as<std::string>())] = entry;
+		}
+	}
+	catch (const YAML::Exception &e) {
+		std::cout << "Ignoring unreadable creation journal "
+							<< journalPath.toStdString() << ": " << e.what() << std::endl;
+		entries.clear();
+	}
+	return entries;
+}
+
+
+void CreationJournal::save() const {
+	//Rewritten as a whole on every stage, a crash leaves the previous version.
+	//Sharded workers share the file, so it is merged with what the others
+	//wrote under an inter-process lock.
+	QLockFile lock(m_journalPath + ".lock");
+	lock.lock();
+	QMap<QString, Entry> entries = read(m_journalPath);
+	for (const auto &key : m_ownedKeys) {
+		entries[key] = m_entries.value(key);
+	}
+	YAML::Node journal;
+	journal["Version"] = JournalVersion;
+	for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+		YAML::Node unit;
+		unit["Fingerprint"] = it->fingerprint.toStdString();
+		unit["Features"] = it->featuresDone;
+		if (it->hasFrameNumbers) {
+			unit["Frame Numbers"] = YAML::Node(YAML::NodeType::Sequence);
+			for (const auto &frameNumber : it->frameNumbers) {
+				unit["Frame Numbers"].push_back(frameNumber);
+			}
+		}
+		unit["Extracted Cameras"] = YAML::Node(YAML::NodeType::Sequence);
+		for (const auto &camera : it->extractedCameras) {
+			unit["Extracted Cameras"].push_back(camera.toStdString());
+		}
+		unit["Annotations"] = it->annotationsWritten;
+		journal["Units"][it.key().toStdString()] = unit;
+	}
+	YAML::Emitter emitter;
+	emitter << journal;
+	QSaveFile file(m_journalPath);
+	if (!file.open(QIODevice::WriteOnly) ||
+				file.write(emitter.c_str(), emitter.size()) !=
+				static_cast<qint64>(emitter.size()) || !file.commit()) {
+		std::cout << "Could not write creation journal "
+							<< m_journalPath.toStdString() << std::endl;
+	}
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * File:			  creationjournal.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef CREATIONJOURNAL_H
+#define CREATIONJOURNAL_H
+
+#include "globals.hpp"
+
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+
+
+class CreationJournal {
+	public:
+		explicit CreationJournal(const QString &datasetFolder, bool resume = true);
+		bool begin(const QString &key, const QString &fingerprint);
+		bool isResumed(const QString &key) const;
+		bool hasFrameNumbers(const QString &key) const;
+		QList<int> frameNumbers(const QString &key) const;
+		void setFrameNumbers(const QString &key, const QList<int> &frameNumbers);
+		bool isExtracted(const QString &key, const QString &camera) const;
+		void setExtracted(const QString &key, const QString &camera);
+		void setAnnotationsWritten(const QString &key);
+		bool isComplete(const QString &key, const QList<QString> &cameras) const;
+		static bool isValidJpeg(const QString &path);
+
+	private:
+		struct Entry {
+			QString fingerprint;
+			bool resumed = false;	//Not persisted, set if this run picked the entry up
+			bool featuresDone = false;
+			bool hasFrameNumbers = false;
+			QList<int> frameNumbers;
+			QList<QString> extractedCameras;
+			bool annotationsWritten = false;
+		};
+
+		QString m_journalPath;
+		bool m_resume;
+		QMap<QString, Entry> m_entries;
+		QSet<QString> m_ownedKeys;	//Entries this process works on, the rest belongs to other workers
+		mutable QMutex m_mutex;
+
+		static QMap<QString, Entry> read(const QString &journalPath);
+		void save() const;
+};
+
+#endif
@@ -12,18 +12,31 @@
 #include <QFile>
 #include <QDir>
 #include <QTextStream>
-#include <QDirIterator>
 #include <QThreadPool>
+#include <QThread>
+#include <QScopedPointer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QRegularExpression>
+#include <QSaveFile>
 
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
 #include <fstream>
+#include <numeric>
 #include <chrono>
 using namespace std::chrono;
 
+static const int ShardManifestVersion = 1;
+static const int ShardLockStaleTime = 10*60*1000;	//ms without refresh until another host may take over a unit
+static const int ShardLockRefreshInterval = 60*1000;	//ms
+
 
 DatasetCreator::DatasetCreator(DatasetConfig *datasetConfig) :
 			m_datasetConfig(datasetConfig) {
-	qRegisterMetaType<QList<cv::Mat>>();
-
 }
 
 
@@ -36,64 +49,459 @@ void DatasetCreator::createDatasetSlot(QList<RecordingItem> recordings,
 	m_entitiesList = entities;
 	m_keypointsList = keypoints;
 	m_skeleton = skeleton;
+	m_journal.reset(new CreationJournal(m_datasetConfig->datasetPath + "/" +
+				m_datasetConfig->datasetName, m_datasetConfig->resumeCreation));
+
+	QList<DatasetWorkUnit> units;
+	if (!planUnits(units)) {
+		return;
+	}
+	runPipeline(units);
+
+	if (!m_creationCanceled) {
+		emit datasetCreated();
+	}
+	createDatasetConfigFile(m_datasetConfig->datasetPath);
+}
+
+
+void DatasetCreator::planShardsSlot(QList<RecordingItem> recordings,
+			QList<QString> entities, QList<QString> keypoints,
+			QList<SkeletonComponent> skeleton, QString manifestPath) {
+	m_recordingItems = recordings;
+	m_entitiesList = entities;
+	m_keypointsList = keypoints;
+	m_skeleton = skeleton;
+	m_creationCanceled = false;
+	QList<DatasetWorkUnit> units;
+	if (!planUnits(units)) {
+		return;
+	}
+
+	//Everything a worker needs to rebuild the same units, settings that are
+	//not set through the new dataset window are left at their defaults
+	YAML::Node manifest;
+	manifest["Version"] = ShardManifestVersion;
+	manifest["Name"] = m_datasetConfig->datasetName.toStdString();
+	manifest["Path"] = m_datasetConfig->datasetPath.toStdString();
+	manifest["Frame Sets Recording"] = m_datasetConfig->frameSetsRecording;
+	manifest["Sampling Method"] = m_datasetConfig->samplingMethod.toStdString();
+	manifest["Spill Cache"] = m_datasetConfig->useSpillCache;
+	manifest["Keyframe Features"] = m_datasetConfig->keyframeFeatures;
+	manifest["Reference Cameras"] = YAML::Node(YAML::NodeType::Sequence);
+	for (const auto &camera : m_datasetConfig->referenceCameras) {
+		manifest["Reference Cameras"].push_back(camera.toStdString());
+	}
+	manifest["Auto Reference Cameras"] = m_datasetConfig->autoReferenceCameras;
+	manifest["Feature Reduction"] = m_datasetConfig->featureReduction.toStdString();
+	manifest["Reduced Dimensions"] = m_datasetConfig->reducedDimensions;
+	manifest["Coarse To Fine"] = m_datasetConfig->coarseToFine;
+	manifest["Coarse Stride"] = m_datasetConfig->coarseStride;
+	for (const auto &recording : m_recordingItems) {
+		YAML::Node recordingNode;
+		recordingNode["Name"] = recording.name.toStdString();
+		recordingNode["Path"] = recording.path.toStdString();
+		recordingNode["Segments"] = YAML::Node(YAML::NodeType::Sequence);
+		for (const auto &window : recording.timeLineList) {
+			YAML::Node segment;
+			segment["Name"] = window.name.toStdString();
+			segment["Start"] = window.start;
+			segment["End"] = window.end;
+			recordingNode["Segments"].push_back(segment);
+		}
+		manifest["Recordings"].push_back(recordingNode);
+	}
+	for (const auto &entity : m_entitiesList) {
+		manifest["Entities"].push_back(entity.toStdString());
+	}
+	for (const auto &keypoint : m_keypointsList) {
+		manifest["Keypoints"].push_back(keypoint.toStdString());
+	}
+	for (const auto &bone : m_skeleton) {
+		manifest["Skeleton"][bone.name.toStdString()]["Keypoints"].push_back(
+					bone.keypointA.toStdString());
+		manifest["Skeleton"][bone.name.toStdString()]["Keypoints"].push_back(
+					bone.keypointB.toStdString());
+		manifest["Skeleton"][bone.name.toStdString()]["Length"].push_back(
+					bone.length);
+	}
+	for (const auto &unit : units) {
+		manifest["Units"].push_back(unitId(unit).toStdString());
+	}
+	YAML::Emitter emitter;
+	emitter << manifest;
+	QSaveFile file(manifestPath);
+	if (!file.open(QIODevice::WriteOnly) ||
+				file.write(emitter.c_str(), emitter.size()) !=
+				static_cast<qint64>(emitter.size()) || !file.commit()) {
+		failCreation("Can't write shard manifest " + manifestPath);
+		return;
+	}
+	emit shardsPlanned(manifestPath, units.size());
+}
+
+
+bool DatasetCreator::runShardWorker(const QString &manifestPath) {
+	if (!loadShardManifest(manifestPath)) {
+		return false;
+	}
+	m_creationCanceled = false;
+	m_journal.reset(new CreationJournal(m_datasetConfig->datasetPath + "/" +
+				m_datasetConfig->datasetName, true));
+	QList<DatasetWorkUnit> units;
+	if (!planUnits(units)) {
+		return false;
+	}
+	QDir().mkpath(shardDir());
+	runPipeline(units, true);
+	if (m_creationCanceled) {
+		return false;
+	}
+	//Every unit this worker claimed is done. Whoever finishes last writes the
+	//dataset file and reports it as created, the others leave it to them.
+	mergeShards(units);
+	return true;
+}
+
+
+bool DatasetCreator::mergeShards(const QString &manifestPath) {
+	QList<DatasetWorkUnit> units;
+	if (!loadShardManifest(manifestPath) || !planUnits(units)) {
+		return false;
+	}
+	if (!mergeShards(units)) {
+		emit datasetCreationFailed("Not all units are finished yet, start more "
+					"workers with --dataset-worker " + manifestPath);
+		return false;
+	}
+	return true;
+}
+
+
+bool DatasetCreator::compareReferenceCameras(const QString &manifestPath) {
+	//Nothing is written, every unit is clustered once on its reference cameras
+	//and once on all cameras
+	QList<DatasetWorkUnit> units;
+	if (!loadShardManifest(manifestPath) || !planUnits(units)) {
+		return false;
+	}
+	if (!usesFeatures()) {
+		emit datasetCreationFailed("Sampling method " +
+					m_datasetConfig->samplingMethod + " does not use features, there "
+					"are no reference cameras to compare");
+		return false;
+	}
+	if (m_datasetConfig->referenceCameras.isEmpty() &&
+				m_datasetConfig->autoReferenceCameras == 0) {
+		emit datasetCreationFailed("No reference cameras set in " + manifestPath);
+		return false;
+	}
+	m_creationCanceled = false;
+	m_executor.reset(new WorkStealingExecutor(m_datasetConfig->workerThreads));
+	bool success = true;
+	for (const auto &unit : units) {
+		DatasetWorkUnit featureUnit = unit;
+		featureUnit.cameras = referenceCameras(unit);
+		if (featureUnit.cameras.size() == unit.cameras.size()) {
+			if (m_datasetConfig->debug) {
+				std::cout << unitId(unit).toStdString() << ": reference cameras cover "
+									<< "all cameras, nothing to compare" << std::endl;
+			}
+			continue;
+		}
+		cv::Mat features;
+		QList<int> rowFrameNumbers;
+		if (!computeFeatures(featureUnit, features, rowFrameNumbers)) {
+			success = false;
+			break;
+		}
+		QList<QList<int>> frameNumbers = clusterSubsets(featureUnit, features,
+					rowFrameNumbers);
+		features.release();
+		compareWithAllCameras(unit, frameNumbers);
+	}
+	m_executor.reset();
+	return success;
+}
+
+
+bool DatasetCreator::compareDecodingPaths(const QString &manifestPath) {
+	//Nothing is written, the feature pass of every unit runs once on the
+	//default path and once on every alternative. Sampled frames and selections
+	//have to come out the same.
+	QList<DatasetWorkUnit> units;
+	if (!loadShardManifest(manifestPath) || !planUnits(units)) {
+		return false;
+	}
+	if (!usesFeatures()) {
+		emit datasetCreationFailed("Sampling method " +
+					m_datasetConfig->samplingMethod + " does not use features, there "
+					"is no feature pass to compare");
+		return false;
+	}
+	struct DecodingPath {
+		QString name;
+		bool sequentialDecoding;
+		bool chunkedScheduling;
+	};
+	const QList<DecodingPath> alternatives = {
+		{"seeking to every sample", false, true},
+		{"one job per camera", true, false},
+	};
+	//Cached features would be read back instead of decoded
+	DatasetConfig settings = *m_datasetConfig;
+	m_datasetConfig->useFeatureCache = false;
+	m_creationCanceled = false;
+	m_executor.reset(new WorkStealingExecutor(m_datasetConfig->workerThreads));
+	bool success = true;
+	for (const auto &unit : units) {
+		m_datasetConfig->sequentialDecoding = true;
+		m_datasetConfig->chunkedScheduling = true;
+		cv::Mat features;
+		QList<int> rowFrameNumbers;
+		if (!computeFeatures(unit, features, rowFrameNumbers)) {
+			success = false;
+			break;
+		}
+		QList<QList<int>> frameNumbers = clusterSubsets(unit, features,
+					rowFrameNumbers);
+		for (const auto &path : alternatives) {
+			m_datasetConfig->sequentialDecoding = path.sequentialDecoding;
+			m_datasetConfig->chunkedScheduling = path.chunkedScheduling;
+			cv::Mat pathFeatures;
+			QList<int> pathRowFrameNumbers;
+			if (!computeFeatures(unit, pathFeatures, pathRowFrameNumbers)) {
+				success = false;
+				break;
+			}
+			bool framesMatch = pathRowFrameNumbers == rowFrameNumbers;
+			double maxFeatureDiff = (!framesMatch || features.empty()) ? 0 :
+						cv::norm(features, pathFeatures, cv::NORM_INF);
+			bool selectionsMatch = clusterSubsets(unit, pathFeatures,
+						pathRowFrameNumbers) == frameNumbers;
+			emit decodingPathsCompared(unitId(unit), path.name, framesMatch,
+						selectionsMatch, maxFeatureDiff);
+			success = success && framesMatch && selectionsMatch;
+		}
+		if (m_creationCanceled) {
+			break;
+		}
+	}
+	m_executor.reset();
+	*m_datasetConfig = settings;
+	return success;
+}
+
+bool DatasetCreator::loadShardManifest(const QString &manifestPath) {
+	try {
+		YAML::Node manifest = YAML::LoadFile(manifestPath.toStdString());
+		if (!manifest["Version"] ||
+					manifest["Version"].as<int>() != ShardManifestVersion) {
+			emit datasetCreationFailed("Unsupported shard manifest " + manifestPath);
+			return false;
+		}
+		m_datasetConfig->datasetName = QString::fromStdString(
+					manifest["Name"].as<std::string>());
+		m_datasetConfig->datasetPath = QString::fromStdString(
+					manifest["Path"].as<std::string>());
+		m_datasetConfig->frameSetsRecording =
+					manifest["Frame Sets Recording"].as<int>();
+		m_datasetConfig->samplingMethod = QString::fromStdString(
+					manifest["Sampling Method"].as<std::string>());
+		//Missing in manifests of older versions, those keep the defaults
+		if (manifest["Spill Cache"]) {
+			m_datasetConfig->useSpillCache = manifest["Spill Cache"].as<bool>();
+		}
+		if (manifest["Keyframe Features"]) {
+			m_datasetConfig->keyframeFeatures =
+						manifest["Keyframe Features"].as<bool>();
+		}
+		if (manifest["Reference Cameras"]) {
+			m_datasetConfig->referenceCameras.clear();
+			for (const auto &camera : manifest["Reference Cameras"]) {
+				m_datasetConfig->referenceCameras.append(QString::fromStdString(
+							camera.as<std::string>()));
+			}
+		}
+		if (manifest["Auto Reference Cameras"]) {
+			m_datasetConfig->autoReferenceCameras =
+						manifest["Auto Reference Cameras"].as<int>();
+		}
+		if (manifest["Feature Reduction"]) {
+			m_datasetConfig->featureReduction = QString::fromStdString(
+						manifest["Feature Reduction"].as<std::string>());
+			m_datasetConfig->reducedDimensions =
+						manifest["Reduced Dimensions"].as<int>();
+		}
+		if (manifest["Coarse To Fine"]) {
+			m_datasetConfig->coarseToFine = manifest["Coarse To Fine"].as<bool>();
+			m_datasetConfig->coarseStride = manifest["Coarse Stride"].as<int>();
+		}
+		m_recordingItems.clear();
+		for (const auto &recordingNode : manifest["Recordings"]) {
+			RecordingItem recording;
+			recording.name = QString::fromStdString(
+						recordingNode["Name"].as<std::string>());
+			recording.path = QString::fromStdString(
+						recordingNode["Path"].as<std::string>());
+			for (const auto &segment : recordingNode["Segments"]) {
+				TimeLineWindow window;
+				window.name = QString::fromStdString(segment["Name"].as<std::string>());
+				window.start = segment["Start"].as<int>();
+				window.end = segment["End"].as<int>();
+				recording.timeLineList.append(window);
+			}
+			m_recordingItems.append(recording);
+		}
+		m_entitiesList.clear();
+		for (const auto &entity : manifest["Entities"]) {
+			m_entitiesList.append(QString::fromStdString(entity.as<std::string>()));
+		}
+		m_keypointsList.clear();
+		for (const auto &keypoint : manifest["Keypoints"]) {
+			m_keypointsList.append(QString::fromStdString(keypoint.as<std::string>()));
+		}
+		m_skeleton.clear();
+		for (const auto &joint : manifest["Skeleton"]) {
+			SkeletonComponent component;
+			component.name = QString::fromStdString(joint.first.as<std::string>());
+			component.keypointA = QString::fromStdString(
+						joint.second["Keypoints"][0].as<std::string>());
+			component.keypointB = QString::fromStdString(
+						joint.second["Keypoints"][1].as<std::string>());
+			component.length = joint.second["Length"][0].as<float>();
+			m_skeleton.append(component);
+		}
+	}
+	catch (const YAML::Exception &e) {
+		emit datasetCreationFailed("Can't read shard manifest " + manifestPath +
+					": " + e.what());
+		return false;
+	}
+	return true;
+}
+
+
+bool DatasetCreator::mergeShards(const QList<DatasetWorkUnit> &units) {
+	CreationJournal journal(m_datasetConfig->datasetPath + "/" +
+				m_datasetConfig->datasetName, true);
+	for (const auto &unit : units) {
+		for (const auto &subset : unitSubsets(unit)) {
+			if (!journal.isComplete(journalKey(unit, subset), unit.cameras)) {
+				return false;
+			}
+		}
+	}
+	QLockFile lock(shardDir() + "/merge.lock");
+	lock.lock();
+	createDatasetConfigFile(m_datasetConfig->datasetPath);
+	emit datasetCreated();
+	return true;
+}
+
+
+QString DatasetCreator::unitId(const DatasetWorkUnit &unit) {
+	return unit.subsetName == "" ? unit.recordingName :
+				unit.recordingName + "/" + unit.subsetName;
+}
+
+
+QString DatasetCreator::shardDir() {
+	return m_datasetConfig->datasetPath + "/" + m_datasetConfig->datasetName +
+				"/.shards";
+}
+
+
+bool DatasetCreator::claimUnit(const DatasetWorkUnit &unit) {
+	//The lock is held until the unit is done and refreshed while it runs.
+	//Locks of crashed workers on the same host are stale right away, those of
+	//other hosts once they were not refreshed for ShardLockStaleTime.
+	QSharedPointer<QLockFile> lock(new QLockFile(unitLockPath(unitId(unit))));
+	lock->setStaleLockTime(ShardLockStaleTime);
+	if (!lock->tryLock(0)) {
+		return false;
+	}
+	QMutexLocker locker(&m_shardMutex);
+	m_shardLocks[unitId(unit)] = lock;
+	return true;
+}
+
+
+void DatasetCreator::releaseUnit(const DatasetWorkUnit &unit) {
+	QMutexLocker locker(&m_shardMutex);
+	m_shardLocks.remove(unitId(unit));
+}
+
+
+QString DatasetCreator::unitLockPath(const QString &unitId) {
+	QString name = unitId;
+	name.replace(QRegularExpression("[^A-Za-z0-9_-]"), "_");
+	return shardDir() + "/" + name + ".lock";
+}
+
+
+void DatasetCreator::refreshUnitLocks() {
+	//Touching the lock file is enough, QLockFile judges staleness by its age
+	QMutexLocker locker(&m_shardMutex);
+	while (m_refreshingLocks) {
+		m_refreshLocksChanged.wait(&m_shardMutex, ShardLockRefreshInterval);
+		for (auto it = m_shardLocks.constBegin(); it != m_shardLocks.constEnd();
+					++it) {
+			QFile lockFile(unitLockPath(it.key()));
+			if (!lockFile.open(QIODevice::ReadWrite) || !lockFile.setFileTime(
+						QDateTime::currentDateTime(), QFileDevice::FileModificationTime)) {
+				std::cout << "Could not refresh " << lockFile.fileName().toStdString()
+									<< std::endl;
+			}
+		}
+	}
+}
+
+
+bool DatasetCreator::planUnits(QList<DatasetWorkUnit> &units) {
+	//Probe all recordings up front, everything after that is pipelined
 	for (const auto & recording : m_recordingItems) {
-		m_dctMap.clear();
-		QList<QString> cameras = getCameraNames(recording.path);	//TODO: Check if all recordings in one Dataset have the same cameras!
-		m_datasetConfig->numCameras = cameras.size();
-		emit recordingBeingProcessedChanged(recording.name, cameras);
-		m_datasetConfig->videoFormat = getVideoFormat(recording.path);
-		if (m_datasetConfig->videoFormat == "") {
+		QSharedPointer<RecordingIndex> recordingIndex = RecordingIndex::open(
+					recording.path, m_datasetConfig->validRecordingFormats);
+		QList<QString> cameras = recordingIndex->cameraNames();	//TODO: Check if all recordings in one Dataset have the same cameras!
+		QString videoFormat = recordingIndex->videoFormat();
+		if (videoFormat == "") {
 			emit datasetCreationFailed("All videos must have the same format!");
-			return;
+			return false;
 		}
 		if (!checkFrameCounts(recording.path, cameras)) {
 			emit datasetCreationFailed("Frame count mismatch!");
-			return;
+			return false;
 		}
 		if (recording.timeLineList.size() == 0) {
 			QList<TimeLineWindow> timeLineWindows;
 			TimeLineWindow fullWindow;
-			cv::VideoCapture cap((recording.path + "/" + cameras[0] + "." +
-											      m_datasetConfig->videoFormat).toStdString());
 			fullWindow.name = recording.name;
 			fullWindow.start = 0;
-	    fullWindow.end = cap.get(cv::CAP_PROP_FRAME_COUNT);
-			cap.release();
+			fullWindow.end = recordingIndex->video(cameras[0]).frameCount;
 			timeLineWindows.append(fullWindow);
-			emit currentSegmentChanged("");
-			QList<int> frameNumbers = extractFrames(recording.path, timeLineWindows,
-						cameras);
-			if (!m_creationCanceled) {
-				QString savepath;
-					savepath = m_datasetConfig->datasetPath + "/" +
-									   m_datasetConfig->datasetName + "/" + recording.name;
-				createSavefile(recording.path, cameras, savepath, frameNumbers);
-			}
+			QString savepath = m_datasetConfig->datasetPath + "/" +
+						m_datasetConfig->datasetName + "/" + recording.name;
+			units.append(createWorkUnit(recording, "", timeLineWindows, cameras,
+						videoFormat, savepath));
 		}
 		QMap<QString, QList<TimeLineWindow>> recordingSubsets =
 					getRecordingSubsets(recording.timeLineList);
+		if (m_datasetConfig->singlePassSubsets && recordingSubsets.size() > 1) {
+			units.append(createRecordingUnit(recording, recordingSubsets, cameras,
+						videoFormat));
+			continue;
+		}
 
 		for (const auto &subsetName : recordingSubsets.keys()) {
-			emit currentSegmentChanged(subsetName);
-			QList<int> frameNumbers = extractFrames(recording.path,
-						recordingSubsets[subsetName], cameras);
-			if (!m_creationCanceled) {
-				QString savepath;
-				savepath = m_datasetConfig->datasetPath + "/" +
-									 m_datasetConfig->datasetName + "/" +
-									 recording.name + "/" + subsetName;
-				createSavefile(recording.path, cameras, savepath, frameNumbers);
-			}
-			else {
-				break;
-			}
+			QString savepath = m_datasetConfig->datasetPath + "/" +
+						m_datasetConfig->datasetName + "/" +
+						recording.name + "/" + subsetName;
+			units.append(createWorkUnit(recording, subsetName,
+						recordingSubsets[subsetName], cameras, videoFormat, savepath));
 		}
 	}
-
-	if (!m_creationCanceled) {
-		emit datasetCreated();
-	}
-	createDatasetConfigFile(m_datasetConfig->datasetPath);
+	return true;
 }
 
 
@@ -103,6 +511,7 @@ void DatasetCreator::createDatasetConfigFile(const QString& path) {
 	config["Name"] = m_datasetConfig->datasetName.toStdString();
 	config["Date of creation"] =
 				QDate::currentDate().toString(Qt::ISODate).toStdString();
+	config["Sampling Method"] = m_datasetConfig->samplingMethod.toStdString();
 	for (const auto & recording : m_recordingItems) {
 		config["Recordings"][recording.name.toStdString()] = YAML::Node();
 		for (const auto &segment : recording.timeLineList) {
@@ -140,62 +549,26 @@ void DatasetCreator::createDatasetConfigFile(const QString& path) {
 
 
 QList<QString> DatasetCreator::getCameraNames(const QString& path) {
-	QList<QString> cameraNames;
-	for (QDirIterator it(path); it.hasNext();) {
-		QString subpath = it.next();
-		QString suffix = subpath.split('/').takeLast();
-		if (suffix != "." && suffix != "..") {
-			if (m_datasetConfig->validRecordingFormats.contains(
-						suffix.split(".").takeLast())) {
-				suffix = suffix.split(".").takeFirst();
-				cameraNames.append(suffix);
-			}
-		}
-	}
-	return cameraNames;
-}
-
-
-QString DatasetCreator::getVideoFormat(const QString& recording) {
-	QList <QString> formats;
-	for (QDirIterator it(recording); it.hasNext();) {
-		QString subpath = it.next();
-		QString suffix = subpath.split('/').takeLast();
-		if (suffix != "." && suffix != "..") {
-			suffix = suffix.split(".").takeLast();
-			if (m_datasetConfig->validRecordingFormats.contains(suffix)) {
-				formats.append(suffix);
-			}
-		}
-	}
-	if (formats.count(formats[0]) != formats.length()) {
-		return "";
-	}
-	else {
-		return formats[0];
-	}
+	return RecordingIndex::open(path,
+				m_datasetConfig->validRecordingFormats)->cameraNames();
 }
 
 
 bool DatasetCreator::checkFrameCounts(const QString& recording,
 			QList<QString> cameras) {
+	QSharedPointer<RecordingIndex> index = RecordingIndex::open(recording,
+				m_datasetConfig->validRecordingFormats);
 	int numFrames = -1;
 	for (const auto & camera : cameras) {
-		cv::VideoCapture cap((recording + "/" + camera + "." +
-					m_datasetConfig->videoFormat).toStdString());
-		if(!cap.isOpened()){
+		VideoInfo video = index->video(camera);
+		if (!video.opened) {
 			emit datasetCreationFailed("Error opening video stream or file");
-    	return false;
-  	}
-
-		int newNumFrames = cap.get(cv::CAP_PROP_FRAME_COUNT);
-		cap.release();
-		if (numFrames != -1 && newNumFrames != numFrames)  {
 			return false;
 		}
-		else {
-			numFrames = newNumFrames;
+		if (numFrames != -1 && video.frameCount != numFrames)  {
+			return false;
 		}
+		numFrames = video.frameCount;
 	}
 	return true;
 }
@@ -212,140 +585,1325 @@ QMap<QString, QList<TimeLineWindow>> DatasetCreator::getRecordingSubsets(
 }
 
 
-QList<int> DatasetCreator::extractFrames(const QString &path,
-			QList<TimeLineWindow> timeLineWindows, QList<QString> cameras) {
+DatasetWorkUnit DatasetCreator::createWorkUnit(const RecordingItem &recording,
+			const QString &subsetName, QList<TimeLineWindow> timeLineWindows,
+			QList<QString> cameras, const QString &videoFormat,
+			const QString &savePath) {
+	DatasetWorkUnit unit;
+	unit.recordingName = recording.name;
+	unit.recordingPath = recording.path;
+	unit.subsetName = subsetName;
+	unit.timeLineWindows = timeLineWindows;
+	unit.cameras = cameras;
+	unit.videoFormat = videoFormat;
+	unit.savePath = savePath;
+	if (usesFeatures()) {
+		unit.subSamplingRate = VideoStreamer::computeSubSamplingRate(
+					timeLineWindows, m_datasetConfig->frameSetsRecording);
+		unit.estimatedMemory = featureMemory(timeLineWindows, unit.subSamplingRate,
+					numReferenceCameras(cameras));
+		if (m_datasetConfig->useSpillCache) {
+			//The spill cache lives until the frames are extracted
+			unit.spillMemory = static_cast<qint64>(
+						m_datasetConfig->spillCacheMemoryMB) * 1024 * 1024;
+			unit.estimatedMemory += unit.spillMemory;
+		}
+	}
+	return unit;
+}
+
+
+DatasetWorkUnit DatasetCreator::createRecordingUnit(
+			const RecordingItem &recording,
+			const QMap<QString, QList<TimeLineWindow>> &recordingSubsets,
+			QList<QString> cameras, const QString &videoFormat) {
+	//Windows of all subsets sorted by start, so every camera is decoded in a
+	//single forward pass
+	QList<TimeLineWindow> timeLineWindows;
+	for (const auto &windows : recordingSubsets) {
+		timeLineWindows.append(windows);
+	}
+	std::stable_sort(timeLineWindows.begin(), timeLineWindows.end(),
+				[](const TimeLineWindow &a, const TimeLineWindow &b) {
+		return a.start < b.start;
+	});
+	QString savepath = m_datasetConfig->datasetPath + "/" +
+				m_datasetConfig->datasetName + "/" + recording.name;
+	DatasetWorkUnit unit = createWorkUnit(recording, "", timeLineWindows,
+				cameras, videoFormat, savepath);
+	int subSamplingRate = 0;
+	for (const auto &subsetName : recordingSubsets.keys()) {
+		DatasetSubset subset;
+		subset.subsetName = subsetName;
+		subset.timeLineWindows = recordingSubsets[subsetName];
+		subset.savePath = savepath + "/" + subsetName;
+		if (usesFeatures()) {
+			subset.subSamplingRate = VideoStreamer::computeSubSamplingRate(
+						subset.timeLineWindows, m_datasetConfig->frameSetsRecording);
+		}
+		subSamplingRate = std::gcd(subSamplingRate, subset.subSamplingRate);
+		unit.subsets.append(subset);
+	}
+	if (usesFeatures()) {
+		//Each subset samples every n-th frame of the shared grid, so clustering a
+		//slice sees exactly the samples a separate pass would have produced
+		unit.subSamplingRate = subSamplingRate;
+		unit.estimatedMemory = featureMemory(timeLineWindows, subSamplingRate,
+					numReferenceCameras(cameras)) + unit.spillMemory;
+	}
+	return unit;
+}
+
+
+qint64 DatasetCreator::featureMemory(QList<TimeLineWindow> timeLineWindows,
+			int subSamplingRate, int numCameras) {
+	//One row per sample in the clustering matrix, all cameras side by side
+	qint64 numSamples = VideoStreamer::numSamples(timeLineWindows,
+				subSamplingRate);
+	return numSamples * numCameras * DCTFeatureExtractor::FeatureWidth *
+				DCTFeatureExtractor::FeatureHeight * sizeof(float);
+}
+
+
+QList<DatasetSubset> DatasetCreator::unitSubsets(const DatasetWorkUnit &unit) {
+	if (!unit.subsets.isEmpty()) {
+		return unit.subsets;
+	}
+	DatasetSubset subset;
+	subset.subsetName = unit.subsetName;
+	subset.timeLineWindows = unit.timeLineWindows;
+	subset.savePath = unit.savePath;
+	subset.subSamplingRate = unit.subSamplingRate;
+	return {subset};
+}
+
+
+QString DatasetCreator::journalKey(const DatasetWorkUnit &unit,
+			const DatasetSubset &subset) {
+	return subset.subsetName == "" ? unit.recordingName :
+				unit.recordingName + "/" + subset.subsetName;
+}
+
+
+QString DatasetCreator::subsetFingerprint(const DatasetWorkUnit &unit,
+			const DatasetSubset &subset) {
+	//Everything that changes which frames get picked or how they are written
+	QStringList parts;
+	parts << unit.recordingPath << unit.videoFormat;
+	for (const auto &camera : unit.cameras) {
+		QFileInfo video(unit.recordingPath + "/" + camera + "." + unit.videoFormat);
+		parts << camera << QString::number(video.size())
+					<< QString::number(video.lastModified().toMSecsSinceEpoch());
+	}
+	for (const auto &window : subset.timeLineWindows) {
+		parts << QString::number(window.start) + "-" + QString::number(window.end);
+	}
+	const DatasetConfig *config = m_datasetConfig;
+	parts << config->samplingMethod
+				<< QString::number(config->frameSetsRecording)
+				<< QString::number(config->keyframeFeatures)
+				<< QString::number(config->refineSelection)
+				<< config->referenceCameras.join(",")
+				<< QString::number(config->autoReferenceCameras)
+				<< QString::number(config->referenceProbeFrames)
+				<< config->featureReduction
+				<< QString::number(config->reducedDimensions)
+				<< QString::number(config->coarseToFine)
+				<< QString::number(config->coarseStride)
+				<< QString::number(config->coarseChangeThreshold)
+				<< QString::number(config->clusteringBatchSize)
+				<< QString::number(config->clusteringIterations)
+				<< QString::number(config->clusteringAttempts)
+				<< QString::number(config->jpegQuality) << config->jpegSubsampling
+				<< QString::number(config->mjpegPassthrough);
+	return QCryptographicHash::hash(parts.join("|").toUtf8(),
+				QCryptographicHash::Sha1).toHex();
+}
+
+
+bool DatasetCreator::usesFeatures() const {
+	//Every sampler except uniform picks frames from the VideoStreamer features
+	return m_datasetConfig->samplingMethod == "kmeans" ||
+				m_datasetConfig->samplingMethod == "kcenter" ||
+				m_datasetConfig->samplingMethod == "motion";
+}
+
+
+int DatasetCreator::numReferenceCameras(const QList<QString> &cameras) {
+	int numCameras = 0;
+	for (const auto &camera : cameras) {
+		numCameras += m_datasetConfig->referenceCameras.contains(camera);
+	}
+	if (numCameras > 0) {
+		return numCameras;
+	}
+	if (m_datasetConfig->autoReferenceCameras > 0) {
+		return std::min(m_datasetConfig->autoReferenceCameras,
+					static_cast<int>(cameras.size()));
+	}
+	return cameras.size();
+}
+
+
+QList<QString> DatasetCreator::referenceCameras(const DatasetWorkUnit &unit) {
+	QList<QString> cameras;
+	for (const auto &camera : unit.cameras) {
+		if (m_datasetConfig->referenceCameras.contains(camera)) {
+			cameras.append(camera);
+		}
+	}
+	for (const auto &camera : m_datasetConfig->referenceCameras) {
+		if (!unit.cameras.contains(camera) && m_datasetConfig->debug) {
+			std::cout << unit.recordingPath.toStdString() << ": reference camera "
+								<< camera.toStdString() << " not found" << std::endl;
+		}
+	}
+	if (!cameras.isEmpty()) {
+		return cameras;
+	}
+	if (m_datasetConfig->autoReferenceCameras > 0 &&
+				m_datasetConfig->autoReferenceCameras < unit.cameras.size()) {
+		return probeReferenceCameras(unit, m_datasetConfig->autoReferenceCameras);
+	}
+	return unit.cameras;
+}
+
+
+QList<QString> DatasetCreator::probeReferenceCameras(
+			const DatasetWorkUnit &unit, int numCameras) {
+	//A few frames spread evenly over the unit, moved back onto the preceding
+	//keyframe where the index allows it so each probe costs a single decode
+	QSharedPointer<SeekIndex> seekIndex;
+	if (m_datasetConfig->useSeekIndex) {
+		seekIndex = SeekIndex::open(unit.recordingPath + "/" + unit.cameras[0] +
+					"." + unit.videoFormat);
+	}
+	qint64 totalFrames = 0;
+	for (const auto &window : unit.timeLineWindows) {
+		totalFrames += window.end - window.start;
+	}
+	double spacing = static_cast<double>(totalFrames) /
+				std::max(1, m_datasetConfig->referenceProbeFrames);
+	double position = spacing / 2;
+	qint64 offset = 0;
+	DatasetWorkUnit probeUnit = unit;
+	probeUnit.subsets.clear();
+	probeUnit.subSamplingRate = 1;
+	probeUnit.timeLineWindows.clear();
+	for (const auto &window : unit.timeLineWindows) {
+		int length = window.end - window.start;
+		for (; position < offset + length; position += spacing) {
+			TimeLineWindow probe = window;
+			probe.start = window.start + static_cast<int>(position - offset);
+			if (seekIndex && seekIndex->isValid()) {
+				probe.start = std::max(window.start,
+							seekIndex->keyFrameBefore(probe.start));
+			}
+			probe.end = probe.start + 1;
+			probeUnit.timeLineWindows.append(probe);
+		}
+		offset += length;
+	}
+	std::stable_sort(probeUnit.timeLineWindows.begin(),
+				probeUnit.timeLineWindows.end());
+
+	cv::Mat features;
+	QList<int> rowFrameNumbers;
+	if (!computeFeatures(probeUnit, features, rowFrameNumbers) ||
+				features.rows < 2) {
+		return unit.cameras;
+	}
+	//Total variance of every camera's feature block, the most varied views
+	//separate the postures best
+	const int featureSize = DCTFeatureExtractor::FeatureWidth *
+				DCTFeatureExtractor::FeatureHeight;
+	QList<QPair<double,int>> variances;
+	for (int i = 0; i < unit.cameras.size(); i++) {
+		cv::Mat block = features.colRange(i*featureSize, (i+1)*featureSize);
+		cv::Mat mean;
+		cv::reduce(block, mean, 0, cv::REDUCE_AVG);
+		double variance = 0;
+		for (int row = 0; row < block.rows; row++) {
+			variance += cv::norm(block.row(row), mean, cv::NORM_L2SQR);
+		}
+		variances.append(qMakePair(variance / block.rows, i));
+	}
+	std::stable_sort(variances.begin(), variances.end(),
+				[](const QPair<double,int> &a, const QPair<double,int> &b) {
+		return a.first > b.first;
+	});
+	QList<bool> picked(unit.cameras.size(), false);
+	for (int i = 0; i < numCameras; i++) {
+		picked[variances[i].second] = true;
+	}
+	QList<QString> cameras;
+	for (int i = 0; i < unit.cameras.size(); i++) {
+		if (picked[i]) {
+			cameras.append(unit.cameras[i]);
+		}
+	}
+	if (m_datasetConfig->debug) {
+		std::cout << unit.recordingPath.toStdString() << ": reference cameras "
+							<< cameras.join(" ").toStdString() << " (probed "
+							<< features.rows << " frames)" << std::endl;
+	}
+	return cameras;
+}
+
+
+void DatasetCreator::runPipeline(const QList<DatasetWorkUnit> &units,
+			bool sharded) {
+	QThreadPool unitPool;
+	unitPool.setMaxThreadCount(std::max(1, m_datasetConfig->recordingsInFlight));
+	m_unitsInFlight = 0;
+	m_featurePassRunning = false;
+	m_reservedMemory = 0;
+	QScopedPointer<QThread> lockRefresher;
+	if (sharded) {
+		m_refreshingLocks = true;
+		lockRefresher.reset(QThread::create([this]() {refreshUnitLocks();}));
+		lockRefresher->start();
+	}
+	m_executor.reset(new WorkStealingExecutor(m_datasetConfig->workerThreads));
+	if (m_datasetConfig->useJpegEncoderPool) {
+		m_encoderPool.reset(new JpegEncoderPool(m_datasetConfig->encoderThreads,
+					m_datasetConfig->encoderQueueSize, m_datasetConfig->jpegQuality,
+					m_datasetConfig->jpegSubsampling));
+	}
+	for (const auto &unit : units) {
+		//Units other workers are on are left to them
+		if (sharded && !claimUnit(unit)) {
+			continue;
+		}
+		if (!startUnit(unit)) {
+			if (sharded) {
+				releaseUnit(unit);
+			}
+			break;
+		}
+		unitPool.start([this, unit, sharded]() {
+			processUnit(unit);
+			if (sharded) {
+				releaseUnit(unit);
+			}
+			finishUnit();
+		});
+	}
+	//Units only read the cancel flag, nothing in here needs an event loop
+	unitPool.waitForDone();
+	if (!lockRefresher.isNull()) {
+		m_shardMutex.lock();
+		m_refreshingLocks = false;
+		m_refreshLocksChanged.wakeAll();
+		m_shardMutex.unlock();
+		lockRefresher->wait();
+	}
+	m_encoderPool.reset();
+	m_executor.reset();
+}
+
+
+bool DatasetCreator::startUnit(const DatasetWorkUnit &unit) {
+	//Only one feature pass at a time, the next unit starts decoding while the
+	//previous ones are clustering and extracting frames. Blocks until the
+	//pipeline has room or the creation is canceled.
+	QMutexLocker locker(&m_pipelineMutex);
+	qint64 memoryCap = static_cast<qint64>(m_datasetConfig->pipelineMemoryMB) *
+				1024 * 1024;
+	while (!m_creationCanceled && (m_featurePassRunning ||
+				m_unitsInFlight >= std::max(1, m_datasetConfig->recordingsInFlight) ||
+				(m_unitsInFlight > 0 &&
+				m_reservedMemory + unit.estimatedMemory > memoryCap))) {
+		m_pipelineChanged.wait(&m_pipelineMutex);
+	}
+	if (m_creationCanceled) {
+		return false;
+	}
+	m_unitsInFlight++;
+	m_featurePassRunning = true;
+	m_reservedMemory += unit.estimatedMemory;
+	return true;
+}
+
+
+void DatasetCreator::finishFeaturePass() {
+	QMutexLocker locker(&m_pipelineMutex);
+	m_featurePassRunning = false;
+	m_pipelineChanged.wakeAll();
+}
+
+
+void DatasetCreator::releaseUnitMemory(qint64 memory) {
+	QMutexLocker locker(&m_pipelineMutex);
+	m_reservedMemory -= memory;
+	m_pipelineChanged.wakeAll();
+}
+
+
+void DatasetCreator::finishUnit() {
+	QMutexLocker locker(&m_pipelineMutex);
+	m_unitsInFlight--;
+	m_pipelineChanged.wakeAll();
+}
+
+
+void DatasetCreator::processUnit(const DatasetWorkUnit &unit) {
+	emit recordingBeingProcessedChanged(unit.recordingName, unit.cameras);
+	emit currentSegmentChanged(unit.subsetName);
+	QList<DatasetSubset> subsets = unitSubsets(unit);
+	QList<QList<int>> frameNumbers;
+	QScopedPointer<FrameSpillCache> spillCache;
+
+	//Subsets whose journal entry matches the inputs pick up where the last
+	//run stopped
+	bool complete = true;
+	bool selectedBefore = true;
+	for (const auto &subset : subsets) {
+		QString key = journalKey(unit, subset);
+		m_journal->begin(key, subsetFingerprint(unit, subset));
+		complete = complete && m_journal->isComplete(key, unit.cameras);
+		selectedBefore = selectedBefore && m_journal->hasFrameNumbers(key);
+	}
+	if (complete) {
+		if (m_datasetConfig->debug) {
+			std::cout << unit.savePath.toStdString() << ": already created, skipping"
+								<< std::endl;
+		}
+		finishFeaturePass();
+		releaseUnitMemory(unit.estimatedMemory);
+		return;
+	}
+
+	if (selectedBefore) {
+		finishFeaturePass();
+		for (const auto &subset : subsets) {
+			frameNumbers.append(m_journal->frameNumbers(journalKey(unit, subset)));
+		}
+	}
+	else if (usesFeatures()) {
+		if (m_datasetConfig->useSpillCache) {
+			spillCache.reset(new FrameSpillCache(unit.spillMemory,
+						static_cast<qint64>(m_datasetConfig->spillCacheDiskMB) * 1024 * 1024,
+						m_datasetConfig->spillCachePath));
+		}
+		//Only the reference cameras are decoded for the features, extraction
+		//still covers every camera
+		DatasetWorkUnit featureUnit = unit;
+		featureUnit.cameras = referenceCameras(unit);
+		bool reduced = featureUnit.cameras.size() < unit.cameras.size();
+		if (reduced) {
+			emit recordingBeingProcessedChanged(unit.recordingName,
+						featureUnit.cameras);
+		}
+		bool selected = m_datasetConfig->keyframeFeatures &&
+					selectFromKeyframes(featureUnit, frameNumbers, spillCache.data());
+		if (!selected && !m_creationCanceled && m_datasetConfig->coarseToFine) {
+			selected = selectCoarseToFine(featureUnit, frameNumbers,
+						spillCache.data());
+		}
+		if (selected || m_creationCanceled) {
+			finishFeaturePass();
+		}
+		else {
+			cv::Mat features;
+			QList<int> rowFrameNumbers;
+			bool computed = computeFeatures(featureUnit, features, rowFrameNumbers,
+						spillCache.data());
+			finishFeaturePass();
+			if (computed) {
+				frameNumbers = clusterSubsets(featureUnit, features, rowFrameNumbers);
+			}
+		}
+		if (reduced) {
+			emit recordingBeingProcessedChanged(unit.recordingName, unit.cameras);
+		}
+	}
+	else {
+		finishFeaturePass();
+		for (const auto &subset : subsets) {
+			frameNumbers.append(uniformFrameNumbers(subset.timeLineWindows));
+		}
+	}
+	if (!selectedBefore && !m_creationCanceled &&
+				frameNumbers.size() == subsets.size()) {
+		for (int i = 0; i < subsets.size(); i++) {
+			m_journal->setFrameNumbers(journalKey(unit, subsets[i]), frameNumbers[i]);
+		}
+	}
+	//Features are freed after clustering, extraction only holds bounded queues
+	//and the spill cache
+	releaseUnitMemory(unit.estimatedMemory - unit.spillMemory);
+	if (!m_creationCanceled) {
+		createSavefile(unit, subsets, frameNumbers, spillCache.data());
+	}
+	spillCache.reset();
+	releaseUnitMemory(unit.spillMemory);
+}
+
+
+QList<int> DatasetCreator::uniformFrameNumbers(
+			QList<TimeLineWindow> timeLineWindows) {
 	QList<int> frameNumbers;
+	float totalNumFrames = 0;
+	for (const auto& window : timeLineWindows) {
+		totalNumFrames += window.end-window.start;
+	}
+	float spacing = totalNumFrames / (m_datasetConfig->frameSetsRecording+1);
+	int  remainder = 0;
+	for (const auto& window : timeLineWindows) {
+		for (float num = window.start+spacing-remainder; num < window.end;
+					num += spacing) {
+			frameNumbers.append(static_cast<int>(num));
+			remainder = window.end - num;
+		}
+	}
+	return frameNumbers;
+}
+
 
-	if (m_datasetConfig->samplingMethod == "uniform") {
-		float totalNumFrames = 0;
-		for (const auto& window : timeLineWindows) {
-			totalNumFrames += window.end-window.start;
-		}
-		float spacing = totalNumFrames / (m_datasetConfig->frameSetsRecording+1);
-		int  remainder = 0;
-		for (const auto& window : timeLineWindows) {
-			for (float num = window.start+spacing-remainder; num < window.end;
-						num += spacing) {
-				frameNumbers.append(static_cast<int>(num));
-				remainder = window.end - num;
-			}
-		}
-	}
-
-	else if (m_datasetConfig->samplingMethod == "kmeans") {
-		QList <VideoStreamer*> streamers;
-		QThreadPool *threadPool = QThreadPool::globalInstance();
-		for (int i = 0; i < m_datasetConfig->numCameras; i++) {
-			VideoStreamer *streamer = new VideoStreamer(path + "/" + cameras[i] +
-						"." + m_datasetConfig->videoFormat, timeLineWindows,
-						m_datasetConfig->frameSetsRecording, i);
-			connect(streamer, &VideoStreamer::computedDCTs,
-							this, &DatasetCreator::computedDCTsSlot);
-			connect(this, &DatasetCreator::creationCanceled,
-							streamer, &VideoStreamer::creationCanceledSlot);
-			connect(streamer, &VideoStreamer::dctProgress,
-							this, &DatasetCreator::dctProgress);
+bool DatasetCreator::computeFeatures(const DatasetWorkUnit &unit,
+			cv::Mat &features, QList<int> &rowFrameNumbers,
+			FrameSpillCache *spillCache) {
+	int spanFrames = 0;
+	for (const auto& window : unit.timeLineWindows) {
+		spanFrames += window.end-window.start;
+	}
+	int numChunks = std::min(numChunksPerCamera(spanFrames, unit.cameras.size()),
+				std::max(1, spanFrames / m_datasetConfig->minChunkLength));
+	QList<QList<TimeLineWindow>> chunks = splitIntoChunks(unit.timeLineWindows,
+				unit.subSamplingRate, numChunks);
+	QList<int> chunkOffsets;
+	int numSamples = 0;
+	for (const auto &chunk : chunks) {
+		chunkOffsets.append(numSamples);
+		numSamples += VideoStreamer::numSamples(chunk, unit.subSamplingRate);
+	}
+
+	//One preallocated row per sample, every streamer writes its camera's
+	//columns of its chunk's rows
+	const int featureSize = DCTFeatureExtractor::FeatureWidth *
+				DCTFeatureExtractor::FeatureHeight;
+	cv::Mat featureMatrix = cv::Mat::zeros(numSamples,
+				featureSize*unit.cameras.size(), CV_32FC1);
+	ChunkResults results;
+	QList<FeatureCache*> featureCaches;
+	QList<VideoStreamer*> streamers;
+	QList<QRunnable*> jobs;
+	for (int i = 0; i < unit.cameras.size(); i++) {
+		QString videoPath = unit.recordingPath + "/" + unit.cameras[i] + "." +
+					unit.videoFormat;
+		FeatureCache *featureCache = nullptr;
+		if (m_datasetConfig->useFeatureCache) {
+			featureCache = new FeatureCache(videoPath,
+						m_datasetConfig->featureCachePath,
+						m_datasetConfig->featureCacheMaxMB);
+		}
+		featureCaches.append(featureCache);
+		//MJPEG frames are copied out of the container anyway, no need to spill
+		FrameSpillCache *cameraSpillCache = spillCache;
+		if (spillCache != nullptr && m_datasetConfig->mjpegPassthrough &&
+					MjpegPassthrough(videoPath, RecordingIndex::open(unit.recordingPath,
+					m_datasetConfig->validRecordingFormats)->video(
+					unit.cameras[i]).frameCount).isValid()) {
+			cameraSpillCache = nullptr;
+		}
+		for (int chunk = 0; chunk < chunks.size(); chunk++) {
+			int chunkSamples = VideoStreamer::numSamples(chunks[chunk],
+						unit.subSamplingRate);
+			cv::Mat featureRows = featureMatrix(
+						cv::Range(chunkOffsets[chunk], chunkOffsets[chunk] + chunkSamples),
+						cv::Range(i*featureSize, (i+1)*featureSize));
+			VideoStreamer *streamer = new VideoStreamer(videoPath, chunks[chunk],
+						unit.subSamplingRate, i, chunk, m_datasetConfig,
+						&m_creationCanceled, featureRows, featureCache, cameraSpillCache);
+			streamer->setAutoDelete(false);
+			connect(streamer, &VideoStreamer::computedDCTs, [&results](
+						QMap<int,int> frameNumbers, int threadNumber, int chunkNumber) {
+				QMutexLocker locker(&results.mutex);
+				results.frameNumberChunks[threadNumber][chunkNumber] = frameNumbers;
+			});
+			connect(streamer, &VideoStreamer::dctProgress, [this, &results](
+						int index, int windowSize, int threadNumber, int chunkNumber) {
+				int cameraIndex, cameraTotal;
+				updateChunkProgress(results, index, windowSize, threadNumber,
+							chunkNumber, cameraIndex, cameraTotal);
+				emit dctProgress(cameraIndex, cameraTotal, threadNumber);
+			});
 			streamers.append(streamer);
- 			threadPool->start(streamer);
+			jobs.append(streamer);
 		}
-		while (!threadPool->waitForDone(10)) {
-			QCoreApplication::instance()->processEvents();
+	}
+	m_executor->run(jobs);
+	qDeleteAll(streamers);
+	if (spillCache != nullptr && m_datasetConfig->debug) {
+		std::cout << unit.savePath.toStdString() << ": spilled "
+							<< spillCache->size() << " frames, "
+							<< spillCache->memoryUsed()/(1024*1024) << " MB in memory, "
+							<< spillCache->diskUsed()/(1024*1024) << " MB on disk"
+							<< std::endl;
+	}
+	for (auto featureCache : featureCaches) {
+		if (featureCache != nullptr) {
+			featureCache->save();
+			delete featureCache;
 		}
+	}
+	if (m_creationCanceled) {
+		return false;
+	}
+	features = featureMatrix;
+	collectValidRows(results, chunkOffsets, unit.cameras.size(), features,
+				rowFrameNumbers);
+	return true;
+}
 
-		QEventLoop loop;
-		connect(this, &DatasetCreator::gotAllDCTs, &loop, &QEventLoop::quit);
-		loop.exec();
 
-		emit startedClustering();
-		cv::Mat dctImagesList;
-		for (int i = 0; i < m_dctMap[0].size(); i++) {
-			cv::Mat dctImages;
-			for (const auto dctImage : m_dctMap) {
-				if (dctImages.empty()) {
-					dctImages = dctImage[i].clone();
+QList<int> DatasetCreator::clusterFeatures(const cv::Mat &features,
+			const QList<int> &rowFrameNumbers, cv::Mat *centers) {
+	QList<int> frameNumbers;
+	emit startedClustering();
+	if (m_datasetConfig->samplingMethod == "motion") {
+		//Motion energy needs the consecutive samples, not a projection
+		QList<int> rows = FrameSampler::motionWeightedRows(features,
+					rowFrameNumbers, m_datasetConfig->frameSetsRecording);
+		cv::Mat selected;
+		for (const auto &row : rows) {
+			frameNumbers.append(rowFrameNumbers[row]);
+			selected.push_back(features.row(row));
+		}
+		if (centers != nullptr) {
+			*centers = selected;
+		}
+		emit finishedClustering();
+		return frameNumbers;
+	}
+	//Every k-means iteration pays for every dimension, the projection is fitted
+	//once in a few streaming passes
+	QScopedPointer<FeatureProjection> projection;
+	cv::Mat clusteringFeatures = features;
+	if (m_datasetConfig->featureReduction != "none" &&
+				features.cols > m_datasetConfig->reducedDimensions &&
+				features.rows > m_datasetConfig->frameSetsRecording) {
+		projection.reset(new FeatureProjection(m_datasetConfig->reducedDimensions,
+					m_datasetConfig->featureReduction));
+		projection->fit(features);
+		clusteringFeatures = projection->project(features);
+		if (m_datasetConfig->featureReduction == "pca" && m_datasetConfig->debug) {
+			std::cout << "Projected " << features.cols << " feature dimensions to "
+								<< clusteringFeatures.cols << ", explained variance "
+								<< projection->explainedVariance() << std::endl;
+		}
+	}
+	if (m_datasetConfig->samplingMethod == "kcenter") {
+		cv::Mat selected;
+		for (const auto &row : FrameSampler::kCenterRows(clusteringFeatures,
+					m_datasetConfig->frameSetsRecording)) {
+			frameNumbers.append(rowFrameNumbers[row]);
+			selected.push_back(features.row(row));
+		}
+		if (centers != nullptr) {
+			*centers = selected;
+		}
+		emit finishedClustering();
+		return frameNumbers;
+	}
+	FeatureClustering clustering(m_datasetConfig->frameSetsRecording,
+				m_datasetConfig->clusteringBatchSize,
+				m_datasetConfig->clusteringIterations,
+				m_datasetConfig->clusteringAttempts);
+	for (const auto &row : clustering.representativeRows(clusteringFeatures)) {
+		frameNumbers.append(rowFrameNumbers[row]);
+	}
+	if (centers != nullptr) {
+		//Callers compare centers with unprojected features
+		*centers = projection ? projection->backProject(clustering.centers()) :
+					clustering.centers();
+	}
+	emit finishedClustering();
+	return frameNumbers;
+}
+
+
+QList<QList<int>> DatasetCreator::clusterSubsets(const DatasetWorkUnit &unit,
+			const cv::Mat &features, const QList<int> &rowFrameNumbers,
+			QList<cv::Mat> *centers) {
+	QList<QList<int>> frameNumbers;
+	for (const auto &subset : unitSubsets(unit)) {
+		cv::Mat subsetCenters;
+		if (unit.subsets.isEmpty()) {
+			frameNumbers.append(clusterFeatures(features, rowFrameNumbers,
+						&subsetCenters));
+		}
+		else {
+			emit currentSegmentChanged(subset.subsetName);
+			cv::Mat subsetFeatures;
+			QList<int> subsetFrameNumbers;
+			subsetRows(features, rowFrameNumbers, subset, subsetFeatures,
+						subsetFrameNumbers);
+			frameNumbers.append(clusterFeatures(subsetFeatures, subsetFrameNumbers,
+						&subsetCenters));
+		}
+		if (centers != nullptr) {
+			centers->append(subsetCenters);
+		}
+	}
+	return frameNumbers;
+}
+
+
+bool DatasetCreator::selectFromKeyframes(const DatasetWorkUnit &unit,
+			QList<QList<int>> &frameNumbers, FrameSpillCache *spillCache) {
+	//Rows need the same frame on every camera, so the first camera's keyframes
+	//are used for all of them. Synchronised rigs usually share the GOP layout,
+	//other cameras decode forward from their own preceding keyframe.
+	QSharedPointer<SeekIndex> seekIndex = SeekIndex::open(unit.recordingPath +
+				"/" + unit.cameras[0] + "." + unit.videoFormat);
+	if (!seekIndex->isValid()) {
+		if (m_datasetConfig->debug) {
+			std::cout << unit.recordingPath.toStdString() << ": no keyframe index, "
+								<< "using the dense feature pass" << std::endl;
+		}
+		return false;
+	}
+	DatasetWorkUnit keyframeUnit = unit;
+	keyframeUnit.subSamplingRate = 1;
+	keyframeUnit.timeLineWindows = keyframeWindows(unit.timeLineWindows,
+				*seekIndex, unit.subSamplingRate);
+	for (auto &subset : keyframeUnit.subsets) {
+		subset.timeLineWindows = keyframeWindows(subset.timeLineWindows,
+					*seekIndex, subset.subSamplingRate);
+		subset.subSamplingRate = 1;
+	}
+	//Same oversampling the dense pass aims for in computeSubSamplingRate
+	for (const auto &subset : unitSubsets(keyframeUnit)) {
+		if (subset.timeLineWindows.size() < 4*m_datasetConfig->frameSetsRecording) {
+			if (m_datasetConfig->debug) {
+				std::cout << unit.recordingPath.toStdString() << ": too few keyframes, "
+									<< "using the dense feature pass" << std::endl;
+			}
+			return false;
+		}
+	}
+
+	//Spilling reads the frame before every sample, which would cost a full GOP
+	cv::Mat features;
+	QList<int> rowFrameNumbers;
+	if (!computeFeatures(keyframeUnit, features, rowFrameNumbers)) {
+		return false;
+	}
+	QList<cv::Mat> centers;
+	frameNumbers = clusterSubsets(keyframeUnit, features, rowFrameNumbers,
+				&centers);
+	qint64 denseFrames = 0;
+	for (const auto &window : unit.timeLineWindows) {
+		denseFrames += window.end - window.start;
+	}
+	qint64 decodedFrames = keyframeUnit.timeLineWindows.size();
+
+	if (m_datasetConfig->refineSelection) {
+		QList<QList<int>> refined;
+		qint64 refineFrames = 0;
+		if (!refineSelection(unit, keyframeUnit, features, rowFrameNumbers,
+					centers, frameNumbers, *seekIndex, spillCache, refined,
+					refineFrames)) {
+			return false;
+		}
+		frameNumbers = refined;
+		decodedFrames += refineFrames;
+	}
+	if (m_datasetConfig->debug) {
+		std::cout << unit.recordingPath.toStdString() << ": keyframe features decoded "
+							<< decodedFrames << " of " << denseFrames << " frames per camera ("
+							<< 100 - 100*decodedFrames/std::max<qint64>(1, denseFrames)
+							<< "% saved)" << std::endl;
+		if (m_datasetConfig->compareWithExhaustive) {
+			compareWithDenseSelection(unit, frameNumbers);
+		}
+	}
+	return true;
+}
+
+
+bool DatasetCreator::selectCoarseToFine(const DatasetWorkUnit &unit,
+			QList<QList<int>> &frameNumbers, FrameSpillCache *spillCache) {
+	//The coarse grid is a subset of the dense one, every subset keeps its own
+	//stride on it
+	const int rate = unit.subSamplingRate;
+	const int coarseRate = rate * std::max(1, m_datasetConfig->coarseStride);
+	DatasetWorkUnit coarseUnit = unit;
+	coarseUnit.subSamplingRate = coarseRate;
+	for (auto &subset : coarseUnit.subsets) {
+		subset.subSamplingRate *= std::max(1, m_datasetConfig->coarseStride);
+	}
+	for (const auto &subset : unitSubsets(coarseUnit)) {
+		if (VideoStreamer::numSamples(subset.timeLineWindows,
+					subset.subSamplingRate) < 4*m_datasetConfig->frameSetsRecording) {
+			if (m_datasetConfig->debug) {
+				std::cout << unit.savePath.toStdString() << ": too few coarse samples, "
+									<< "using the dense feature pass" << std::endl;
+			}
+			return false;
+		}
+	}
+	cv::Mat coarseFeatures;
+	QList<int> coarseFrameNumbers;
+	if (!computeFeatures(coarseUnit, coarseFeatures, coarseFrameNumbers,
+				spillCache)) {
+		return false;
+	}
+
+	//Dense intervals per window, around every coarse candidate and between
+	//consecutive coarse samples that differ a lot
+	QMap<int,int> coarseRowOfFrame;
+	for (int row = coarseFrameNumbers.size()-1; row >= 0; row--) {
+		coarseRowOfFrame[coarseFrameNumbers[row]] = row;
+	}
+	QMap<int, QList<QPair<int,int>>> intervals;
+	auto addInterval = [&](int start, int end) {
+		for (int w = 0; w < unit.timeLineWindows.size(); w++) {
+			const TimeLineWindow &window = unit.timeLineWindows[w];
+			int first = std::max(start, window.start);
+			int last = std::min(end, window.end);
+			if (first < last) {
+				intervals[w].append(qMakePair(first, last));
+			}
+		}
+	};
+	std::vector<float> changes;
+	QList<QPair<int,int>> pairs;
+	for (auto it = coarseRowOfFrame.constBegin(); it != coarseRowOfFrame.constEnd();
+				++it) {
+		auto next = std::next(it);
+		if (next != coarseRowOfFrame.constEnd() && next.key() - it.key() == coarseRate) {
+			changes.push_back(cv::norm(coarseFeatures.row(it.value()),
+						coarseFeatures.row(next.value()), cv::NORM_L2SQR));
+			pairs.append(qMakePair(it.key(), next.key()));
+		}
+	}
+	int changedIntervals = 0;
+	if (!changes.empty()) {
+		std::vector<float> sorted = changes;
+		std::nth_element(sorted.begin(), sorted.begin() + sorted.size()/2,
+					sorted.end());
+		float threshold = m_datasetConfig->coarseChangeThreshold *
+					sorted[sorted.size()/2];
+		for (size_t i = 0; i < changes.size(); i++) {
+			if (changes[i] > threshold) {
+				addInterval(pairs[i].first + 1, pairs[i].second);
+				changedIntervals++;
+			}
+		}
+	}
+	QList<QList<int>> candidates = clusterSubsets(coarseUnit, coarseFeatures,
+				coarseFrameNumbers);
+	for (const auto &subsetCandidates : candidates) {
+		for (const auto &frame : subsetCandidates) {
+			addInterval(frame - coarseRate + 1, frame + coarseRate);
+		}
+	}
+	DatasetWorkUnit denseUnit = unit;
+	denseUnit.subsets.clear();
+	denseUnit.timeLineWindows.clear();
+	for (auto it = intervals.begin(); it != intervals.end(); ++it) {
+		const TimeLineWindow &window = unit.timeLineWindows[it.key()];
+		std::sort(it.value().begin(), it.value().end());
+		TimeLineWindow dense = window;
+		dense.end = -1;
+		for (const auto &interval : it.value()) {
+			//Snapped onto the dense grid of the window
+			int start = window.start +
+						(interval.first - window.start + rate - 1) / rate * rate;
+			if (dense.end >= start) {
+				dense.end = std::max(dense.end, interval.second);
+				continue;
+			}
+			if (dense.end > dense.start) {
+				denseUnit.timeLineWindows.append(dense);
+			}
+			dense.start = start;
+			dense.end = interval.second;
+		}
+		if (dense.end > dense.start) {
+			denseUnit.timeLineWindows.append(dense);
+		}
+	}
+	std::stable_sort(denseUnit.timeLineWindows.begin(),
+				denseUnit.timeLineWindows.end());
+	cv::Mat denseFeatures;
+	QList<int> denseFrameNumbers;
+	if (!denseUnit.timeLineWindows.isEmpty() && !computeFeatures(denseUnit,
+				denseFeatures, denseFrameNumbers, spillCache)) {
+		return false;
+	}
+
+	//Coarse and dense rows merged in frame order, coarse frames only once. The
+	//motion sampler takes every row's predecessor as the previous sample.
+	QMap<int,int> denseRowOfFrame;
+	for (int row = denseFrameNumbers.size()-1; row >= 0; row--) {
+		if (!coarseRowOfFrame.contains(denseFrameNumbers[row])) {
+			denseRowOfFrame[denseFrameNumbers[row]] = row;
+		}
+	}
+	QList<int> rowFrameNumbers = coarseRowOfFrame.keys();
+	rowFrameNumbers.append(denseRowOfFrame.keys());
+	std::sort(rowFrameNumbers.begin(), rowFrameNumbers.end());
+	cv::Mat features(rowFrameNumbers.size(), coarseFeatures.cols, CV_32FC1);
+	for (int i = 0; i < rowFrameNumbers.size(); i++) {
+		auto coarse = coarseRowOfFrame.constFind(rowFrameNumbers[i]);
+		if (coarse != coarseRowOfFrame.constEnd()) {
+			coarseFeatures.row(coarse.value()).copyTo(features.row(i));
+		}
+		else {
+			denseFeatures.row(denseRowOfFrame.value(rowFrameNumbers[i])).copyTo(
+						features.row(i));
+		}
+	}
+	coarseFeatures.release();
+	denseFeatures.release();
+	frameNumbers = clusterSubsets(unit, features, rowFrameNumbers);
+
+	if (m_datasetConfig->debug) {
+		int fullSamples = VideoStreamer::numSamples(unit.timeLineWindows, rate);
+		std::cout << unit.savePath.toStdString() << ": coarse to fine sampled "
+							<< rowFrameNumbers.size() << " of " << fullSamples << " frames ("
+							<< coarseFrameNumbers.size() << " coarse, " << changedIntervals
+							<< " changed intervals)" << std::endl;
+	}
+	return true;
+}
+
+
+QList<TimeLineWindow> DatasetCreator::keyframeWindows(
+			QList<TimeLineWindow> timeLineWindows, const SeekIndex &seekIndex,
+			int minSpacing) {
+	//One single frame window per keyframe, never denser than the dense grid.
+	//All intra streams thereby end up with the dense samples.
+	QList<TimeLineWindow> windows;
+	for (const auto &window : timeLineWindows) {
+		int lastKept = window.start - minSpacing;
+		for (const auto &keyFrame : seekIndex.keyFrames(window.start, window.end)) {
+			if (keyFrame - lastKept >= minSpacing) {
+				TimeLineWindow keyFrameWindow = window;
+				keyFrameWindow.start = keyFrame;
+				keyFrameWindow.end = keyFrame + 1;
+				windows.append(keyFrameWindow);
+				lastKept = keyFrame;
+			}
+		}
+	}
+	std::stable_sort(windows.begin(), windows.end());
+	return windows;
+}
+
+
+bool DatasetCreator::refineSelection(const DatasetWorkUnit &unit,
+			const DatasetWorkUnit &keyframeUnit, const cv::Mat &keyframeFeatures,
+			const QList<int> &keyframeNumbers, const QList<cv::Mat> &centers,
+			const QList<QList<int>> &selection, const SeekIndex &seekIndex,
+			FrameSpillCache *spillCache, QList<QList<int>> &refined,
+			qint64 &decodedFrames) {
+	//Every representative keyframe only stands in for the frames around it,
+	//those get sampled densely, up to halfway to the neighbouring keyframes
+	QList<DatasetSubset> subsets = unitSubsets(unit);
+	QList<DatasetSubset> keyframeSubsets = unitSubsets(keyframeUnit);
+	int rate = unit.subSamplingRate;
+	QList<QList<TimeLineWindow>> neighbourhoods;
+	DatasetWorkUnit refineUnit = unit;
+	refineUnit.subsets.clear();
+	refineUnit.timeLineWindows.clear();
+	for (int s = 0; s < subsets.size(); s++) {
+		std::vector<int> kept;
+		for (const auto &window : keyframeSubsets[s].timeLineWindows) {
+			kept.push_back(window.start);
+		}
+		std::sort(kept.begin(), kept.end());
+		neighbourhoods.append(QList<TimeLineWindow>());
+		for (const auto &keyFrame : selection[s]) {
+			TimeLineWindow neighbourhood;
+			neighbourhood.start = keyFrame;
+			neighbourhood.end = keyFrame;
+			for (const auto &window : subsets[s].timeLineWindows) {
+				if (keyFrame < window.start || keyFrame >= window.end) {
+					continue;
 				}
-				else {
-					cv::vconcat(dctImages, dctImage[i], dctImages);
+				auto it = std::lower_bound(kept.begin(), kept.end(), keyFrame);
+				int previous = it != kept.begin() ? *(it-1) : window.start;
+				int next = (it != kept.end() && it+1 != kept.end()) ? *(it+1) :
+							window.end;
+				int start = std::max(window.start, (previous + keyFrame + 1) / 2);
+				neighbourhood = window;
+				neighbourhood.start = window.start +
+							(start - window.start + rate - 1) / rate * rate;
+				neighbourhood.end = std::min(window.end, (keyFrame + next) / 2 + 1);
+				break;
+			}
+			neighbourhoods[s].append(neighbourhood);
+			if (neighbourhood.end > neighbourhood.start) {
+				refineUnit.timeLineWindows.append(neighbourhood);
+				decodedFrames += neighbourhood.end -
+							seekIndex.keyFrameBefore(neighbourhood.start);
+			}
+		}
+	}
+	std::stable_sort(refineUnit.timeLineWindows.begin(),
+				refineUnit.timeLineWindows.end());
+
+	cv::Mat features;
+	QList<int> rowFrameNumbers;
+	if (!computeFeatures(refineUnit, features, rowFrameNumbers, spillCache)) {
+		return false;
+	}
+	QMap<int,int> rowOfFrame;
+	for (int row = rowFrameNumbers.size()-1; row >= 0; row--) {
+		rowOfFrame[rowFrameNumbers[row]] = row;
+	}
+	QMap<int,int> keyframeRowOfFrame;
+	for (int row = keyframeNumbers.size()-1; row >= 0; row--) {
+		keyframeRowOfFrame[keyframeNumbers[row]] = row;
+	}
+
+	//The refined frame is the one closest to the representative's cluster
+	//center, the keyframe itself stays a candidate
+	refined.clear();
+	for (int s = 0; s < subsets.size(); s++) {
+		refined.append(QList<int>());
+		for (int i = 0; i < selection[s].size(); i++) {
+			QList<int> candidateFrames = {selection[s][i]};
+			cv::Mat candidates = keyframeFeatures.row(
+						keyframeRowOfFrame.value(selection[s][i])).clone();
+			const TimeLineWindow &neighbourhood = neighbourhoods[s][i];
+			for (int frame = neighbourhood.start; frame < neighbourhood.end;
+						frame += rate) {
+				auto it = rowOfFrame.constFind(frame);
+				if (it != rowOfFrame.constEnd() && frame != selection[s][i]) {
+					candidateFrames.append(frame);
+					candidates.push_back(features.row(it.value()));
 				}
 			}
-			if (dctImagesList.empty()) {
-				dctImagesList = dctImages.reshape(1,1);
+			cv::Mat norms;
+			FeatureClustering::squaredNorms(candidates, norms);
+			int best = FeatureClustering::nearestRows(candidates, norms,
+						centers[s].row(i))[0];
+			refined[s].append(candidateFrames[best]);
+		}
+	}
+	return true;
+}
+
+
+void DatasetCreator::compareWithDenseSelection(const DatasetWorkUnit &unit,
+			const QList<QList<int>> &frameNumbers) {
+	cv::Mat features;
+	QList<int> rowFrameNumbers;
+	if (!computeFeatures(unit, features, rowFrameNumbers)) {
+		return;
+	}
+	QList<QList<int>> denseFrameNumbers = clusterSubsets(unit, features,
+				rowFrameNumbers);
+	QList<DatasetSubset> subsets = unitSubsets(unit);
+	for (int s = 0; s < subsets.size() && s < denseFrameNumbers.size(); s++) {
+		//Distance of every selected frame to the closest frame the dense pass
+		//selected
+		double sum = 0;
+		int maxDistance = 0;
+		for (const auto &frame : frameNumbers[s]) {
+			int distance = INT_MAX;
+			for (const auto &denseFrame : denseFrameNumbers[s]) {
+				distance = std::min(distance, std::abs(frame - denseFrame));
 			}
-			else {
-				cv::vconcat(dctImagesList,dctImages.reshape(1,1),dctImagesList);
+			if (distance != INT_MAX) {
+				sum += distance;
+				maxDistance = std::max(maxDistance, distance);
 			}
 		}
+		std::cout << unit.recordingName.toStdString() << " "
+							<< subsets[s].subsetName.toStdString()
+							<< ": selected frames are on average "
+							<< sum / std::max(1, static_cast<int>(frameNumbers[s].size()))
+							<< " frames, at most " << maxDistance
+							<< " frames away from the dense selection" << std::endl;
+	}
+}
 
-		cv::Mat labels, centers;
-		cv::kmeans(dctImagesList, m_datasetConfig->frameSetsRecording, labels,
-					cv::TermCriteria(cv::TermCriteria::EPS+cv::TermCriteria::COUNT,
-					1000, 1e-4), 25, cv::KMEANS_PP_CENTERS, centers);
 
-		for (int i = 0; i < m_datasetConfig->frameSetsRecording; i++) {
-			std::vector< float > sums;
-			cv::Mat clusterDists;
-			for (int j = 0; j < dctImagesList.size().height; j++) {
-				clusterDists = dctImagesList.row(j)-centers.row(i);
-				sums.push_back(cv::sum(clusterDists.mul(clusterDists))[0]);
+void DatasetCreator::compareWithAllCameras(const DatasetWorkUnit &unit,
+			const QList<QList<int>> &frameNumbers) {
+	cv::Mat features;
+	QList<int> rowFrameNumbers;
+	if (!computeFeatures(unit, features, rowFrameNumbers)) {
+		return;
+	}
+	QList<QList<int>> baseline = clusterSubsets(unit, features, rowFrameNumbers);
+	QMap<int,int> rowOfFrame;
+	for (int row = rowFrameNumbers.size()-1; row >= 0; row--) {
+		rowOfFrame[rowFrameNumbers[row]] = row;
+	}
+
+	//Frames picked off the dense grid (keyframes, refined frames) get their
+	//all camera features in a small extra pass
+	DatasetWorkUnit missingUnit = unit;
+	missingUnit.subsets.clear();
+	missingUnit.subSamplingRate = 1;
+	missingUnit.timeLineWindows.clear();
+	QMap<int,int> missingFrames;
+	for (const auto &subsetFrames : frameNumbers) {
+		for (const auto &frame : subsetFrames) {
+			if (!rowOfFrame.contains(frame) && !missingFrames.contains(frame)) {
+				TimeLineWindow window;
+				window.name = unit.subsetName;
+				window.start = frame;
+				window.end = frame + 1;
+				missingUnit.timeLineWindows.append(window);
+				missingFrames[frame] = -1;
 			}
-			int minElementIndex = std::min_element(sums.begin(),
-																						 sums.end()) - sums.begin();
-			frameNumbers.append(m_frameNumberMap[minElementIndex]);
 		}
-		emit finishedClustering();
 	}
+	cv::Mat missingFeatures;
+	if (!missingUnit.timeLineWindows.isEmpty()) {
+		std::stable_sort(missingUnit.timeLineWindows.begin(),
+					missingUnit.timeLineWindows.end());
+		QList<int> missingRowFrameNumbers;
+		if (!computeFeatures(missingUnit, missingFeatures, missingRowFrameNumbers)) {
+			return;
+		}
+		for (int row = 0; row < missingRowFrameNumbers.size(); row++) {
+			missingFrames[missingRowFrameNumbers[row]] = row;
+		}
+	}
+	auto selectedFeatures = [&](const QList<int> &frames) {
+		cv::Mat selected;
+		for (const auto &frame : frames) {
+			if (rowOfFrame.contains(frame)) {
+				selected.push_back(features.row(rowOfFrame[frame]));
+			}
+			else if (missingFrames.value(frame, -1) >= 0) {
+				selected.push_back(missingFeatures.row(missingFrames[frame]));
+			}
+		}
+		return selected;
+	};
 
-	return frameNumbers;
+	//Mean squared distance of every sample to the closest selected frame, in
+	//the all camera feature space. Lower is better, the all camera k-means
+	//selection is the baseline.
+	QList<DatasetSubset> subsets = unitSubsets(unit);
+	for (int s = 0; s < subsets.size() && s < baseline.size(); s++) {
+		cv::Mat subsetFeatures;
+		QList<int> subsetFrameNumbers;
+		subsetRows(features, rowFrameNumbers, subsets[s], subsetFeatures,
+					subsetFrameNumbers);
+		cv::Mat reference = selectedFeatures(frameNumbers[s]);
+		cv::Mat allCameras = selectedFeatures(baseline[s]);
+		if (subsetFeatures.empty() || reference.empty() || allCameras.empty()) {
+			continue;
+		}
+		cv::Mat norms;
+		FeatureClustering::squaredNorms(subsetFeatures, norms);
+		std::vector<int> labels;
+		double referenceCost = FeatureClustering::assign(subsetFeatures, norms,
+					reference, labels) / subsetFeatures.rows;
+		double allCamerasCost = FeatureClustering::assign(subsetFeatures, norms,
+					allCameras, labels) / subsetFeatures.rows;
+		emit referenceCamerasCompared(unit.recordingName + " " +
+					subsets[s].subsetName, referenceCost, allCamerasCost);
+	}
 }
 
 
-QList<QString> DatasetCreator::getAndCopyFrames(const QString& recording,
-				QList<QString> cameras, const QString& dataFolder,
-				QList<int> frameNumbers) {
-	QList<QString> frameNames;
-	QList <ImageWriter*> writers;
-	QThreadPool *threadPool = QThreadPool::globalInstance();
+void DatasetCreator::subsetRows(const cv::Mat &features,
+			const QList<int> &rowFrameNumbers, const DatasetSubset &subset,
+			cv::Mat &subsetFeatures, QList<int> &subsetFrameNumbers) {
+	//Rows in the order a separate pass over the subset would have produced them
+	QMap<int,int> rowOfFrame;
+	for (int row = rowFrameNumbers.size()-1; row >= 0; row--) {
+		rowOfFrame[rowFrameNumbers[row]] = row;
+	}
+	QList<int> rows;
+	subsetFrameNumbers.clear();
+	for (const auto &window : subset.timeLineWindows) {
+		for (int frame = window.start; frame < window.end;
+					frame += subset.subSamplingRate) {
+			auto it = rowOfFrame.constFind(frame);
+			if (it != rowOfFrame.constEnd()) {
+				rows.append(it.value());
+				subsetFrameNumbers.append(frame);
+			}
+		}
+	}
+	subsetFeatures.create(rows.size(), features.cols, CV_32FC1);
+	for (int i = 0; i < rows.size(); i++) {
+		features.row(rows[i]).copyTo(subsetFeatures.row(i));
+	}
+}
+
+
+bool DatasetCreator::getAndCopyFrames(const DatasetWorkUnit &unit,
+				QList<int> frameNumbers, QList<QString> savePaths,
+				QList<QString> &frameNames, const FrameSpillCache *spillCache,
+				const QSet<QString> &resumedPaths) {
+	frameNames.clear();
+	QList<ImageWriter*> writers;
+	QList<QRunnable*> jobs;
+	JpegEncoderPool::Batch encoderBatch;
+	//Frames of all subsets go through one sorted pass per camera
+	QList<int> order(frameNumbers.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&frameNumbers](int a, int b) {
+		return frameNumbers[a] < frameNumbers[b];
+	});
+	QList<int> sortedFrameNumbers;
+	QList<QString> sortedSavePaths;
+	for (const auto &index : order) {
+		sortedFrameNumbers.append(frameNumbers[index]);
+		sortedSavePaths.append(savePaths[index]);
+	}
+	ChunkResults results;
 	int threadNumber = 0;
-	for (const auto & camera : cameras) {
-		QString videoPath = recording + "/" + camera + "." +
-					m_datasetConfig->videoFormat;
-		QString destinationPath = dataFolder + "/" + camera;
-		ImageWriter *writer = new ImageWriter(videoPath, destinationPath,
-					frameNumbers, threadNumber);
-		connect(this, &DatasetCreator::creationCanceled,
-						writer, &ImageWriter::creationCanceledSlot);
-		connect(writer, &ImageWriter::copyImagesStatus,
-						this, &DatasetCreator::copyImagesStatus);
+	int reusedFrames = 0;
+	for (const auto & camera : unit.cameras) {
+		QString videoPath = unit.recordingPath + "/" + camera + "." +
+					unit.videoFormat;
+		//Frames a resumed run already wrote completely are kept
+		QList<int> cameraFrameNumbers;
+		QList<QString> destinationPaths;
+		for (int i = 0; i < sortedFrameNumbers.size(); i++) {
+			QString destinationPath = sortedSavePaths[i] + "/" + camera;
+			if (resumedPaths.contains(sortedSavePaths[i]) &&
+						CreationJournal::isValidJpeg(destinationPath + "/Frame_" +
+						QString::number(sortedFrameNumbers[i]) + ".jpg")) {
+				reusedFrames++;
+				continue;
+			}
+			cameraFrameNumbers.append(sortedFrameNumbers[i]);
+			destinationPaths.append(destinationPath);
+		}
+		int numChunks = std::min(numChunksPerCamera(cameraFrameNumbers.size(),
+					unit.cameras.size()),
+					static_cast<int>(cameraFrameNumbers.size()));
+		for (int chunk = 0; chunk < numChunks; chunk++) {
+			int first = cameraFrameNumbers.size() * chunk / numChunks;
+			int last = cameraFrameNumbers.size() * (chunk+1) / numChunks;
+			ImageWriter *writer = new ImageWriter(videoPath,
+						cameraFrameNumbers.mid(first, last-first),
+						destinationPaths.mid(first, last-first),
+						threadNumber, chunk, m_datasetConfig, &m_creationCanceled,
+						m_encoderPool.data(), &encoderBatch, spillCache);
+			writer->setAutoDelete(false);
+			connect(writer, &ImageWriter::copyImagesStatus, [this, &results](
+						int frameCount, int totalNumFrames, int threadNumber,
+						int chunkNumber) {
+				int cameraIndex, cameraTotal;
+				updateChunkProgress(results, frameCount, totalNumFrames, threadNumber,
+							chunkNumber, cameraIndex, cameraTotal);
+				emit copyImagesStatus(cameraIndex, cameraTotal, threadNumber);
+			});
+			writers.append(writer);
+			jobs.append(writer);
+		}
 		threadNumber++;
-		writers.append(writer);
-		threadPool->start(writer);
 	}
 	for (const auto &frameNumber : frameNumbers) {
 		frameNames.append("Frame_" + QString::number(frameNumber) + ".jpg");
 	}
-	while (!threadPool->waitForDone(10)) {
-		QCoreApplication::instance()->processEvents();
+	if (reusedFrames > 0 && m_datasetConfig->debug) {
+		std::cout << unit.savePath.toStdString() << ": kept " << reusedFrames
+							<< " frames written by a previous run" << std::endl;
+	}
+	m_executor->run(jobs);
+	int failedFrames = 0;
+	ImageWriter::Stats stats;
+	for (const auto &writer : writers) {
+		failedFrames += writer->failedFrames();
+		stats.seeks += writer->stats().seeks;
+		stats.grabbed += writer->stats().grabbed;
+		stats.copied += writer->stats().copied;
+		stats.spilled += writer->stats().spilled;
+		stats.decodeTime += writer->stats().decodeTime;
+		stats.encodeTime += writer->stats().encodeTime;
+		stats.copyTime += writer->stats().copyTime;
+	}
+	qDeleteAll(writers);
+	if (m_datasetConfig->debug) {
+		//Times are summed over all writer threads
+		std::cout << unit.recordingPath.toStdString() << ": decode "
+							<< stats.decodeTime/1000 << " ms (" << stats.seeks << " seeks, "
+							<< stats.grabbed << " grabbed), encode " << stats.encodeTime/1000
+							<< " ms, " << stats.copied << " copied in "
+							<< stats.copyTime/1000 << " ms, " << stats.spilled
+							<< " from spill cache" << std::endl;
+	}
+	if (m_encoderPool != nullptr) {
+		m_encoderPool->waitForDone(&encoderBatch);
+		failedFrames += encoderBatch.failed;
 	}
-	return frameNames;
+	//The annotation files would list frames that are not on disk
+	if (failedFrames != 0) {
+		failCreation("Failed to write " + QString::number(failedFrames) +
+					" frames to " + unit.savePath + ", is the disk full?");
+		return false;
+	}
+	return true;
 }
 
 
-void DatasetCreator::createSavefile(const QString& recording,
-			QList<QString> cameras, const QString& dataFolder,
-			QList<int> frameNumbers) {
-	for (const auto & camera : cameras) {
-		QDir dir;
-		dir.mkpath(dataFolder + "/" + camera);
+void DatasetCreator::createSavefile(const DatasetWorkUnit &unit,
+			const QList<DatasetSubset> &subsets, QList<QList<int>> frameNumbers,
+			const FrameSpillCache *spillCache) {
+	QList<int> allFrameNumbers;
+	QList<QString> savePaths;
+	QSet<QString> resumedPaths;
+	for (int i = 0; i < subsets.size() && i < frameNumbers.size(); i++) {
+		for (const auto & camera : unit.cameras) {
+			QDir dir;
+			dir.mkpath(subsets[i].savePath + "/" + camera);
+		}
+		allFrameNumbers.append(frameNumbers[i]);
+		for (int j = 0; j < frameNumbers[i].size(); j++) {
+			savePaths.append(subsets[i].savePath);
+		}
+		if (m_journal->isResumed(journalKey(unit, subsets[i]))) {
+			resumedPaths.insert(subsets[i].savePath);
+		}
+	}
+	QList<QString> frameNames;
+	if (!getAndCopyFrames(unit, allFrameNumbers, savePaths, frameNames,
+				spillCache, resumedPaths) || m_creationCanceled) {
+		return;
+	}
+
+	int offset = 0;
+	for (int i = 0; i < subsets.size() && i < frameNumbers.size(); i++) {
+		QString key = journalKey(unit, subsets[i]);
+		QList<QString> subsetFrameNames = frameNames.mid(offset,
+					frameNumbers[i].size());
+		for (const auto &camera : unit.cameras) {
+			bool extracted = true;
+			for (const auto &frameName : subsetFrameNames) {
+				extracted = extracted && CreationJournal::isValidJpeg(
+							subsets[i].savePath + "/" + camera + "/" + frameName);
+			}
+			if (extracted) {
+				m_journal->setExtracted(key, camera);
+			}
+		}
+		if (!writeAnnotationFiles(subsets[i].savePath, unit.cameras,
+					subsetFrameNames)) {
+			return;
+		}
+		m_journal->setAnnotationsWritten(key);
+		offset += frameNumbers[i].size();
 	}
-	QList<QString> frameNames = getAndCopyFrames(recording, cameras, dataFolder,
-				frameNumbers);
+}
+
 
+bool DatasetCreator::writeAnnotationFiles(const QString &dataFolder,
+			const QList<QString> &cameras, const QList<QString> &frameNames) {
 	for (const auto & camera : cameras) {
 		QFile file(dataFolder + "/" + camera + "/annotations.csv");
 		if (!file.open(QIODevice::WriteOnly)) {
-			emit datasetCreationFailed("Can't open file " + dataFolder + "/" +
-						camera + "/annotations.csv" + " !");;
-			return;
+			failCreation("Can't open file " + dataFolder + "/" + camera +
+						"/annotations.csv" + " !");
+			return false;
 		}
 		 QTextStream stream(&file);
 		 stream << "Scorer";
@@ -381,20 +1939,125 @@ void DatasetCreator::createSavefile(const QString& recording,
 		 }
 		 file.close();
 	}
+	return true;
+}
+
+
+int DatasetCreator::numChunksPerCamera(int numWorkItems, int numCameras) {
+	//Enough chunks that every worker has something to steal, but never more
+	//chunks than there is work, every chunk costs a capture handle and a seek
+	if (!m_datasetConfig->chunkedScheduling || numCameras == 0) {
+		return 1;
+	}
+	int numThreads = m_datasetConfig->workerThreads > 0 ?
+				m_datasetConfig->workerThreads : QThread::idealThreadCount();
+	int numChunks = (2*numThreads + numCameras - 1) / numCameras;
+	return std::max(1, std::min(numChunks, numWorkItems));
+}
+
+
+QList<QList<TimeLineWindow>> DatasetCreator::splitIntoChunks(
+			QList<TimeLineWindow> timeLineWindows, int subSamplingRate,
+			int numChunks) {
+	//Chunk boundaries stay on the sampling grid of each window, so the chunks
+	//together sample exactly the same frames as the unsplit windows
+	int totalSamples = VideoStreamer::numSamples(timeLineWindows, subSamplingRate);
+	if (totalSamples == 0 || numChunks <= 1) {
+		return {timeLineWindows};
+	}
+	int samplesPerChunk = (totalSamples + numChunks - 1) / numChunks;
+	QList<QList<TimeLineWindow>> chunks;
+	QList<TimeLineWindow> chunk;
+	int chunkSamples = 0;
+	for (const auto &window : timeLineWindows) {
+		int start = window.start;
+		while (start < window.end) {
+			int remaining = (window.end - start + subSamplingRate - 1) /
+						subSamplingRate;
+			int take = std::min(remaining, samplesPerChunk - chunkSamples);
+			TimeLineWindow part = window;
+			part.start = start;
+			part.end = std::min(window.end, start + take*subSamplingRate);
+			chunk.append(part);
+			chunkSamples += take;
+			start = part.end;
+			if (chunkSamples == samplesPerChunk) {
+				chunks.append(chunk);
+				chunk.clear();
+				chunkSamples = 0;
+			}
+		}
+	}
+	if (!chunk.isEmpty()) {
+		chunks.append(chunk);
+	}
+	return chunks;
+}
+
+
+void DatasetCreator::collectValidRows(const ChunkResults &results,
+			const QList<int> &chunkOffsets, int numCameras, cv::Mat &features,
+			QList<int> &rowFrameNumbers) {
+	//A row is only clustered if every camera managed to read its frame
+	rowFrameNumbers.clear();
+	QList<int> validRows;
+	for (int chunk = 0; chunk < chunkOffsets.size(); chunk++) {
+		QMap<int,int> frameNumbers = results.frameNumberChunks.value(0).value(chunk);
+		for (auto it = frameNumbers.constBegin(); it != frameNumbers.constEnd(); ++it) {
+			bool valid = true;
+			for (int camera = 1; camera < numCameras && valid; camera++) {
+				valid = results.frameNumberChunks.value(camera).value(chunk).contains(
+							it.key());
+			}
+			if (valid) {
+				validRows.append(chunkOffsets[chunk] + it.key());
+				rowFrameNumbers.append(it.value());
+			}
+		}
+	}
+	if (validRows.size() == features.rows) {
+		return;
+	}
+	cv::Mat compacted(validRows.size(), features.cols, CV_32FC1);
+	for (int i = 0; i < validRows.size(); i++) {
+		features.row(validRows[i]).copyTo(compacted.row(i));
+	}
+	features = compacted;
+}
+
+
+void DatasetCreator::updateChunkProgress(ChunkResults &results, int index,
+			int total, int threadNumber, int chunkNumber, int &cameraIndex,
+			int &cameraTotal) {
+	QMutexLocker locker(&results.mutex);
+	results.progress[threadNumber][chunkNumber] = qMakePair(index, total);
+	cameraIndex = 0;
+	cameraTotal = 0;
+	for (const auto &progress : results.progress[threadNumber]) {
+		cameraIndex += progress.first;
+		cameraTotal += progress.second;
+	}
 }
 
 
-void DatasetCreator::computedDCTsSlot(QList<cv::Mat> dctImages,
-			QMap<int,int> frameNumberMap, int threadNumber) {
-	m_dctMap[threadNumber] = dctImages;
-	m_frameNumberMap = frameNumberMap;
-	if (m_dctMap.size() == m_datasetConfig->numCameras) {
-		emit gotAllDCTs();
+void DatasetCreator::failCreation(const QString &errorMsg) {
+	//Only the first failure is reported, the units still in flight stop as if
+	//the creation was canceled and nothing reports it as created
+	if (!m_creationCanceled.exchange(true)) {
+		emit datasetCreationFailed(errorMsg);
 	}
+	m_pipelineMutex.lock();
+	m_pipelineChanged.wakeAll();
+	m_pipelineMutex.unlock();
 }
 
 
 void DatasetCreator::cancelCreationSlot() {
+	//Called directly from the GUI thread, the creator thread is blocked in
+	//runPipeline() and does not process events
 	m_creationCanceled = true;
+	m_pipelineMutex.lock();
+	m_pipelineChanged.wakeAll();
+	m_pipelineMutex.unlock();
 	emit creationCanceled();
 }
@@ -11,8 +11,17 @@
 #define DATASETCREATOR_H
 
 #include "globals.hpp"
+#include "recordingindex.hpp"
 #include "imagewriter.hpp"
 #include "videostreamer.hpp"
+#include "workstealingexecutor.hpp"
+#include "featurecache.hpp"
+#include "featureclustering.hpp"
+#include "featureprojection.hpp"
+#include "framesampler.hpp"
+#include "framespillcache.hpp"
+#include "creationjournal.hpp"
+#include "seekindex.hpp"
 
 #include "opencv2/videoio/videoio.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
@@ -20,8 +29,37 @@
 #include "yaml-cpp/yaml.h"
 
 #include <QRunnable>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QScopedPointer>
+#include <QSet>
+#include <QLockFile>
+#include <QSharedPointer>
 
-Q_DECLARE_METATYPE(QList<cv::Mat>)
+#include <atomic>
+
+
+struct DatasetSubset {
+	QString subsetName;
+	QList<TimeLineWindow> timeLineWindows;
+	QString savePath;
+	int subSamplingRate = 1;
+};
+
+
+struct DatasetWorkUnit {
+	QString recordingName;
+	QString recordingPath;
+	QString subsetName;
+	QList<TimeLineWindow> timeLineWindows;
+	QList<QString> cameras;
+	QString videoFormat;
+	QString savePath;
+	int subSamplingRate = 1;
+	qint64 estimatedMemory = 0;
+	qint64 spillMemory = 0;
+	QList<DatasetSubset> subsets;	//Set if all subsets of a recording share one pass
+};
 
 
 class DatasetCreator : public QObject {
@@ -29,9 +67,12 @@ class DatasetCreator : public QObject {
 
 	public:
 		explicit DatasetCreator(DatasetConfig *datasetConfig);
+		bool runShardWorker(const QString &manifestPath);
+		bool mergeShards(const QString &manifestPath);
+		bool compareReferenceCameras(const QString &manifestPath);
+		bool compareDecodingPaths(const QString &manifestPath);
 
 	signals:
-		void gotAllDCTs();
 		void datasetCreated();
 		void datasetCreationFailed(QString errorMsg);
 		void recordingBeingProcessedChanged(QString recording,
@@ -42,41 +83,136 @@ class DatasetCreator : public QObject {
 		void finishedClustering();
 		void copyImagesStatus(int frameCount, int totalNumFrames, int threadNumber);
 		void creationCanceled();
+		void shardsPlanned(QString manifestPath, int numUnits);
+		void referenceCamerasCompared(QString subset, double referenceCost,
+					double allCamerasCost);
+		void decodingPathsCompared(QString unit, QString path, bool framesMatch,
+					bool selectionsMatch, double maxFeatureDiff);
 
 	public slots:
 		void createDatasetSlot(QList<RecordingItem> recordings,
 					QList<QString> entities, QList<QString> keypoints,
 					QList<SkeletonComponent> skeleton);
+		void planShardsSlot(QList<RecordingItem> recordings,
+					QList<QString> entities, QList<QString> keypoints,
+					QList<SkeletonComponent> skeleton, QString manifestPath);
 		void cancelCreationSlot();
 
 	private:
+		struct ChunkResults {
+			QMutex mutex;
+			QMap<int,QMap<int,QMap<int,int>>> frameNumberChunks;
+			QMap<int,QMap<int,QPair<int,int>>> progress;
+		};
+
 		DatasetConfig *m_datasetConfig;
 		QList<RecordingItem> m_recordingItems;
 		QList<QString> m_entitiesList;
 		QList<QString> m_keypointsList;
 		QList<SkeletonComponent> m_skeleton;
-		QMap<int,QList<cv::Mat>> m_dctMap;
-		QMap<int,int> m_frameNumberMap;
-		bool m_creationCanceled = false;
+		std::atomic<bool> m_creationCanceled {false};
+		QMutex m_pipelineMutex;
+		QWaitCondition m_pipelineChanged;
+		int m_unitsInFlight = 0;
+		bool m_featurePassRunning = false;
+		qint64 m_reservedMemory = 0;
+		//Shared by all units in flight, so the thread count does not grow with
+		//recordingsInFlight
+		QScopedPointer<WorkStealingExecutor> m_executor;
+		QScopedPointer<JpegEncoderPool> m_encoderPool;
+		QScopedPointer<CreationJournal> m_journal;
+		QMap<QString, QSharedPointer<QLockFile>> m_shardLocks;
+		QMutex m_shardMutex;
+		bool m_refreshingLocks = false;
+		QWaitCondition m_refreshLocksChanged;
 
 		void createDatasetConfigFile(const QString& path);
+		bool planUnits(QList<DatasetWorkUnit> &units);
+		bool loadShardManifest(const QString &manifestPath);
+		bool mergeShards(const QList<DatasetWorkUnit> &units);
+		QString unitId(const DatasetWorkUnit &unit);
+		QString shardDir();
+		bool claimUnit(const DatasetWorkUnit &unit);
+		void releaseUnit(const DatasetWorkUnit &unit);
+		QString unitLockPath(const QString &unitId);
+		void refreshUnitLocks();
 		QList<QString> getCameraNames(const QString & path);
-		QString getVideoFormat(const QString& recording);
 		bool checkFrameCounts(const QString& recording, QList<QString> cameras);
-		QList<int> extractFrames(const QString &path,
-					QList<TimeLineWindow> timeLineWindows, QList<QString> cameras);
-		QList<QString> getAndCopyFrames(const QString& recording,
-					QList<QString> cameras, const QString& dataFolder,
-					QList<int> frameNumbers);
-		void createSavefile(const QString& recording, QList<QString> cameraNames,
-					const QString& dataFolder, QList<int> frameNumbers);
+		DatasetWorkUnit createWorkUnit(const RecordingItem &recording,
+					const QString &subsetName, QList<TimeLineWindow> timeLineWindows,
+					QList<QString> cameras, const QString &videoFormat,
+					const QString &savePath);
+		DatasetWorkUnit createRecordingUnit(const RecordingItem &recording,
+					const QMap<QString, QList<TimeLineWindow>> &recordingSubsets,
+					QList<QString> cameras, const QString &videoFormat);
+		qint64 featureMemory(QList<TimeLineWindow> timeLineWindows,
+					int subSamplingRate, int numCameras);
+		QList<DatasetSubset> unitSubsets(const DatasetWorkUnit &unit);
+		bool usesFeatures() const;
+		QString journalKey(const DatasetWorkUnit &unit, const DatasetSubset &subset);
+		QString subsetFingerprint(const DatasetWorkUnit &unit,
+					const DatasetSubset &subset);
+		int numReferenceCameras(const QList<QString> &cameras);
+		QList<QString> referenceCameras(const DatasetWorkUnit &unit);
+		QList<QString> probeReferenceCameras(const DatasetWorkUnit &unit,
+					int numCameras);
+		void runPipeline(const QList<DatasetWorkUnit> &units,
+					bool sharded = false);
+		bool startUnit(const DatasetWorkUnit &unit);
+		void finishFeaturePass();
+		void releaseUnitMemory(qint64 memory);
+		void finishUnit();
+		void processUnit(const DatasetWorkUnit &unit);
+		void failCreation(const QString &errorMsg);
+		QList<int> uniformFrameNumbers(QList<TimeLineWindow> timeLineWindows);
+		bool computeFeatures(const DatasetWorkUnit &unit, cv::Mat &features,
+					QList<int> &rowFrameNumbers, FrameSpillCache *spillCache = nullptr);
+		QList<int> clusterFeatures(const cv::Mat &features,
+					const QList<int> &rowFrameNumbers, cv::Mat *centers = nullptr);
+		QList<QList<int>> clusterSubsets(const DatasetWorkUnit &unit,
+					const cv::Mat &features, const QList<int> &rowFrameNumbers,
+					QList<cv::Mat> *centers = nullptr);
+		bool selectFromKeyframes(const DatasetWorkUnit &unit,
+					QList<QList<int>> &frameNumbers, FrameSpillCache *spillCache);
+		bool selectCoarseToFine(const DatasetWorkUnit &unit,
+					QList<QList<int>> &frameNumbers, FrameSpillCache *spillCache);
+		QList<TimeLineWindow> keyframeWindows(QList<TimeLineWindow> timeLineWindows,
+					const SeekIndex &seekIndex, int minSpacing);
+		bool refineSelection(const DatasetWorkUnit &unit,
+					const DatasetWorkUnit &keyframeUnit, const cv::Mat &keyframeFeatures,
+					const QList<int> &keyframeNumbers, const QList<cv::Mat> &centers,
+					const QList<QList<int>> &selection, const SeekIndex &seekIndex,
+					FrameSpillCache *spillCache, QList<QList<int>> &refined,
+					qint64 &decodedFrames);
+		void compareWithDenseSelection(const DatasetWorkUnit &unit,
+					const QList<QList<int>> &frameNumbers);
+		void compareWithAllCameras(const DatasetWorkUnit &unit,
+					const QList<QList<int>> &frameNumbers);
+		void subsetRows(const cv::Mat &features, const QList<int> &rowFrameNumbers,
+					const DatasetSubset &subset, cv::Mat &subsetFeatures,
+					QList<int> &subsetFrameNumbers);
+		bool getAndCopyFrames(const DatasetWorkUnit &unit,
+					QList<int> frameNumbers, QList<QString> savePaths,
+					QList<QString> &frameNames,
+					const FrameSpillCache *spillCache = nullptr,
+					const QSet<QString> &resumedPaths = {});
+		void createSavefile(const DatasetWorkUnit &unit,
+					const QList<DatasetSubset> &subsets, QList<QList<int>> frameNumbers,
+					const FrameSpillCache *spillCache = nullptr);
+		bool writeAnnotationFiles(const QString &dataFolder,
+					const QList<QString> &cameras, const QList<QString> &frameNames);
 		QMap<QString, QList<TimeLineWindow>> getRecordingSubsets(
 					QList<TimeLineWindow> timeLineWindows);
-
-	private slots:
-		void computedDCTsSlot(QList<cv::Mat> dctImages,
-					QMap<int,int> frameNumberMap, int threadNumber);
-
+		int numChunksPerCamera(int numWorkItems, int numCameras);
+		QList<QList<TimeLineWindow>> splitIntoChunks(
+					QList<TimeLineWindow> timeLineWindows, int subSamplingRate,
+					int numChunks);
+		void collectValidRows(const ChunkResults &results,
+					const QList<int> &chunkOffsets, int numCameras, cv::Mat &features,
+					QList<int> &rowFrameNumbers);
+		void updateChunkProgress(ChunkResults &results, int index, int total,
+					int threadNumber, int chunkNumber, int &cameraIndex,
+					int &cameraTotal);
 };
 
 #endif
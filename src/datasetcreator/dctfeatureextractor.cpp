@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * File:			  dctfeatureextractor.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "dctfeatureextractor.hpp"
+
+#include <cmath>
+
+
+DCTFeatureExtractor::DCTFeatureExtractor() {
+	//Orthonormal DCT-II basis (same scaling as cv::dct), only for the low
+	//frequencies we keep. The 1/255 normalisation is folded into the rows.
+	m_rowBasis.resize(FeatureWidth*ImageWidth);
+	for (int l = 0; l < FeatureWidth; l++) {
+		double scale = std::sqrt((l == 0 ? 1.0 : 2.0) / ImageWidth) / 255.0;
+		for (int x = 0; x < ImageWidth; x++) {
+			m_rowBasis[l*ImageWidth+x] = static_cast<float>(scale *
+						std::cos(CV_PI*(2*x+1)*l / (2.0*ImageWidth)));
+		}
+	}
+	m_colBasis.resize(FeatureHeight*ImageHeight);
+	for (int k = 0; k < FeatureHeight; k++) {
+		double scale = std::sqrt((k == 0 ? 1.0 : 2.0) / ImageHeight);
+		for (int y = 0; y < ImageHeight; y++) {
+			m_colBasis[k*ImageHeight+y] = static_cast<float>(scale *
+						std::cos(CV_PI*(2*y+1)*k / (2.0*ImageHeight)));
+		}
+	}
+	m_grayRow.resize(ImageWidth);
+	m_rowCoeffs.resize(FeatureWidth);
+}
+
+
+cv::Mat DCTFeatureExtractor::compute(const cv::Mat &frame) {
+	if (frame.type() != CV_8UC3) {
+		return computeReference(frame);
+	}
+	if (frame.size() != m_frameSize) {
+		updateSamplingTables(frame.size());
+	}
+	cv::Mat features = cv::Mat::zeros(FeatureHeight, FeatureWidth, CV_32FC1);
+	float *rowCoeffs = m_rowCoeffs.data();
+	float *grayRow = m_grayRow.data();
+
+	for (int y = 0; y < ImageHeight; y++) {
+		//Bilinear sample at the same positions and with the same 8 bit rounding
+		//as cv::resize followed by cv::cvtColor(BGR2GRAY)
+		const uchar *row0 = frame.ptr<uchar>(m_yRows[2*y]);
+		const uchar *row1 = frame.ptr<uchar>(m_yRows[2*y+1]);
+		const float wy = m_yWeights[y];
+		for (int x = 0; x < ImageWidth; x++) {
+			const uchar *p00 = row0 + m_xOffsets[2*x];
+			const uchar *p01 = row0 + m_xOffsets[2*x+1];
+			const uchar *p10 = row1 + m_xOffsets[2*x];
+			const uchar *p11 = row1 + m_xOffsets[2*x+1];
+			const float wx = m_xWeights[x];
+			int bgr[3];
+			for (int c = 0; c < 3; c++) {
+				float top = p00[c] + wx*(p01[c]-p00[c]);
+				float bottom = p10[c] + wx*(p11[c]-p10[c]);
+				bgr[c] = cvRound(top + wy*(bottom-top));
+			}
+			grayRow[x] = static_cast<float>((bgr[0]*1868 + bgr[1]*9617 +
+						bgr[2]*4899 + (1 << 13)) >> 14);
+		}
+
+		//Horizontal pass for this row, immediately folded into the vertical one
+		for (int l = 0; l < FeatureWidth; l++) {
+			const float *basis = &m_rowBasis[l*ImageWidth];
+			float sum = 0.0f;
+			for (int x = 0; x < ImageWidth; x++) {
+				sum += basis[x]*grayRow[x];
+			}
+			rowCoeffs[l] = sum;
+		}
+		for (int k = 0; k < FeatureHeight; k++) {
+			const float weight = m_colBasis[k*ImageHeight+y];
+			float *out = features.ptr<float>(k);
+			for (int l = 0; l < FeatureWidth; l++) {
+				out[l] += weight*rowCoeffs[l];
+			}
+		}
+	}
+	return features;
+}
+
+
+cv::Mat DCTFeatureExtractor::computeReference(const cv::Mat &frame) {
+	cv::Mat img, dctImage;
+	cv::resize(frame, img, cv::Size(ImageWidth, ImageHeight));
+	if (img.channels() != 1) {
+		cv::cvtColor(img,img, cv::COLOR_BGR2GRAY);
+	}
+	img.convertTo(img, CV_32FC1);
+	cv::dct(img/255.0, dctImage);
+	return dctImage(cv::Rect(0,0,FeatureWidth,FeatureHeight));
+}
+
+
+void DCTFeatureExtractor::updateSamplingTables(const cv::Size &frameSize) {
+	//Source coordinates follow cv::resize INTER_LINEAR
+	m_frameSize = frameSize;
+	double scaleX = static_cast<double>(frameSize.width) / ImageWidth;
+	double scaleY = static_cast<double>(frameSize.height) / ImageHeight;
+	m_xOffsets.resize(2*ImageWidth);
+	m_xWeights.resize(ImageWidth);
+	for (int x = 0; x < ImageWidth; x++) {
+		double fx = (x+0.5)*scaleX - 0.5;
+		int sx = cvFloor(fx);
+		fx -= sx;
+		if (sx < 0) {
+			sx = 0;
+			fx = 0;
+		}
+		int sx1 = sx + 1;
+		if (sx >= frameSize.width-1) {
+			sx = frameSize.width-1;
+			sx1 = sx;
+			fx = 0;
+		}
+		m_xOffsets[2*x] = sx*3;
+		m_xOffsets[2*x+1] = sx1*3;
+		m_xWeights[x] = static_cast<float>(fx);
+	}
+	m_yRows.resize(2*ImageHeight);
+	m_yWeights.resize(ImageHeight);
+	for (int y = 0; y < ImageHeight; y++) {
+		double fy = (y+0.5)*scaleY - 0.5;
+		int sy = cvFloor(fy);
+		fy -= sy;
+		if (sy < 0) {
+			sy = 0;
+			fy = 0;
+		}
+		int sy1 = sy + 1;
+		if (sy >= frameSize.height-1) {
+			sy = frameSize.height-1;
+			sy1 = sy;
+			fy = 0;
+		}
+		m_yRows[2*y] = sy;
+		m_yRows[2*y+1] = sy1;
+		m_yWeights[y] = static_cast<float>(fy);
+	}
+}
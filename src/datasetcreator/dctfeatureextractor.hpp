@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * File:			  dctfeatureextractor.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef DCTFEATUREEXTRACTOR_H
+#define DCTFEATUREEXTRACTOR_H
+
+#include "globals.hpp"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <vector>
+
+
+class DCTFeatureExtractor {
+	public:
+		static constexpr int ImageWidth = 160;
+		static constexpr int ImageHeight = 128;
+		static constexpr int FeatureWidth = 20;
+		static constexpr int FeatureHeight = 16;
+
+		explicit DCTFeatureExtractor();
+		cv::Mat compute(const cv::Mat &frame);
+		static cv::Mat computeReference(const cv::Mat &frame);
+
+	private:
+		std::vector<float> m_rowBasis;
+		std::vector<float> m_colBasis;
+		std::vector<int> m_xOffsets;
+		std::vector<float> m_xWeights;
+		std::vector<int> m_yRows;
+		std::vector<float> m_yWeights;
+		std::vector<float> m_grayRow;
+		std::vector<float> m_rowCoeffs;
+		cv::Size m_frameSize;
+
+		void updateSamplingTables(const cv::Size &frameSize);
+};
+
+#endif
@@ -0,0 +1,233 @@
+/*******************************************************************************
+ * File:			  featurecache.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "featurecache.hpp"
+#include "dctfeatureextractor.hpp"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+static const char CacheMagic[4] = {'J','D','C','T'};
+static const qint32 CacheVersion = 1;
+static const int FeatureSize = DCTFeatureExtractor::FeatureWidth *
+			DCTFeatureExtractor::FeatureHeight;
+
+
+FeatureCache::FeatureCache(const QString &videoPath, const QString &cacheDir,
+			int maxSizeMB) : m_maxSize(static_cast<qint64>(maxSizeMB)*1024*1024) {
+	QFileInfo videoInfo(videoPath);
+	m_videoSize = videoInfo.size();
+	m_videoMTime = videoInfo.lastModified().toMSecsSinceEpoch();
+	m_cacheDir = (cacheDir == "") ? defaultCacheDir() : cacheDir;
+	QDir().mkpath(m_cacheDir);
+	QString key = QCryptographicHash::hash(
+				videoInfo.absoluteFilePath().toUtf8(),
+				QCryptographicHash::Sha1).toHex();
+	m_cachePath = m_cacheDir + "/" + key + ".dct";
+	open();
+}
+
+
+FeatureCache::~FeatureCache() {
+	close();
+}
+
+
+QString FeatureCache::defaultCacheDir() {
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+				"/dctfeatures";
+}
+
+
+bool FeatureCache::lookup(int frameNumber, cv::Mat &features) const {
+	//Shared by all streamers working on chunks of the same video
+	QMutexLocker locker(&m_mutex);
+	auto newEntry = m_newEntries.constFind(frameNumber);
+	if (newEntry != m_newEntries.constEnd()) {
+		features = newEntry.value();
+		return true;
+	}
+	if (m_count == 0) {
+		return false;
+	}
+	const qint32 *end = m_frameNumbers + m_count;
+	const qint32 *it = std::lower_bound(m_frameNumbers, end, frameNumber);
+	if (it == end || *it != frameNumber) {
+		return false;
+	}
+	//Clone so the features stay valid after the file gets unmapped
+	features = cv::Mat(DCTFeatureExtractor::FeatureHeight,
+				DCTFeatureExtractor::FeatureWidth, CV_32FC1,
+				const_cast<float*>(m_features + (it - m_frameNumbers)*FeatureSize)).clone();
+	return true;
+}
+
+
+void FeatureCache::insert(int frameNumber, const cv::Mat &features) {
+	QMutexLocker locker(&m_mutex);
+	m_newEntries[frameNumber] = features;
+}
+
+
+int FeatureCache::size() const {
+	QMutexLocker locker(&m_mutex);
+	return m_count + m_newEntries.size();
+}
+
+
+bool FeatureCache::save() {
+	QMutexLocker locker(&m_mutex);
+	if (m_newEntries.isEmpty()) {
+		return true;
+	}
+	//Merge the mapped entries with the new ones, both are sorted by frame number
+	std::vector<qint32> frameNumbers;
+	std::vector<float> features;
+	frameNumbers.reserve(m_count + m_newEntries.size());
+	features.reserve((m_count + m_newEntries.size())*FeatureSize);
+	auto appendEntry = [&](int frameNumber, const float *data) {
+		frameNumbers.push_back(frameNumber);
+		features.insert(features.end(), data, data + FeatureSize);
+	};
+	qint64 i = 0;
+	for (auto it = m_newEntries.constBegin(); it != m_newEntries.constEnd(); ++it) {
+		while (i < m_count && m_frameNumbers[i] < it.key()) {
+			appendEntry(m_frameNumbers[i], m_features + i*FeatureSize);
+			i++;
+		}
+		if (i < m_count && m_frameNumbers[i] == it.key()) {
+			i++;
+		}
+		cv::Mat entry = it.value().isContinuous() ? it.value() : it.value().clone();
+		appendEntry(it.key(), entry.ptr<float>(0));
+	}
+	for (; i < m_count; i++) {
+		appendEntry(m_frameNumbers[i], m_features + i*FeatureSize);
+	}
+	close();
+
+	Header header;
+	std::memcpy(header.magic, CacheMagic, 4);
+	header.version = CacheVersion;
+	header.imageWidth = DCTFeatureExtractor::ImageWidth;
+	header.imageHeight = DCTFeatureExtractor::ImageHeight;
+	header.featureWidth = DCTFeatureExtractor::FeatureWidth;
+	header.featureHeight = DCTFeatureExtractor::FeatureHeight;
+	header.videoSize = m_videoSize;
+	header.videoMTime = m_videoMTime;
+	header.count = frameNumbers.size();
+
+	QSaveFile file(m_cachePath);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(frameNumbers.data()),
+				frameNumbers.size()*sizeof(qint32));
+	file.write(reinterpret_cast<const char*>(features.data()),
+				features.size()*sizeof(float));
+	if (!file.commit()) {
+		return false;
+	}
+	m_newEntries.clear();
+	evict();
+	return open();
+}
+
+
+bool FeatureCache::open() {
+	m_file.setFileName(m_cachePath);
+	if (!m_file.exists() || !m_file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	if (m_file.size() < static_cast<qint64>(sizeof(Header))) {
+		m_file.close();
+		return false;
+	}
+	m_mapped = m_file.map(0, m_file.size());
+	if (m_mapped == nullptr) {
+		m_file.close();
+		return false;
+	}
+	Header header;
+	std::memcpy(&header, m_mapped, sizeof(Header));
+	qint64 expectedSize = sizeof(Header) + header.count*(sizeof(qint32) +
+				FeatureSize*sizeof(float));
+	if (!headerMatches(header) || m_file.size() != expectedSize) {
+		//Stale cache, the video changed or the feature layout is different
+		close();
+		return false;
+	}
+	//The modification time doubles as last access time for the eviction
+	m_file.setFileTime(QDateTime::currentDateTime(),
+				QFileDevice::FileModificationTime);
+	m_count = header.count;
+	m_frameNumbers = reinterpret_cast<const qint32*>(m_mapped + sizeof(Header));
+	m_features = reinterpret_cast<const float*>(m_mapped + sizeof(Header) +
+				m_count*sizeof(qint32));
+	return true;
+}
+
+
+void FeatureCache::close() {
+	if (m_mapped != nullptr) {
+		m_file.unmap(m_mapped);
+		m_mapped = nullptr;
+	}
+	if (m_file.isOpen()) {
+		m_file.close();
+	}
+	m_frameNumbers = nullptr;
+	m_features = nullptr;
+	m_count = 0;
+}
+
+
+bool FeatureCache::headerMatches(const Header &header) const {
+	return std::memcmp(header.magic, CacheMagic, 4) == 0 &&
+				header.version == CacheVersion &&
+				header.imageWidth == DCTFeatureExtractor::ImageWidth &&
+				header.imageHeight == DCTFeatureExtractor::ImageHeight &&
+				header.featureWidth == DCTFeatureExtractor::FeatureWidth &&
+				header.featureHeight == DCTFeatureExtractor::FeatureHeight &&
+				header.videoSize == m_videoSize &&
+				header.videoMTime == m_videoMTime;
+}
+
+
+void FeatureCache::evict() const {
+	//Drop the least recently used caches of other videos until the directory
+	//fits the cap again
+	if (m_maxSize <= 0) {
+		return;
+	}
+	QFileInfoList cacheFiles = QDir(m_cacheDir).entryInfoList({"*.dct"},
+				QDir::Files, QDir::Time);
+	qint64 totalSize = 0;
+	for (const auto &cacheFile : cacheFiles) {
+		totalSize += cacheFile.size();
+	}
+	for (int i = cacheFiles.size()-1; i >= 0 && totalSize > m_maxSize; i--) {
+		if (cacheFiles[i].absoluteFilePath() ==
+					QFileInfo(m_cachePath).absoluteFilePath()) {
+			continue;
+		}
+		if (QFile::remove(cacheFiles[i].absoluteFilePath())) {
+			totalSize -= cacheFiles[i].size();
+		}
+	}
+}
@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * File:			  featurecache.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef FEATURECACHE_H
+#define FEATURECACHE_H
+
+#include "globals.hpp"
+
+#include "opencv2/core/core.hpp"
+
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+
+
+class FeatureCache {
+	public:
+		explicit FeatureCache(const QString &videoPath,
+					const QString &cacheDir = "", int maxSizeMB = 0);
+		~FeatureCache();
+		bool lookup(int frameNumber, cv::Mat &features) const;
+		void insert(int frameNumber, const cv::Mat &features);
+		bool save();
+		int size() const;
+		static QString defaultCacheDir();
+
+	private:
+		struct Header {
+			char magic[4];
+			qint32 version;
+			qint32 imageWidth;
+			qint32 imageHeight;
+			qint32 featureWidth;
+			qint32 featureHeight;
+			qint64 videoSize;
+			qint64 videoMTime;
+			qint64 count;
+		};
+
+		QString m_cacheDir;
+		QString m_cachePath;
+		qint64 m_maxSize;
+		qint64 m_videoSize = 0;
+		qint64 m_videoMTime = 0;
+		QFile m_file;
+		uchar *m_mapped = nullptr;
+		const qint32 *m_frameNumbers = nullptr;
+		const float *m_features = nullptr;
+		qint64 m_count = 0;
+		QMap<int, cv::Mat> m_newEntries;
+		mutable QMutex m_mutex;
+
+		bool open();
+		void close();
+		bool headerMatches(const Header &header) const;
+		void evict() const;
+};
+
+#endif
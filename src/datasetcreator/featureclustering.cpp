@@ -0,0 +1,300 @@
+/*******************************************************************************
+ * File:			  featureclustering.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "featureclustering.hpp"
+
+#include "opencv2/core/utility.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+static const int BlockRows = 4096;
+static const int SeedSampleRows = 65536;
+
+
+static void blockDistances(const cv::Mat &block, const cv::Mat &blockNorms,
+			const cv::Mat &centers, const cv::Mat &centerNorms,
+			cv::Mat &distances) {
+	//|x-c|^2 = |x|^2 - 2x.c + |c|^2, all dot products of a block are one gemm
+	cv::gemm(block, centers, -2.0, cv::noArray(), 0.0, distances,
+				cv::GEMM_2_T);
+	for (int i = 0; i < distances.rows; i++) {
+		float *d = distances.ptr<float>(i);
+		const float rowNorm = blockNorms.at<float>(i);
+		for (int c = 0; c < distances.cols; c++) {
+			d[c] = std::max(0.0f, d[c] + rowNorm + centerNorms.at<float>(c));
+		}
+	}
+}
+
+
+FeatureClustering::FeatureClustering(int numClusters, int batchSize,
+			int maxIterations, int attempts) :
+			m_numClusters(numClusters), m_batchSize(std::max(1, batchSize)),
+			m_maxIterations(std::max(1, maxIterations)),
+			m_attempts(std::max(1, attempts)), m_rng(0x4a415256) {
+}
+
+
+QList<int> FeatureClustering::representativeRows(const cv::Mat &features) {
+	QList<int> rows;
+	int numClusters = std::min(m_numClusters, features.rows);
+	if (features.empty() || numClusters <= 0) {
+		return rows;
+	}
+	CV_Assert(features.type() == CV_32FC1);
+	m_numClusters = numClusters;
+	cv::Mat rowNorms;
+	squaredNorms(features, rowNorms);
+
+	double bestInertia = DBL_MAX;
+	for (int attempt = 0; attempt < m_attempts; attempt++) {
+		cv::Mat centers = seedCenters(features, rowNorms);
+		double inertia;
+		if (features.rows <= m_batchSize) {
+			inertia = lloyd(features, rowNorms, centers);
+		}
+		else {
+			inertia = miniBatch(features, rowNorms, centers);
+		}
+		if (inertia < bestInertia) {
+			bestInertia = inertia;
+			m_centers = centers;
+		}
+	}
+
+	for (const auto &row : nearestRows(features, rowNorms, m_centers)) {
+		rows.append(row);
+	}
+	return rows;
+}
+
+
+void FeatureClustering::squaredNorms(const cv::Mat &features, cv::Mat &norms) {
+	norms.create(features.rows, 1, CV_32FC1);
+	cv::parallel_for_(cv::Range(0, features.rows), [&](const cv::Range &range) {
+		for (int i = range.start; i < range.end; i++) {
+			const float *row = features.ptr<float>(i);
+			float sum = 0.0f;
+			for (int j = 0; j < features.cols; j++) {
+				sum += row[j]*row[j];
+			}
+			norms.at<float>(i) = sum;
+		}
+	});
+}
+
+
+double FeatureClustering::assign(const cv::Mat &features,
+			const cv::Mat &rowNorms, const cv::Mat &centers,
+			std::vector<int> &labels) {
+	cv::Mat centerNorms;
+	squaredNorms(centers, centerNorms);
+	labels.resize(features.rows);
+	int numBlocks = (features.rows + BlockRows - 1) / BlockRows;
+	std::vector<double> blockInertia(numBlocks, 0.0);
+	cv::parallel_for_(cv::Range(0, numBlocks), [&](const cv::Range &range) {
+		cv::Mat distances;
+		for (int b = range.start; b < range.end; b++) {
+			int first = b*BlockRows;
+			int last = std::min(features.rows, first + BlockRows);
+			blockDistances(features.rowRange(first, last),
+						rowNorms.rowRange(first, last), centers, centerNorms, distances);
+			for (int i = 0; i < last-first; i++) {
+				const float *d = distances.ptr<float>(i);
+				int best = std::min_element(d, d + centers.rows) - d;
+				labels[first+i] = best;
+				blockInertia[b] += d[best];
+			}
+		}
+	});
+	return std::accumulate(blockInertia.begin(), blockInertia.end(), 0.0);
+}
+
+
+std::vector<int> FeatureClustering::nearestRows(const cv::Mat &features,
+			const cv::Mat &rowNorms, const cv::Mat &centers) {
+	//Per block minimum for every center, then reduced in block order so ties
+	//resolve to the first row like a plain linear scan would
+	cv::Mat centerNorms;
+	squaredNorms(centers, centerNorms);
+	int numCenters = centers.rows;
+	int numBlocks = (features.rows + BlockRows - 1) / BlockRows;
+	std::vector<float> blockBest(numBlocks*numCenters, FLT_MAX);
+	std::vector<int> blockRow(numBlocks*numCenters, 0);
+	cv::parallel_for_(cv::Range(0, numBlocks), [&](const cv::Range &range) {
+		cv::Mat distances;
+		for (int b = range.start; b < range.end; b++) {
+			int first = b*BlockRows;
+			int last = std::min(features.rows, first + BlockRows);
+			blockDistances(features.rowRange(first, last),
+						rowNorms.rowRange(first, last), centers, centerNorms, distances);
+			float *best = &blockBest[b*numCenters];
+			int *bestRow = &blockRow[b*numCenters];
+			for (int i = 0; i < last-first; i++) {
+				const float *d = distances.ptr<float>(i);
+				for (int c = 0; c < numCenters; c++) {
+					if (d[c] < best[c]) {
+						best[c] = d[c];
+						bestRow[c] = first+i;
+					}
+				}
+			}
+		}
+	});
+	std::vector<int> rows(numCenters, 0);
+	for (int c = 0; c < numCenters; c++) {
+		float best = FLT_MAX;
+		for (int b = 0; b < numBlocks; b++) {
+			if (blockBest[b*numCenters+c] < best) {
+				best = blockBest[b*numCenters+c];
+				rows[c] = blockRow[b*numCenters+c];
+			}
+		}
+	}
+	return rows;
+}
+
+
+cv::Mat FeatureClustering::seedCenters(const cv::Mat &features,
+			const cv::Mat &rowNorms) {
+	//k-means++ on at most SeedSampleRows random rows, the distance updates
+	//after every new center run in parallel
+	cv::Mat samples = features;
+	cv::Mat sampleNorms = rowNorms;
+	if (features.rows > SeedSampleRows) {
+		samples.create(SeedSampleRows, features.cols, CV_32FC1);
+		sampleNorms.create(SeedSampleRows, 1, CV_32FC1);
+		for (int i = 0; i < SeedSampleRows; i++) {
+			int row = m_rng.uniform(0, features.rows);
+			features.row(row).copyTo(samples.row(i));
+			sampleNorms.at<float>(i) = rowNorms.at<float>(row);
+		}
+	}
+
+	int numSamples = samples.rows;
+	cv::Mat centers(m_numClusters, features.cols, CV_32FC1);
+	std::vector<float> minDistances(numSamples, FLT_MAX);
+	int next = m_rng.uniform(0, numSamples);
+	for (int c = 0; c < m_numClusters; c++) {
+		samples.row(next).copyTo(centers.row(c));
+		if (c == m_numClusters-1) {
+			break;
+		}
+		const float *center = centers.ptr<float>(c);
+		const float centerNorm = sampleNorms.at<float>(next);
+		cv::parallel_for_(cv::Range(0, numSamples), [&](const cv::Range &range) {
+			for (int i = range.start; i < range.end; i++) {
+				const float *row = samples.ptr<float>(i);
+				float dot = 0.0f;
+				for (int j = 0; j < samples.cols; j++) {
+					dot += row[j]*center[j];
+				}
+				float distance = std::max(0.0f, sampleNorms.at<float>(i) +
+							centerNorm - 2.0f*dot);
+				minDistances[i] = std::min(minDistances[i], distance);
+			}
+		});
+		double total = std::accumulate(minDistances.begin(), minDistances.end(),
+					0.0);
+		if (total <= 0.0) {
+			next = m_rng.uniform(0, numSamples);
+			continue;
+		}
+		double threshold = m_rng.uniform(0.0, total);
+		double sum = 0.0;
+		next = numSamples-1;
+		for (int i = 0; i < numSamples; i++) {
+			sum += minDistances[i];
+			if (sum >= threshold) {
+				next = i;
+				break;
+			}
+		}
+	}
+	return centers;
+}
+
+
+double FeatureClustering::lloyd(const cv::Mat &features,
+			const cv::Mat &rowNorms, cv::Mat &centers) {
+	std::vector<int> labels;
+	for (int iteration = 0; iteration < m_maxIterations; iteration++) {
+		assign(features, rowNorms, centers, labels);
+		cv::Mat sums = cv::Mat::zeros(centers.size(), CV_64FC1);
+		std::vector<int> counts(centers.rows, 0);
+		for (int i = 0; i < features.rows; i++) {
+			const float *row = features.ptr<float>(i);
+			double *sum = sums.ptr<double>(labels[i]);
+			for (int j = 0; j < features.cols; j++) {
+				sum[j] += row[j];
+			}
+			counts[labels[i]]++;
+		}
+		double maxShift = 0.0;
+		for (int c = 0; c < centers.rows; c++) {
+			if (counts[c] == 0) {
+				continue;	//Empty clusters keep their previous center
+			}
+			float *center = centers.ptr<float>(c);
+			const double *sum = sums.ptr<double>(c);
+			double shift = 0.0;
+			for (int j = 0; j < centers.cols; j++) {
+				float updated = static_cast<float>(sum[j] / counts[c]);
+				shift += (updated-center[j])*(updated-center[j]);
+				center[j] = updated;
+			}
+			maxShift = std::max(maxShift, shift);
+		}
+		if (maxShift <= m_epsilon) {
+			break;
+		}
+	}
+	return assign(features, rowNorms, centers, labels);
+}
+
+
+double FeatureClustering::miniBatch(const cv::Mat &features,
+			const cv::Mat &rowNorms, cv::Mat &centers) {
+	//Mini-batch k-means with per-center learning rates 1/count
+	std::vector<int> counts(centers.rows, 0);
+	std::vector<int> labels;
+	cv::Mat batch(m_batchSize, features.cols, CV_32FC1);
+	cv::Mat batchNorms(m_batchSize, 1, CV_32FC1);
+	cv::Mat previous;
+	for (int iteration = 0; iteration < m_maxIterations; iteration++) {
+		for (int i = 0; i < m_batchSize; i++) {
+			int row = m_rng.uniform(0, features.rows);
+			features.row(row).copyTo(batch.row(i));
+			batchNorms.at<float>(i) = rowNorms.at<float>(row);
+		}
+		assign(batch, batchNorms, centers, labels);
+		centers.copyTo(previous);
+		for (int i = 0; i < m_batchSize; i++) {
+			int c = labels[i];
+			counts[c]++;
+			const float rate = 1.0f / counts[c];
+			float *center = centers.ptr<float>(c);
+			const float *row = batch.ptr<float>(i);
+			for (int j = 0; j < features.cols; j++) {
+				center[j] += rate*(row[j]-center[j]);
+			}
+		}
+		double maxShift = 0.0;
+		for (int c = 0; c < centers.rows; c++) {
+			maxShift = std::max(maxShift, cv::norm(centers.row(c), previous.row(c),
+						cv::NORM_L2SQR));
+		}
+		if (maxShift <= m_epsilon) {
+			break;
+		}
+	}
+	return assign(features, rowNorms, centers, labels);
+}
@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * File:			  featureclustering.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef FEATURECLUSTERING_H
+#define FEATURECLUSTERING_H
+
+#include "globals.hpp"
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+
+
+class FeatureClustering {
+	public:
+		explicit FeatureClustering(int numClusters, int batchSize = 4096,
+					int maxIterations = 300, int attempts = 3);
+		QList<int> representativeRows(const cv::Mat &features);
+		cv::Mat centers() const {return m_centers;}
+		static void squaredNorms(const cv::Mat &features, cv::Mat &norms);
+		static double assign(const cv::Mat &features, const cv::Mat &rowNorms,
+					const cv::Mat &centers, std::vector<int> &labels);
+		static std::vector<int> nearestRows(const cv::Mat &features,
+					const cv::Mat &rowNorms, const cv::Mat &centers);
+
+	private:
+		int m_numClusters;
+		int m_batchSize;
+		int m_maxIterations;
+		int m_attempts;
+		double m_epsilon = 1e-4;
+		cv::RNG m_rng;
+		cv::Mat m_centers;
+
+		cv::Mat seedCenters(const cv::Mat &features, const cv::Mat &rowNorms);
+		double lloyd(const cv::Mat &features, const cv::Mat &rowNorms,
+					cv::Mat &centers);
+		double miniBatch(const cv::Mat &features, const cv::Mat &rowNorms,
+					cv::Mat &centers);
+};
+
+#endif
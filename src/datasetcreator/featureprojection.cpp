@@ -0,0 +1,136 @@
+/*******************************************************************************
+ * File:			  featureprojection.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "featureprojection.hpp"
+
+#include <algorithm>
+
+static const int BlockRows = 4096;
+static const int Oversampling = 10;
+
+
+FeatureProjection::FeatureProjection(int dimensions, const QString &method,
+			int powerIterations) : m_dimensions(std::max(1, dimensions)),
+			m_method(method), m_powerIterations(std::max(0, powerIterations)),
+			m_rng(0x4a415256) {
+}
+
+
+void FeatureProjection::fit(const cv::Mat &features) {
+	CV_Assert(features.type() == CV_32FC1);
+	int numDims = features.cols;
+	m_dimensions = std::min(m_dimensions, numDims);
+	computeMean(features);
+
+	if (m_method == "random") {
+		//Orthonormal Gaussian rows, nothing is learned from the data
+		cv::Mat basis(numDims, m_dimensions, CV_32FC1);
+		m_rng.fill(basis, cv::RNG::NORMAL, 0.0, 1.0);
+		m_components = orthonormalize(basis).t();
+		m_explainedVariance = 0.0;
+		return;
+	}
+
+	//Randomized subspace iteration on the covariance. Every pass streams the
+	//rows block by block and only keeps a D x k basis, the features are never
+	//centered or copied as a whole.
+	int numBasis = std::min(numDims, m_dimensions + Oversampling);
+	cv::Mat basis(numDims, numBasis, CV_32FC1);
+	m_rng.fill(basis, cv::RNG::NORMAL, 0.0, 1.0);
+	basis = orthonormalize(basis);
+	for (int i = 0; i < m_powerIterations; i++) {
+		basis = orthonormalize(covarianceTimes(features, basis));
+	}
+
+	//Rayleigh-Ritz: eigenvectors of the covariance restricted to the basis
+	cv::Mat projected = covarianceTimes(features, basis);
+	cv::Mat restricted;
+	cv::gemm(basis, projected, 1.0, cv::noArray(), 0.0, restricted,
+				cv::GEMM_1_T);
+	restricted = 0.5*(restricted + restricted.t());
+	cv::Mat eigenvalues, eigenvectors;
+	cv::eigen(restricted, eigenvalues, eigenvectors);
+	cv::gemm(eigenvectors.rowRange(0, m_dimensions), basis, 1.0, cv::noArray(),
+				0.0, m_components, cv::GEMM_2_T);
+
+	double totalVariance = 0.0;
+	for (int i = 0; i < features.rows; i++) {
+		totalVariance += cv::norm(features.row(i), m_mean, cv::NORM_L2SQR);
+	}
+	double keptVariance = cv::sum(eigenvalues.rowRange(0, m_dimensions))[0];
+	m_explainedVariance = totalVariance > 0.0 ? keptVariance / totalVariance : 1.0;
+}
+
+
+cv::Mat FeatureProjection::project(const cv::Mat &features) const {
+	cv::Mat reduced(features.rows, m_components.rows, CV_32FC1);
+	cv::Mat meanOffset;
+	cv::gemm(m_mean, m_components, 1.0, cv::noArray(), 0.0, meanOffset,
+				cv::GEMM_2_T);
+	for (int first = 0; first < features.rows; first += BlockRows) {
+		int last = std::min(features.rows, first + BlockRows);
+		cv::Mat block = reduced.rowRange(first, last);
+		cv::gemm(features.rowRange(first, last), m_components, 1.0, cv::noArray(),
+					0.0, block, cv::GEMM_2_T);
+		for (int i = 0; i < block.rows; i++) {
+			block.row(i) -= meanOffset;
+		}
+	}
+	return reduced;
+}
+
+
+cv::Mat FeatureProjection::backProject(const cv::Mat &reduced) const {
+	cv::Mat features;
+	cv::gemm(reduced, m_components, 1.0, cv::noArray(), 0.0, features);
+	for (int i = 0; i < features.rows; i++) {
+		features.row(i) += m_mean;
+	}
+	return features;
+}
+
+
+void FeatureProjection::computeMean(const cv::Mat &features) {
+	cv::Mat sum = cv::Mat::zeros(1, features.cols, CV_64FC1);
+	for (int first = 0; first < features.rows; first += BlockRows) {
+		int last = std::min(features.rows, first + BlockRows);
+		cv::Mat blockSum;
+		cv::reduce(features.rowRange(first, last), blockSum, 0, cv::REDUCE_SUM,
+					CV_64FC1);
+		sum += blockSum;
+	}
+	sum /= std::max(1, features.rows);
+	sum.convertTo(m_mean, CV_32FC1);
+}
+
+
+cv::Mat FeatureProjection::covarianceTimes(const cv::Mat &features,
+			const cv::Mat &basis) const {
+	//(X - 1m)^T (X - 1m) B = sum over blocks of Xb^T (Xb B) - n m^T (m B)
+	cv::Mat result = cv::Mat::zeros(features.cols, basis.cols, CV_32FC1);
+	cv::Mat rowsTimesBasis;
+	for (int first = 0; first < features.rows; first += BlockRows) {
+		int last = std::min(features.rows, first + BlockRows);
+		cv::Mat block = features.rowRange(first, last);
+		cv::gemm(block, basis, 1.0, cv::noArray(), 0.0, rowsTimesBasis);
+		cv::gemm(block, rowsTimesBasis, 1.0, result, 1.0, result, cv::GEMM_1_T);
+	}
+	cv::Mat meanTimesBasis;
+	cv::gemm(m_mean, basis, 1.0, cv::noArray(), 0.0, meanTimesBasis);
+	cv::gemm(m_mean, meanTimesBasis, -static_cast<double>(features.rows),
+				result, 1.0, result, cv::GEMM_1_T);
+	return result;
+}
+
+
+cv::Mat FeatureProjection::orthonormalize(const cv::Mat &basis) {
+	cv::Mat w, u, vt;
+	cv::SVD::compute(basis, w, u, vt);
+	return u;
+}
@@ -0,0 +1,41 @@
+/*******************************************************************************
+ * File:			  featureprojection.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef FEATUREPROJECTION_H
+#define FEATUREPROJECTION_H
+
+#include "globals.hpp"
+
+#include "opencv2/core/core.hpp"
+
+
+class FeatureProjection {
+	public:
+		explicit FeatureProjection(int dimensions, const QString &method = "pca",
+					int powerIterations = 2);
+		void fit(const cv::Mat &features);
+		cv::Mat project(const cv::Mat &features) const;
+		cv::Mat backProject(const cv::Mat &reduced) const;
+		double explainedVariance() const {return m_explainedVariance;}
+
+	private:
+		int m_dimensions;
+		QString m_method;
+		int m_powerIterations;
+		cv::RNG m_rng;
+		cv::Mat m_mean;	//1 x D
+		cv::Mat m_components;	//d x D, orthonormal rows
+		double m_explainedVariance = 0.0;
+
+		void computeMean(const cv::Mat &features);
+		cv::Mat covarianceTimes(const cv::Mat &features, const cv::Mat &basis) const;
+		static cv::Mat orthonormalize(const cv::Mat &basis);
+};
+
+#endif
@@ -0,0 +1,175 @@
+/*******************************************************************************
+ * File:			  framesampler.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "framesampler.hpp"
+
+#include "opencv2/core/utility.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+
+static const int BlockRows = 4096;
+static const double MotionFloor = 0.1;	//Share of the mean energy every sample gets, still scenes stay covered
+static const int MaxGapFactor = 4;	//Larger frame gaps than this times the median start a new segment
+
+
+static float squaredDistance(const float *a, const float *b, int length) {
+	float sum = 0.0f;
+	for (int j = 0; j < length; j++) {
+		float d = a[j] - b[j];
+		sum += d*d;
+	}
+	return sum;
+}
+
+
+QList<int> FrameSampler::kCenterRows(const cv::Mat &features, int numFrames) {
+	//Greedy farthest point traversal. Every step adds the sample farthest from
+	//all picked ones, which is a 2-approximation of the optimal k-center cover.
+	QList<int> rows;
+	numFrames = std::min(numFrames, features.rows);
+	if (features.empty() || numFrames <= 0) {
+		return rows;
+	}
+	CV_Assert(features.type() == CV_32FC1);
+	const int numBlocks = (features.rows + BlockRows - 1) / BlockRows;
+	std::vector<float> minDistances(features.rows);
+	std::vector<float> blockBest(numBlocks);
+	std::vector<int> blockRow(numBlocks);
+
+	//Deterministic start at the sample closest to the mean
+	cv::Mat mean;
+	cv::reduce(features, mean, 0, cv::REDUCE_AVG);
+	cv::parallel_for_(cv::Range(0, features.rows), [&](const cv::Range &range) {
+		for (int row = range.start; row < range.end; row++) {
+			minDistances[row] = squaredDistance(features.ptr<float>(row),
+						mean.ptr<float>(0), features.cols);
+		}
+	});
+	rows.append(std::min_element(minDistances.begin(), minDistances.end()) -
+				minDistances.begin());
+	std::fill(minDistances.begin(), minDistances.end(), FLT_MAX);
+
+	while (rows.size() < numFrames) {
+		const float *center = features.ptr<float>(rows.last());
+		cv::parallel_for_(cv::Range(0, numBlocks), [&](const cv::Range &range) {
+			for (int b = range.start; b < range.end; b++) {
+				int first = b*BlockRows;
+				int last = std::min(features.rows, first + BlockRows);
+				blockBest[b] = -1.0f;
+				for (int row = first; row < last; row++) {
+					minDistances[row] = std::min(minDistances[row], squaredDistance(
+								features.ptr<float>(row), center, features.cols));
+					if (minDistances[row] > blockBest[b]) {
+						blockBest[b] = minDistances[row];
+						blockRow[b] = row;
+					}
+				}
+			}
+		});
+		//Reduced in block order so ties go to the earlier row
+		int best = std::max_element(blockBest.begin(), blockBest.end()) -
+					blockBest.begin();
+		if (blockBest[best] <= 0.0f) {
+			//Only duplicates of picked samples are left
+			break;
+		}
+		rows.append(blockRow[best]);
+	}
+	return rows;
+}
+
+
+std::vector<double> FrameSampler::motionEnergy(const cv::Mat &features,
+			const QList<int> &rowFrameNumbers) {
+	//The features are the low frequency DCT of the downsampled frame, by
+	//Parseval their distance is the energy of the low passed frame difference
+	std::vector<double> energy(features.rows, 0.0);
+	if (features.rows < 2) {
+		return energy;
+	}
+	std::vector<int> gaps;
+	for (int row = 1; row < rowFrameNumbers.size(); row++) {
+		if (rowFrameNumbers[row] > rowFrameNumbers[row-1]) {
+			gaps.push_back(rowFrameNumbers[row] - rowFrameNumbers[row-1]);
+		}
+	}
+	int maxGap = INT_MAX;
+	if (!gaps.empty()) {
+		std::nth_element(gaps.begin(), gaps.begin() + gaps.size()/2, gaps.end());
+		maxGap = MaxGapFactor * gaps[gaps.size()/2];
+	}
+	auto continues = [&](int row) {
+		int gap = rowFrameNumbers[row] - rowFrameNumbers[row-1];
+		return gap > 0 && gap <= maxGap;
+	};
+	cv::parallel_for_(cv::Range(1, features.rows), [&](const cv::Range &range) {
+		for (int row = range.start; row < range.end; row++) {
+			if (continues(row)) {
+				energy[row] = squaredDistance(features.ptr<float>(row),
+							features.ptr<float>(row-1), features.cols);
+			}
+		}
+	});
+	//First sample of a segment takes over the motion towards its successor
+	for (int row = 0; row < features.rows; row++) {
+		if ((row == 0 || !continues(row)) && row+1 < features.rows &&
+					continues(row+1)) {
+			energy[row] = energy[row+1];
+		}
+	}
+	return energy;
+}
+
+
+QList<int> FrameSampler::motionWeightedRows(const cv::Mat &features,
+			const QList<int> &rowFrameNumbers, int numFrames) {
+	//Systematic sampling along the cumulative motion energy, stretches with a
+	//lot of movement get proportionally more frames
+	QList<int> rows;
+	numFrames = std::min(numFrames, features.rows);
+	if (features.empty() || numFrames <= 0) {
+		return rows;
+	}
+	CV_Assert(features.type() == CV_32FC1);
+	std::vector<double> energy = motionEnergy(features, rowFrameNumbers);
+	double meanEnergy = 0.0;
+	for (const auto &e : energy) {
+		meanEnergy += e;
+	}
+	meanEnergy /= energy.size();
+	double floor = meanEnergy > 0.0 ? MotionFloor * meanEnergy : 1.0;
+	std::vector<double> cumulative(energy.size());
+	double total = 0.0;
+	for (size_t row = 0; row < energy.size(); row++) {
+		total += energy[row] + floor;
+		cumulative[row] = total;
+	}
+
+	std::vector<bool> picked(features.rows, false);
+	double spacing = total / numFrames;
+	for (int i = 0; i < numFrames; i++) {
+		double position = (i + 0.5) * spacing;
+		int row = std::lower_bound(cumulative.begin(), cumulative.end(), position) -
+					cumulative.begin();
+		row = std::min(row, features.rows-1);
+		//Bursts of motion can put several positions into one sample
+		while (row < features.rows && picked[row]) {
+			row++;
+		}
+		if (row == features.rows) {
+			row = std::find(picked.begin(), picked.end(), false) - picked.begin();
+		}
+		picked[row] = true;
+		rows.append(row);
+	}
+	std::sort(rows.begin(), rows.end());
+	return rows;
+}
@@ -0,0 +1,29 @@
+/*******************************************************************************
+ * File:			  framesampler.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef FRAMESAMPLER_H
+#define FRAMESAMPLER_H
+
+#include "globals.hpp"
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+
+
+class FrameSampler {
+	public:
+		static QList<int> kCenterRows(const cv::Mat &features, int numFrames);
+		static QList<int> motionWeightedRows(const cv::Mat &features,
+					const QList<int> &rowFrameNumbers, int numFrames);
+		static std::vector<double> motionEnergy(const cv::Mat &features,
+					const QList<int> &rowFrameNumbers);
+};
+
+#endif
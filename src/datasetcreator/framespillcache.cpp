@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * File:			  framespillcache.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "framespillcache.hpp"
+
+#include <QDir>
+#include <QFile>
+
+
+FrameSpillCache::FrameSpillCache(qint64 memoryBudget, qint64 diskBudget,
+			const QString &spillDir) : m_memoryBudget(memoryBudget),
+			m_diskBudget(diskBudget) {
+	if (m_diskBudget > 0) {
+		QString dir = spillDir != "" ? spillDir : QDir::tempPath();
+		QDir().mkpath(dir);
+		m_spillFile.setFileTemplate(dir + "/jarvis_spill_XXXXXX.bin");
+		m_spillFileOpen = m_spillFile.open();
+	}
+}
+
+
+bool FrameSpillCache::insert(const QString &videoPath, int frameNumber,
+			const QByteArray &jpeg) {
+	if (jpeg.isEmpty() || m_full) {
+		return false;
+	}
+	QMutexLocker locker(&m_mutex);
+	Entry entry;
+	entry.size = jpeg.size();
+	if (m_memoryUsed + entry.size <= m_memoryBudget) {
+		entry.data = jpeg;
+		m_memoryUsed += entry.size;
+	}
+	else if (m_spillFileOpen && m_diskUsed + entry.size <= m_diskBudget) {
+		entry.offset = m_diskUsed;
+		if (!m_spillFile.seek(entry.offset) ||
+					m_spillFile.write(jpeg) != entry.size || !m_spillFile.flush()) {
+			m_spillFileOpen = false;
+			m_full = true;
+			return false;
+		}
+		m_diskUsed += entry.size;
+	}
+	else {
+		//Frames are all about the same size, once one does not fit the rest of
+		//the unit is decoded again during extraction
+		m_full = true;
+		return false;
+	}
+	m_entries[qMakePair(videoPath, frameNumber)] = entry;
+	return true;
+}
+
+
+bool FrameSpillCache::write(const QString &videoPath, int frameNumber,
+			const QString &framePath) const {
+	Entry entry;
+	{
+		QMutexLocker locker(&m_mutex);
+		auto it = m_entries.constFind(qMakePair(videoPath, frameNumber));
+		if (it == m_entries.constEnd()) {
+			return false;
+		}
+		entry = it.value();
+	}
+	QByteArray jpeg = entry.data;
+	if (entry.offset >= 0) {
+		//Every writer reads through its own handle, the spill file itself is
+		//only appended to under the mutex
+		QFile spillFile(m_spillFile.fileName());
+		if (!spillFile.open(QIODevice::ReadOnly) || !spillFile.seek(entry.offset)) {
+			return false;
+		}
+		jpeg = spillFile.read(entry.size);
+		if (jpeg.size() != entry.size) {
+			return false;
+		}
+	}
+	QFile file(framePath);
+	return file.open(QIODevice::WriteOnly) && file.write(jpeg) == jpeg.size();
+}
+
+
+int FrameSpillCache::size() const {
+	QMutexLocker locker(&m_mutex);
+	return m_entries.size();
+}
+
+
+qint64 FrameSpillCache::memoryUsed() const {
+	QMutexLocker locker(&m_mutex);
+	return m_memoryUsed;
+}
+
+
+qint64 FrameSpillCache::diskUsed() const {
+	QMutexLocker locker(&m_mutex);
+	return m_diskUsed;
+}
+
@@ -0,0 +1,54 @@
+/*******************************************************************************
+ * File:			  framespillcache.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef FRAMESPILLCACHE_H
+#define FRAMESPILLCACHE_H
+
+#include "globals.hpp"
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QTemporaryFile>
+
+#include <atomic>
+
+
+class FrameSpillCache {
+	public:
+		explicit FrameSpillCache(qint64 memoryBudget, qint64 diskBudget,
+					const QString &spillDir = "");
+		bool isFull() const {return m_full;}
+		bool insert(const QString &videoPath, int frameNumber,
+					const QByteArray &jpeg);
+		bool write(const QString &videoPath, int frameNumber,
+					const QString &framePath) const;
+		int size() const;
+		qint64 memoryUsed() const;
+		qint64 diskUsed() const;
+
+	private:
+		struct Entry {
+			QByteArray data;	//Empty if the frame was spilled to disk
+			qint64 offset = -1;
+			qint64 size = 0;
+		};
+
+		qint64 m_memoryBudget;
+		qint64 m_diskBudget;
+		qint64 m_memoryUsed = 0;
+		qint64 m_diskUsed = 0;
+		QHash<QPair<QString,int>, Entry> m_entries;
+		QTemporaryFile m_spillFile;
+		bool m_spillFileOpen = false;
+		std::atomic<bool> m_full {false};
+		mutable QMutex m_mutex;
+};
+
+#endif
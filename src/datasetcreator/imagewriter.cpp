@@ -15,43 +15,138 @@
 #include <QErrorMessage>
 #include <QDirIterator>
 #include <QThreadPool>
+#include <QScopedPointer>
 
+#include <algorithm>
 #include <chrono>
+#include <numeric>
 using namespace std::chrono;
 
 
 ImageWriter::ImageWriter(const QString &videoPath,
 			const QString &destinationPath, QList<int> frameNumbers,
-			int threadNumber) : m_destinationPath(destinationPath),
-			m_frameNumbers(frameNumbers), m_threadNumber(threadNumber) {
-		m_cap = new cv::VideoCapture(videoPath.toStdString());
+			int threadNumber, int chunkNumber, DatasetConfig *datasetConfig,
+			const std::atomic<bool> *canceled, JpegEncoderPool *encoderPool,
+			JpegEncoderPool::Batch *encoderBatch, const FrameSpillCache *spillCache) :
+			ImageWriter(videoPath, frameNumbers,
+			QList<QString>(frameNumbers.size(), destinationPath), threadNumber,
+			chunkNumber, datasetConfig, canceled, encoderPool, encoderBatch,
+			spillCache) {
+}
+
+
+ImageWriter::ImageWriter(const QString &videoPath, QList<int> frameNumbers,
+			QList<QString> destinationPaths, int threadNumber, int chunkNumber,
+			DatasetConfig *datasetConfig, const std::atomic<bool> *canceled,
+			JpegEncoderPool *encoderPool, JpegEncoderPool::Batch *encoderBatch,
+			const FrameSpillCache *spillCache) :
+			m_videoPath(videoPath), m_destinationPaths(destinationPaths),
+			m_frameNumbers(frameNumbers), m_threadNumber(threadNumber),
+			m_chunkNumber(chunkNumber), m_canceled(canceled),
+			m_encoderPool(encoderPool), m_encoderBatch(encoderBatch),
+			m_spillCache(spillCache) {
+		m_sequentialDecoding = datasetConfig->sequentialDecoding;
+		m_gopLength = datasetConfig->gopLength;
+		m_mjpegPassthrough = datasetConfig->mjpegPassthrough;
+		if (datasetConfig->useSeekIndex) {
+			m_seekIndex = SeekIndex::open(videoPath);
+		}
 }
 
 
 void ImageWriter::run() {
 	int totalNumFrames = m_frameNumbers.size();
 	int frameCount = 0;
+	m_stats = Stats();
 
-	for (const auto & frameNumber : m_frameNumbers) {
-		cv::Mat frame;
-		m_cap->set(cv::CAP_PROP_POS_FRAMES, frameNumber-1);
-		if (m_cap->read(frame) && cv::imwrite((m_destinationPath + "/" +  "Frame_" +
-		 		QString::number(frameNumber) + ".jpg").toStdString(), frame)) {
+	//Sorted frames let the reader decode forward through small gaps and only
+	//seek across gaps longer than a GOP
+	QList<int> order(m_frameNumbers.size());
+	std::iota(order.begin(), order.end(), 0);
+	if (m_sequentialDecoding) {
+		std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+			return m_frameNumbers[a] < m_frameNumbers[b];
+		});
+	}
+	m_cap.open(m_videoPath.toStdString());
+	SequentialFrameReader reader(&m_cap, m_gopLength, m_seekIndex.data());
+
+	//MJPEG frames are already JPEGs, they get copied out of the container and
+	//only frames the passthrough can't handle go through the decoder
+	QScopedPointer<MjpegPassthrough> passthrough;
+	if (m_mjpegPassthrough) {
+		passthrough.reset(new MjpegPassthrough(m_videoPath,
+					m_cap.get(cv::CAP_PROP_FRAME_COUNT)));
+	}
+
+	cv::Mat lastFrame;
+	int lastFrameNumber = -1;
+	for (const auto & index : order) {
+		int frameNumber = m_frameNumbers[index];
+		QString framePath = m_destinationPaths[index] + "/" +  "Frame_" +
+					QString::number(frameNumber) + ".jpg";
+		auto decodeStart = high_resolution_clock::now();
+		if (m_spillCache != nullptr &&
+					m_spillCache->write(m_videoPath, frameNumber, framePath)) {
+			//Encoded during the feature pass, nothing left to decode
+			m_stats.spilled++;
+			frameCount++;
+		}
+		else if (passthrough != nullptr && passthrough->isValid() &&
+					passthrough->writeFrame(frameNumber-1, framePath)) {
+			m_stats.copyTime += duration_cast<microseconds>(
+						high_resolution_clock::now() - decodeStart).count();
+			m_stats.copied++;
 			frameCount++;
 		}
 		else {
-			m_cap->release();
-			return;
+			cv::Mat frame;
+			bool readFrame;
+			if (frameNumber == lastFrameNumber) {
+				//Same frame picked for several subsets, the reader can't go back
+				frame = lastFrame;
+				readFrame = true;
+			}
+			else if (m_sequentialDecoding) {
+				readFrame = reader.read(frameNumber-1, frame);
+			}
+			else if (m_seekIndex != nullptr && m_seekIndex->isValid()) {
+				readFrame = m_seekIndex->seek(&m_cap, frameNumber-1) &&
+							m_cap.read(frame);
+			}
+			else {
+				m_cap.set(cv::CAP_PROP_POS_FRAMES, frameNumber-1);
+				readFrame = m_cap.read(frame);
+			}
+			lastFrame = frame;
+			lastFrameNumber = readFrame ? frameNumber : -1;
+			auto encodeStart = high_resolution_clock::now();
+			if (readFrame && m_encoderPool != nullptr) {
+				//Only blocks while the encoder queue is full
+				m_encoderPool->encode(frame, framePath, m_encoderBatch);
+				frameCount++;
+			}
+			else if (readFrame && cv::imwrite(framePath.toStdString(), frame)) {
+				frameCount++;
+			}
+			else {
+				m_failedFrames = totalNumFrames - frameCount;
+				m_cap.release();
+				return;
+			}
+			m_stats.decodeTime += duration_cast<microseconds>(
+						encodeStart - decodeStart).count();
+			m_stats.encodeTime += duration_cast<microseconds>(
+						high_resolution_clock::now() - encodeStart).count();
 		}
-		emit copyImagesStatus(frameCount, totalNumFrames, m_threadNumber);
-		if (m_interrupt) {
-			m_cap->release();
+		emit copyImagesStatus(frameCount, totalNumFrames, m_threadNumber,
+					m_chunkNumber);
+		if (*m_canceled) {
+			m_cap.release();
 			return;
 		}
 	}
-	m_cap->release();
-}
-
-void ImageWriter::creationCanceledSlot() {
-	m_interrupt = true;
+	m_cap.release();
+	m_stats.seeks = reader.seekCount();
+	m_stats.grabbed = reader.grabCount();
 }
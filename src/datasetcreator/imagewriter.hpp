@@ -11,34 +11,71 @@
 #define IMAGEWRITER_H
 
 #include "globals.hpp"
+#include "sequentialframereader.hpp"
+#include "jpegencoderpool.hpp"
+#include "mjpegpassthrough.hpp"
+#include "framespillcache.hpp"
 #include "opencv2/videoio/videoio.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/imgcodecs.hpp"
 
 #include <QRunnable>
 
+#include <atomic>
+
 
 class ImageWriter : public QObject, public QRunnable {
 	Q_OBJECT
 
 	public:
+		struct Stats {
+			int seeks = 0;
+			int grabbed = 0;
+			int copied = 0;
+			int spilled = 0;
+			qint64 decodeTime = 0;	//Microseconds
+			qint64 encodeTime = 0;
+			qint64 copyTime = 0;
+		};
+
 		explicit ImageWriter(const QString &videoPath,
 					const QString &destinationPath, QList<int> frameNumbers,
-					int threadNumber);
+					int threadNumber, int chunkNumber, DatasetConfig *datasetConfig,
+					const std::atomic<bool> *canceled,
+					JpegEncoderPool *encoderPool = nullptr,
+					JpegEncoderPool::Batch *encoderBatch = nullptr,
+					const FrameSpillCache *spillCache = nullptr);
+		explicit ImageWriter(const QString &videoPath, QList<int> frameNumbers,
+					QList<QString> destinationPaths, int threadNumber, int chunkNumber,
+					DatasetConfig *datasetConfig, const std::atomic<bool> *canceled,
+					JpegEncoderPool *encoderPool = nullptr,
+					JpegEncoderPool::Batch *encoderBatch = nullptr,
+					const FrameSpillCache *spillCache = nullptr);
 		void run();
+		int failedFrames() const {return m_failedFrames;}
+		const Stats &stats() const {return m_stats;}
 
 	signals:
-		void copyImagesStatus(int frameCount, int totalNumFrames, int threadNumber);
-
-	public slots:
-		void creationCanceledSlot();
+		void copyImagesStatus(int frameCount, int totalNumFrames, int threadNumber,
+					int chunkNumber);
 
 	private:
-		cv::VideoCapture *m_cap;
-		QString m_destinationPath;
+		cv::VideoCapture m_cap;	//Only open while run() is executing
+		QString m_videoPath;
+		QList<QString> m_destinationPaths;
 		QList<int> m_frameNumbers;
 		int m_threadNumber;
-		int m_interrupt = false;
+		int m_chunkNumber;
+		int m_failedFrames = 0;	//Frames left unwritten after a read or write error
+		Stats m_stats;
+		const std::atomic<bool> *m_canceled;
+		bool m_sequentialDecoding;
+		int m_gopLength;
+		bool m_mjpegPassthrough;
+		JpegEncoderPool *m_encoderPool;
+		JpegEncoderPool::Batch *m_encoderBatch;
+		const FrameSpillCache *m_spillCache;
+		QSharedPointer<SeekIndex> m_seekIndex;
 };
 
 #endif
@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * File:			  jpegencoderpool.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "jpegencoderpool.hpp"
+
+#include "opencv2/imgcodecs.hpp"
+
+#include <QFile>
+#include <QThread>
+
+#ifdef WITH_TURBOJPEG
+#include <turbojpeg.h>
+
+static int turboSubsampling(const QString &subsampling) {
+	if (subsampling == "444") return TJSAMP_444;
+	if (subsampling == "422") return TJSAMP_422;
+	return TJSAMP_420;
+}
+#endif
+
+
+JpegEncoder::JpegEncoder(int quality, const QString &subsampling) :
+			m_quality(quality) {
+#ifdef WITH_TURBOJPEG
+	m_handle = tjInitCompress();
+	m_subsampling = turboSubsampling(subsampling);
+#else
+	Q_UNUSED(subsampling);
+#endif
+}
+
+
+JpegEncoder::~JpegEncoder() {
+#ifdef WITH_TURBOJPEG
+	tjFree(m_buffer);
+	if (m_handle != nullptr) {
+		tjDestroy(m_handle);
+	}
+#endif
+}
+
+
+QByteArray JpegEncoder::encode(const cv::Mat &frame) {
+#ifdef WITH_TURBOJPEG
+	bool gray = frame.channels() == 1;
+	int subsampling = gray ? TJSAMP_GRAY : m_subsampling;
+	unsigned long requiredSize = tjBufSize(frame.cols, frame.rows, subsampling);
+	if (requiredSize > m_bufferSize) {
+		//Compressed output buffer is reused across frames of the same size
+		tjFree(m_buffer);
+		m_buffer = tjAlloc(requiredSize);
+		m_bufferSize = m_buffer != nullptr ? requiredSize : 0;
+	}
+	unsigned long jpegSize = m_bufferSize;
+	if (m_handle == nullptr || m_buffer == nullptr || tjCompress2(m_handle,
+				frame.data, frame.cols, static_cast<int>(frame.step), frame.rows,
+				gray ? TJPF_GRAY : TJPF_BGR, &m_buffer, &jpegSize, subsampling,
+				m_quality, TJFLAG_NOREALLOC) != 0) {
+		return QByteArray();
+	}
+	return QByteArray(reinterpret_cast<const char*>(m_buffer), jpegSize);
+#else
+	std::vector<uchar> jpeg;
+	if (!cv::imencode(".jpg", frame, jpeg, {cv::IMWRITE_JPEG_QUALITY, m_quality})) {
+		return QByteArray();
+	}
+	return QByteArray(reinterpret_cast<const char*>(jpeg.data()), jpeg.size());
+#endif
+}
+
+
+JpegEncoderPool::JpegEncoderPool(int numThreads, int queueSize, int quality,
+			const QString &subsampling) : m_queueSize(queueSize),
+			m_quality(quality), m_subsampling(subsampling) {
+	if (numThreads <= 0) {
+		numThreads = QThread::idealThreadCount();
+	}
+	//Own pool so encoders never wait for a free slot behind the decoder runnables
+	m_threadPool.setMaxThreadCount(numThreads);
+	for (int i = 0; i < numThreads; i++) {
+		m_threadPool.start([this]{workerLoop();});
+	}
+}
+
+
+JpegEncoderPool::~JpegEncoderPool() {
+	m_mutex.lock();
+	m_stop = true;
+	m_notEmpty.wakeAll();
+	m_mutex.unlock();
+	m_threadPool.waitForDone();
+}
+
+
+void JpegEncoderPool::encode(const cv::Mat &frame, const QString &path,
+			Batch *batch) {
+	QMutexLocker locker(&m_mutex);
+	while (m_queue.size() >= m_queueSize) {
+		m_notFull.wait(&m_mutex);
+	}
+	if (batch != nullptr) {
+		batch->pending++;
+	}
+	m_queue.enqueue({frame, path, batch});
+	m_notEmpty.wakeOne();
+}
+
+
+void JpegEncoderPool::waitForDone(Batch *batch) {
+	QMutexLocker locker(&m_mutex);
+	if (batch != nullptr) {
+		while (batch->pending != 0) {
+			m_done.wait(&m_mutex);
+		}
+		return;
+	}
+	while (!m_queue.isEmpty() || m_inFlight != 0) {
+		m_done.wait(&m_mutex);
+	}
+}
+
+
+void JpegEncoderPool::workerLoop() {
+	//One encoder per worker, TurboJPEG handles must not be shared
+	JpegEncoder encoder(m_quality, m_subsampling);
+
+	while (true) {
+		EncodeJob job;
+		{
+			QMutexLocker locker(&m_mutex);
+			while (m_queue.isEmpty() && !m_stop) {
+				m_notEmpty.wait(&m_mutex);
+			}
+			if (m_queue.isEmpty()) {
+				break;
+			}
+			job = m_queue.dequeue();
+			m_inFlight++;
+			m_notFull.wakeOne();
+		}
+
+		QByteArray jpeg = encoder.encode(job.frame);
+		QFile file(job.path);
+		bool success = !jpeg.isEmpty() && file.open(QIODevice::WriteOnly) &&
+					file.write(jpeg) == jpeg.size();
+		if (!success) {
+			m_failedCount.fetchAndAddRelaxed(1);
+		}
+
+		QMutexLocker locker(&m_mutex);
+		m_inFlight--;
+		bool batchDone = false;
+		if (job.batch != nullptr) {
+			job.batch->failed += !success;
+			batchDone = --job.batch->pending == 0;
+		}
+		if (batchDone || (m_queue.isEmpty() && m_inFlight == 0)) {
+			m_done.wakeAll();
+		}
+	}
+}
@@ -0,0 +1,79 @@
+/*******************************************************************************
+ * File:			  jpegencoderpool.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef JPEGENCODERPOOL_H
+#define JPEGENCODERPOOL_H
+
+#include "globals.hpp"
+
+#include "opencv2/core/core.hpp"
+
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QAtomicInt>
+
+
+class JpegEncoder {
+	public:
+		explicit JpegEncoder(int quality, const QString &subsampling);
+		~JpegEncoder();
+		QByteArray encode(const cv::Mat &frame);
+
+	private:
+		int m_quality;
+		int m_subsampling = 0;
+		void *m_handle = nullptr;
+		unsigned char *m_buffer = nullptr;
+		unsigned long m_bufferSize = 0;
+};
+
+
+class JpegEncoderPool {
+	public:
+		//Frames of one caller, waited for and checked apart from the frames
+		//other callers encode at the same time
+		struct Batch {
+			int pending = 0;
+			int failed = 0;
+		};
+
+		explicit JpegEncoderPool(int numThreads, int queueSize, int quality,
+					const QString &subsampling);
+		~JpegEncoderPool();
+		void encode(const cv::Mat &frame, const QString &path,
+					Batch *batch = nullptr);
+		void waitForDone(Batch *batch = nullptr);
+		int failedCount() const {return m_failedCount.loadRelaxed();}
+
+	private:
+		struct EncodeJob {
+			cv::Mat frame;
+			QString path;
+			Batch *batch = nullptr;
+		};
+
+		QThreadPool m_threadPool;
+		QMutex m_mutex;
+		QWaitCondition m_notFull;
+		QWaitCondition m_notEmpty;
+		QWaitCondition m_done;
+		QQueue<EncodeJob> m_queue;
+		int m_queueSize;
+		int m_inFlight = 0;
+		bool m_stop = false;
+		int m_quality;
+		QString m_subsampling;
+		QAtomicInt m_failedCount;
+
+		void workerLoop();
+};
+
+#endif
@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * File:			  mjpegpassthrough.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "mjpegpassthrough.hpp"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <cstring>
+
+QMutex MjpegPassthrough::s_cacheMutex;
+QMap<QString, MjpegPassthrough::CachedIndex> MjpegPassthrough::s_cache;
+
+//Many MJPEG cameras leave out the Huffman tables and rely on the standard
+//ones from JPEG Annex K.3, standalone JPEG decoders need them spelled out
+static const unsigned char StandardHuffmanTables[] = {
+	0xff, 0xc4, 0x01, 0xa2,
+	0x00, 0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+	0x07, 0x08, 0x09, 0x0a, 0x0b,
+	0x01, 0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+	0x07, 0x08, 0x09, 0x0a, 0x0b,
+	0x10, 0x00, 0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05, 0x05, 0x04,
+	0x04, 0x00, 0x00, 0x01, 0x7d, 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05,
+	0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14,
+	0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1,
+	0xf0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19,
+	0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38,
+	0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54,
+	0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+	0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84,
+	0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+	0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa,
+	0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4,
+	0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7,
+	0xd8, 0xd9, 0xda, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9,
+	0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+	0x11, 0x00, 0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04,
+	0x04, 0x00, 0x01, 0x02, 0x77, 0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05,
+	0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32,
+	0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52,
+	0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1,
+	0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37,
+	0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53,
+	0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67,
+	0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82,
+	0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95,
+	0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8,
+	0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2,
+	0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5,
+	0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8,
+	0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+};
+
+
+MjpegPassthrough::MjpegPassthrough(const QString &videoPath, int frameCount) {
+	m_index = openIndex(videoPath);
+	if (m_index.isNull() || !isMjpegCodec(m_index->codec())) {
+		return;
+	}
+	//Frame N has to be the Nth index entry, which only holds if the index and
+	//the decoder agree on the length and no frame is an empty duplicate chunk
+	const std::vector<AviFrame> &frames = m_index->frames();
+	if (static_cast<int>(frames.size()) != frameCount) {
+		return;
+	}
+	for (const auto &frame : frames) {
+		if (frame.size <= 0) {
+			return;
+		}
+	}
+	m_file.setFileName(videoPath);
+	m_valid = m_file.open(QIODevice::ReadOnly);
+}
+
+
+bool MjpegPassthrough::writeFrame(int frameIndex, const QString &framePath) {
+	if (!m_valid || frameIndex < 0 ||
+				frameIndex >= static_cast<int>(m_index->frames().size())) {
+		return false;
+	}
+	const AviFrame &frame = m_index->frames()[frameIndex];
+	m_buffer.resize(frame.size);
+	if (!m_file.seek(frame.offset) ||
+				m_file.read(m_buffer.data(), frame.size) != frame.size) {
+		return false;
+	}
+	qint64 scanStart;
+	bool hasHuffmanTables;
+	if (!parseMarkers(m_buffer, scanStart, hasHuffmanTables)) {
+		return false;
+	}
+	QFile output(framePath);
+	if (!output.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	if (hasHuffmanTables) {
+		return output.write(m_buffer) == m_buffer.size();
+	}
+	qint64 tablesSize = sizeof(StandardHuffmanTables);
+	return output.write(m_buffer.constData(), scanStart) == scanStart &&
+				output.write(reinterpret_cast<const char*>(StandardHuffmanTables),
+				tablesSize) == tablesSize &&
+				output.write(m_buffer.constData() + scanStart,
+				m_buffer.size() - scanStart) == m_buffer.size() - scanStart;
+}
+
+
+bool MjpegPassthrough::isMjpegCodec(const QString &codec) {
+	QString fourcc = codec.toUpper();
+	return fourcc == "MJPG" || fourcc == "JPEG" || fourcc == "AVRN" ||
+				fourcc == "DMB1";
+}
+
+
+bool MjpegPassthrough::parseMarkers(const QByteArray &jpeg, qint64 &scanStart,
+			bool &hasHuffmanTables) {
+	const unsigned char *data =
+				reinterpret_cast<const unsigned char*>(jpeg.constData());
+	qint64 size = jpeg.size();
+	if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+		return false;
+	}
+	hasHuffmanTables = false;
+	qint64 position = 2;
+	while (position + 4 <= size) {
+		if (data[position] != 0xFF) {
+			return false;
+		}
+		unsigned char marker = data[position+1];
+		if (marker == 0xFF) {
+			position++;
+			continue;
+		}
+		if (marker == 0xDA) {
+			scanStart = position;
+			return true;
+		}
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+			position += 2;
+			continue;
+		}
+		qint64 length = (data[position+2] << 8) | data[position+3];
+		if (length < 2 || position + 2 + length > size) {
+			return false;
+		}
+		if (marker == 0xC4) {
+			hasHuffmanTables = true;
+		}
+		//AVI1 APP0 with a non zero polarity marks an interlaced frame made of two
+		//fields, which is not a standalone image
+		if (marker == 0xE0 && length >= 7 &&
+					std::memcmp(data + position + 4, "AVI1", 4) == 0 &&
+					data[position+8] != 0) {
+			return false;
+		}
+		position += 2 + length;
+	}
+	return false;
+}
+
+
+QSharedPointer<AviIndex> MjpegPassthrough::openIndex(const QString &videoPath) {
+	//Every extraction chunk of a video shares one parsed index
+	QFileInfo videoInfo(videoPath);
+	qint64 videoSize = videoInfo.size();
+	qint64 videoMTime = videoInfo.lastModified().toMSecsSinceEpoch();
+	QMutexLocker locker(&s_cacheMutex);
+	auto cached = s_cache.constFind(videoInfo.absoluteFilePath());
+	if (cached != s_cache.constEnd() && cached->videoSize == videoSize &&
+				cached->videoMTime == videoMTime) {
+		return cached->index;
+	}
+	QSharedPointer<AviIndex> index(new AviIndex(videoPath));
+	if (!index->isValid()) {
+		index.clear();
+	}
+	s_cache[videoInfo.absoluteFilePath()] = {videoSize, videoMTime, index};
+	return index;
+}
+
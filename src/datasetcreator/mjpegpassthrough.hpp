@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * File:			  mjpegpassthrough.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef MJPEGPASSTHROUGH_H
+#define MJPEGPASSTHROUGH_H
+
+#include "globals.hpp"
+#include "aviindex.hpp"
+
+#include <QFile>
+#include <QMutex>
+#include <QSharedPointer>
+
+
+class MjpegPassthrough {
+	public:
+		explicit MjpegPassthrough(const QString &videoPath, int frameCount);
+		bool isValid() const {return m_valid;}
+		bool writeFrame(int frameIndex, const QString &framePath);
+		static bool isMjpegCodec(const QString &codec);
+
+	private:
+		struct CachedIndex {
+			qint64 videoSize;
+			qint64 videoMTime;
+			QSharedPointer<AviIndex> index;
+		};
+
+		QSharedPointer<AviIndex> m_index;
+		QFile m_file;
+		QByteArray m_buffer;
+		bool m_valid = false;
+
+		static bool parseMarkers(const QByteArray &jpeg, qint64 &scanStart,
+					bool &hasHuffmanTables);
+		static QSharedPointer<AviIndex> openIndex(const QString &videoPath);
+
+		static QMutex s_cacheMutex;
+		static QMap<QString, CachedIndex> s_cache;
+};
+
+#endif
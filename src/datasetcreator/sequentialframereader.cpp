@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * File:			  sequentialframereader.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "sequentialframereader.hpp"
+
+
+SequentialFrameReader::SequentialFrameReader(cv::VideoCapture *cap,
+			int maxGrabForward, const SeekIndex *seekIndex) : m_cap(cap),
+			m_maxGrabForward(maxGrabForward), m_seekIndex(seekIndex) {
+	if (m_seekIndex != nullptr && !m_seekIndex->isValid()) {
+		m_seekIndex = nullptr;
+	}
+}
+
+
+bool SequentialFrameReader::read(int frameIndex, cv::Mat &img) {
+	if (m_seekIndex != nullptr) {
+		//With a keyframe index the exact seek cost is known, seek to the
+		//preceding keyframe only if decoding forward would cross it anyway
+		if (m_seekIndex->needsSeek(frameIndex, m_nextFrame)) {
+			m_seekCount++;
+			m_grabCount += frameIndex - m_seekIndex->keyFrameBefore(frameIndex);
+		}
+		else {
+			m_grabCount += frameIndex - m_nextFrame;
+		}
+		if (!m_seekIndex->seek(m_cap, frameIndex, m_nextFrame) ||
+					!m_cap->grab() || !m_cap->retrieve(img)) {
+			m_nextFrame = -1;
+			return false;
+		}
+		m_nextFrame = frameIndex + 1;
+		return true;
+	}
+
+	//Skipped frames only get grabbed, a seek is only worth it if the gap is
+	//longer than a GOP, otherwise the decoder has to walk the same frames anyway
+	int gap = frameIndex - m_nextFrame;
+	if (m_nextFrame < 0 || gap < 0 || gap > m_maxGrabForward) {
+		m_cap->set(cv::CAP_PROP_POS_FRAMES, frameIndex);
+		m_seekCount++;
+	}
+	else {
+		for (int i = 0; i < gap; i++) {
+			if (!m_cap->grab()) {
+				m_nextFrame = -1;
+				return false;
+			}
+			m_grabCount++;
+		}
+	}
+	if (!m_cap->grab() || !m_cap->retrieve(img)) {
+		m_nextFrame = -1;
+		return false;
+	}
+	m_nextFrame = frameIndex + 1;
+	return true;
+}
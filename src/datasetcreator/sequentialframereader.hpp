@@ -0,0 +1,36 @@
+/*******************************************************************************
+ * File:			  sequentialframereader.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef SEQUENTIALFRAMEREADER_H
+#define SEQUENTIALFRAMEREADER_H
+
+#include "globals.hpp"
+#include "seekindex.hpp"
+
+#include "opencv2/videoio/videoio.hpp"
+
+
+class SequentialFrameReader {
+	public:
+		explicit SequentialFrameReader(cv::VideoCapture *cap, int maxGrabForward,
+					const SeekIndex *seekIndex = nullptr);
+		bool read(int frameIndex, cv::Mat &img);
+		int seekCount() const {return m_seekCount;}
+		int grabCount() const {return m_grabCount;}
+
+	private:
+		cv::VideoCapture *m_cap;
+		int m_maxGrabForward;
+		const SeekIndex *m_seekIndex;
+		int m_nextFrame = 0;
+		int m_seekCount = 0;
+		int m_grabCount = 0;
+};
+
+#endif
@@ -16,34 +16,47 @@
 #include <QDirIterator>
 #include <QThreadPool>
 
+#include <cstring>
+
 
 VideoStreamer::VideoStreamer(const QString &videoPath,
-			QList<TimeLineWindow> timeLineWindows, int numFramesToExtract,
-			int threadNumber) {
-	m_cap = new cv::VideoCapture(videoPath.toStdString());
+			QList<TimeLineWindow> timeLineWindows, int subSamplingRate,
+			int threadNumber, int chunkNumber, DatasetConfig *datasetConfig,
+			const std::atomic<bool> *canceled, cv::Mat featureRows,
+			FeatureCache *featureCache, FrameSpillCache *spillCache) {
+	m_videoPath = videoPath;
 	m_threadNumber = threadNumber;
+	m_chunkNumber = chunkNumber;
 	m_timeLineWindows = timeLineWindows;
-	m_numFramesToExtract = numFramesToExtract;
+	m_subSamplingRate = subSamplingRate;
+	m_featureRows = featureRows;
+	m_canceled = canceled;
+	m_sequentialDecoding = datasetConfig->sequentialDecoding;
+	m_gopLength = datasetConfig->gopLength;
+	m_featureCache = featureCache;
+	if (datasetConfig->useSeekIndex) {
+		m_seekIndex = SeekIndex::open(videoPath);
+	}
+	m_spillCache = spillCache;
+	if (m_spillCache != nullptr) {
+		m_spillEncoder.reset(new JpegEncoder(datasetConfig->jpegQuality,
+					datasetConfig->jpegSubsampling));
+	}
 }
 
 
-void VideoStreamer::run() {
-	bool readFrame = true;
-	int frameCount = 0;
-	int indexCount = 0;
-	int totalFrames = 0;
+int VideoStreamer::computeSubSamplingRate(QList<TimeLineWindow> timeLineWindows,
+			int numFramesToExtract) {
 	int minFrameCount = 0;
 	int subSamplingRate = 10;
-	cv::Mat img,dctImage;
-	for (const auto & window : m_timeLineWindows) {
+	for (const auto & window : timeLineWindows) {
 		int windowSize = window.end-window.start;
-		totalFrames += windowSize;
 		if (minFrameCount == 0 || windowSize < minFrameCount) {
 			minFrameCount = windowSize;
 		}
 	}
 	bool zeroReached = false;
-	while (m_numFramesToExtract * 4 > minFrameCount / subSamplingRate &&
+	while (numFramesToExtract * 4 > minFrameCount / subSamplingRate &&
 				!zeroReached) {
 		subSamplingRate = subSamplingRate/2;
 		if (subSamplingRate == 0) {
@@ -51,34 +64,127 @@ void VideoStreamer::run() {
 			subSamplingRate = 1;
 		}
 	}
+	return subSamplingRate;
+}
+
+
+int VideoStreamer::numSamples(QList<TimeLineWindow> timeLineWindows,
+			int subSamplingRate) {
+	int samples = 0;
+	for (const auto & window : timeLineWindows) {
+		if (window.end > window.start) {
+			samples += (window.end - window.start + subSamplingRate - 1) /
+						subSamplingRate;
+		}
+	}
+	return samples;
+}
+
+
+void VideoStreamer::run() {
+	bool readFrame = true;
+	int frameCount = 0;
+	int indexCount = 0;
+	int subSamplingRate = m_subSamplingRate;
+	int totalSamples = numSamples(m_timeLineWindows, subSamplingRate);
+	cv::Mat img;
 
+	//Opened here instead of the constructor, so jobs waiting in the executor
+	//queue don't each hold a decoder and its buffers
+	m_cap.open(m_videoPath.toStdString());
+	SequentialFrameReader reader(&m_cap, m_gopLength, m_seekIndex.data());
+
+	//Samples are stored at their slot on the sampling grid, so rows of all
+	//cameras line up even if one of them fails to read a frame
+	int windowOffset = 0;
 	for (const auto & window : m_timeLineWindows) {
 		frameCount = window.start;
 		while (frameCount < window.end) {
-			emit dctProgress(indexCount, totalFrames/subSamplingRate, m_threadNumber);
-			m_cap->set(cv::CAP_PROP_POS_FRAMES, frameCount);
-			readFrame = m_cap->read(img);
+			emit dctProgress(indexCount, totalSamples, m_threadNumber, m_chunkNumber);
+			cv::Mat features;
+			if (m_featureCache != nullptr &&
+						m_featureCache->lookup(frameCount, features)) {
+				readFrame = true;
+			}
+			else {
+				if (m_spillCache != nullptr && !m_spillCache->isFull() &&
+							frameCount > 0) {
+					readFrame = decodeAndSpill(reader, frameCount, img);
+				}
+				else {
+					readFrame = decodeFrame(reader, frameCount, img);
+				}
+				m_lastDecoded = readFrame ? frameCount : -1;
+				if (readFrame) {
+					features = m_featureExtractor.compute(img);
+					if (m_featureCache != nullptr) {
+						m_featureCache->insert(frameCount, features);
+					}
+				}
+			}
 			if (readFrame) {
-				cv::resize(img, img, cv::Size(160, 128));
-				cv::cvtColor(img,img, cv::COLOR_BGR2GRAY);
-				img.convertTo(img, CV_32FC1);
-				cv::dct(img/255.0, dctImage);
-				dctImage = dctImage(cv::Rect(0,0,20,16));
-				m_dctImages.append(dctImage);
-				m_frameNumberMap[indexCount++] = frameCount;
+				int slot = windowOffset + (frameCount - window.start) / subSamplingRate;
+				float *row = m_featureRows.ptr<float>(slot);
+				for (int k = 0; k < features.rows; k++) {
+					std::memcpy(row + k*features.cols, features.ptr<float>(k),
+								features.cols*sizeof(float));
+				}
+				m_frameNumberMap[slot] = frameCount;
+				indexCount++;
 				frameCount += subSamplingRate;
 			}
-			if (m_interrupt) {
-				m_cap->release();
+			else if (m_sequentialDecoding) {
+				break;
+			}
+			if (*m_canceled) {
+				m_cap.release();
 				return;
 			}
 		}
+		windowOffset += numSamples({window}, subSamplingRate);
 	}
-	m_cap->release();
-	emit computedDCTs(m_dctImages, m_frameNumberMap, m_threadNumber);
+	m_cap.release();
+	emit computedDCTs(m_frameNumberMap, m_threadNumber, m_chunkNumber);
 }
 
 
-void VideoStreamer::creationCanceledSlot() {
-	m_interrupt = true;
+bool VideoStreamer::decodeFrame(SequentialFrameReader &reader, int frameIndex,
+			cv::Mat &img) {
+	if (m_sequentialDecoding) {
+		return reader.read(frameIndex, img);
+	}
+	else if (m_seekIndex != nullptr && m_seekIndex->isValid()) {
+		return m_seekIndex->seek(&m_cap, frameIndex) && m_cap.read(img);
+	}
+	else {
+		m_cap.set(cv::CAP_PROP_POS_FRAMES, frameIndex);
+		return m_cap.read(img);
+	}
+}
+
+
+bool VideoStreamer::decodeAndSpill(SequentialFrameReader &reader,
+			int frameIndex, cv::Mat &img) {
+	//ImageWriter saves Frame_N.jpg from decoded frame N-1, so that is the frame
+	//that gets spilled for sample N. It is decoded on the way to N anyway.
+	QByteArray jpeg;
+	bool readFrame;
+	if (m_lastDecoded == frameIndex-1) {
+		//Every frame is sampled, img still holds the previous one
+		jpeg = m_spillEncoder->encode(img);
+		readFrame = decodeFrame(reader, frameIndex, img);
+	}
+	else {
+		cv::Mat previous;
+		if (!decodeFrame(reader, frameIndex-1, previous)) {
+			return decodeFrame(reader, frameIndex, img);
+		}
+		jpeg = m_spillEncoder->encode(previous);
+		readFrame = m_sequentialDecoding ? reader.read(frameIndex, img) :
+					m_cap.read(img);
+	}
+	if (readFrame) {
+		m_spillCache->insert(m_videoPath, frameIndex, jpeg);
+	}
+	return readFrame;
 }
@@ -11,12 +11,20 @@
 #define VIDEOSTREAMER_H
 
 #include "globals.hpp"
+#include "dctfeatureextractor.hpp"
+#include "featurecache.hpp"
+#include "framespillcache.hpp"
+#include "jpegencoderpool.hpp"
+#include "sequentialframereader.hpp"
 
 #include "opencv2/videoio/videoio.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/imgcodecs.hpp"
 
 #include <QRunnable>
+#include <QScopedPointer>
+
+#include <atomic>
 
 
 class VideoStreamer : public QObject, public QRunnable {
@@ -24,27 +32,47 @@ class VideoStreamer : public QObject, public QRunnable {
 
 	public:
 		explicit VideoStreamer(const QString &videoPath,
-					QList<TimeLineWindow> timeLineWindows, int numFramesToExtract,
-					int threadNumber);
+					QList<TimeLineWindow> timeLineWindows, int subSamplingRate,
+					int threadNumber, int chunkNumber, DatasetConfig *datasetConfig,
+					const std::atomic<bool> *canceled, cv::Mat featureRows,
+					FeatureCache *featureCache = nullptr,
+					FrameSpillCache *spillCache = nullptr);
 		void run();
+		static int computeSubSamplingRate(QList<TimeLineWindow> timeLineWindows,
+					int numFramesToExtract);
+		static int numSamples(QList<TimeLineWindow> timeLineWindows,
+					int subSamplingRate);
 
 	signals:
-		void computedDCTs(QList<cv::Mat> dctImages, QMap<int,int> frameNumberMap,
-					int threadNumber);
-		void dctProgress(int index, int windowSize, int threadNumber);
-
-	public slots:
-		void creationCanceledSlot();
+		void computedDCTs(QMap<int,int> frameNumberMap, int threadNumber,
+					int chunkNumber);
+		void dctProgress(int index, int windowSize, int threadNumber,
+					int chunkNumber);
 
 	private:
-		QList<cv::Mat> m_dctImages;
+		QString m_videoPath;
+		cv::Mat m_featureRows;
 		std::vector<cv::Mat> *m_buffer;
-		int m_numFramesToExtract;
+		int m_subSamplingRate;
 		int m_threadNumber;
+		int m_chunkNumber;
   	QList<TimeLineWindow>	m_timeLineWindows;
-		cv::VideoCapture *m_cap;
+		cv::VideoCapture m_cap;	//Only open while run() is executing
 		QMap<int,int> m_frameNumberMap;
-		int m_interrupt = false;
+		DCTFeatureExtractor m_featureExtractor;
+		const std::atomic<bool> *m_canceled;
+		bool m_sequentialDecoding;
+		int m_gopLength;
+		FeatureCache *m_featureCache;
+		QSharedPointer<SeekIndex> m_seekIndex;
+		FrameSpillCache *m_spillCache;
+		QScopedPointer<JpegEncoder> m_spillEncoder;
+		int m_lastDecoded = -1;
+
+		bool decodeFrame(SequentialFrameReader &reader, int frameIndex,
+					cv::Mat &img);
+		bool decodeAndSpill(SequentialFrameReader &reader, int frameIndex,
+					cv::Mat &img);
 };
 
 #endif
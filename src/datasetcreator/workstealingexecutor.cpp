@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * File:			  workstealingexecutor.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "workstealingexecutor.hpp"
+
+#include <QThread>
+
+
+WorkStealingExecutor::WorkStealingExecutor(int numThreads) {
+	m_numThreads = (numThreads > 0) ? numThreads : QThread::idealThreadCount();
+	m_threadPool.setMaxThreadCount(m_numThreads);
+	for (int i = 0; i < m_numThreads; i++) {
+		m_queues.push_back(std::make_unique<WorkerQueue>());
+	}
+	//The workers live as long as the executor, so every caller submitting
+	//batches shares the same fixed number of threads
+	for (int i = 0; i < m_numThreads; i++) {
+		m_threadPool.start([this, i]{workerLoop(i);});
+	}
+}
+
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+	m_mutex.lock();
+	m_stop = true;
+	m_jobsQueued.wakeAll();
+	m_mutex.unlock();
+	m_threadPool.waitForDone();
+}
+
+
+void WorkStealingExecutor::run(QList<QRunnable*> jobs) {
+	if (jobs.isEmpty()) {
+		return;
+	}
+	//Every worker gets a contiguous block of jobs, so chunks of the same video
+	//stay together until somebody runs out of work and steals. Consecutive
+	//batches start on different workers.
+	Batch batch;
+	batch.remaining = jobs.size();
+	QMutexLocker locker(&m_mutex);
+	for (int i = 0; i < jobs.size(); i++) {
+		int index = (m_nextQueue + static_cast<int>(static_cast<long long>(i) *
+					m_numThreads / jobs.size())) % m_numThreads;
+		QMutexLocker queueLocker(&m_queues[index]->mutex);
+		m_queues[index]->jobs.push_back({jobs[i], &batch});
+	}
+	m_nextQueue = (m_nextQueue + 1) % m_numThreads;
+	m_queuedJobs += jobs.size();
+	m_jobsQueued.wakeAll();
+	while (batch.remaining > 0) {
+		m_batchDone.wait(&m_mutex);
+	}
+}
+
+
+void WorkStealingExecutor::workerLoop(int index) {
+	while (true) {
+		Job job;
+		if (!takeJob(index, job)) {
+			QMutexLocker locker(&m_mutex);
+			while (m_queuedJobs == 0 && !m_stop) {
+				m_jobsQueued.wait(&m_mutex);
+			}
+			if (m_queuedJobs == 0) {
+				break;
+			}
+			continue;
+		}
+		job.runnable->run();
+		if (job.runnable->autoDelete()) {
+			delete job.runnable;
+		}
+		QMutexLocker locker(&m_mutex);
+		if (--job.batch->remaining == 0) {
+			m_batchDone.wakeAll();
+		}
+	}
+}
+
+
+bool WorkStealingExecutor::takeJob(int index, Job &job) {
+	bool found = false;
+	{
+		QMutexLocker locker(&m_queues[index]->mutex);
+		if (!m_queues[index]->jobs.empty()) {
+			job = m_queues[index]->jobs.front();
+			m_queues[index]->jobs.pop_front();
+			found = true;
+		}
+	}
+	for (int offset = 1; offset < m_numThreads && !found; offset++) {
+		WorkerQueue *victim = m_queues[(index + offset) % m_numThreads].get();
+		QMutexLocker locker(&victim->mutex);
+		if (!victim->jobs.empty()) {
+			job = victim->jobs.back();
+			victim->jobs.pop_back();
+			found = true;
+		}
+	}
+	if (found) {
+		QMutexLocker locker(&m_mutex);
+		m_queuedJobs--;
+	}
+	return found;
+}
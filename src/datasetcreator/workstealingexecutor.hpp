@@ -0,0 +1,60 @@
+/*******************************************************************************
+ * File:			  workstealingexecutor.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef WORKSTEALINGEXECUTOR_H
+#define WORKSTEALINGEXECUTOR_H
+
+#include "globals.hpp"
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+
+class WorkStealingExecutor {
+	public:
+		explicit WorkStealingExecutor(int numThreads = 0);
+		~WorkStealingExecutor();
+		void run(QList<QRunnable*> jobs);
+
+	private:
+		struct Batch {
+			int remaining;
+		};
+
+		struct Job {
+			QRunnable *runnable;
+			Batch *batch;
+		};
+
+		struct WorkerQueue {
+			QMutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		int m_numThreads;
+		std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+		QThreadPool m_threadPool;
+		QMutex m_mutex;
+		QWaitCondition m_jobsQueued;
+		QWaitCondition m_batchDone;
+		int m_queuedJobs = 0;
+		int m_nextQueue = 0;
+		bool m_stop = false;
+
+		void workerLoop(int index);
+		bool takeJob(int index, Job &job);
+};
+
+#endif
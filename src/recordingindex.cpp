@@ -0,0 +1,276 @@
+/*******************************************************************************
+ * File:			  recordingindex.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "recordingindex.hpp"
+
+#include "opencv2/videoio/videoio.hpp"
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QThreadPool>
+
+#include <vector>
+
+static const char *SidecarName = ".recordingindex.json";
+static const int SidecarVersion = 1;
+
+QMutex RecordingIndex::s_cacheMutex;
+QMap<QString, QSharedPointer<RecordingIndex>> RecordingIndex::s_cache;
+
+
+QSharedPointer<RecordingIndex> RecordingIndex::open(
+			const QString &recordingPath, const QList<QString> &validFormats) {
+	//One index per recording and process, rebuilt when a video changed on disk
+	QString key = QFileInfo(recordingPath).absoluteFilePath() + "|" +
+				validFormats.join(",");
+	QMutexLocker locker(&s_cacheMutex);
+	auto cached = s_cache.constFind(key);
+	if (cached != s_cache.constEnd() && cached.value()->isCurrent()) {
+		return cached.value();
+	}
+	QSharedPointer<RecordingIndex> index(new RecordingIndex(recordingPath,
+				validFormats));
+	s_cache[key] = index;
+	return index;
+}
+
+
+RecordingIndex::RecordingIndex(const QString &recordingPath,
+			const QList<QString> &validFormats) :
+			m_recordingPath(recordingPath), m_validFormats(validFormats) {
+	QList<QFileInfo> files = listVideos();
+	QMap<QString, VideoInfo> sidecar = loadSidecar();
+	std::vector<VideoInfo> videos(files.size());
+	bool changed = sidecar.size() != files.size();
+
+	//Only videos that changed since the sidecar was written get opened, all of
+	//them at the same time
+	QThreadPool probePool;
+	for (int i = 0; i < files.size(); i++) {
+		QString path = m_recordingPath + "/" + files[i].fileName();
+		auto entry = sidecar.constFind(files[i].fileName());
+		if (entry != sidecar.constEnd() && entry->opened &&
+					entry->fileSize == files[i].size() &&
+					entry->modificationTime ==
+					files[i].lastModified().toMSecsSinceEpoch()) {
+			videos[i] = entry.value();
+			videos[i].path = path;
+		}
+		else {
+			changed = true;
+			probePool.start([&videos, i, path]() {
+				videos[i] = probeVideo(path);
+			});
+		}
+	}
+	probePool.waitForDone();
+	for (const auto &video : videos) {
+		m_videos.append(video);
+	}
+	if (changed) {
+		saveSidecar();
+	}
+}
+
+
+VideoInfo RecordingIndex::video(const QString &camera) const {
+	for (const auto &video : m_videos) {
+		if (video.camera == camera) {
+			return video;
+		}
+	}
+	return VideoInfo();
+}
+
+
+QList<QString> RecordingIndex::cameraNames() const {
+	QList<QString> cameraNames;
+	for (const auto &video : m_videos) {
+		cameraNames.append(video.camera);
+	}
+	return cameraNames;
+}
+
+
+QString RecordingIndex::videoFormat() const {
+	if (m_videos.isEmpty()) {
+		return "";
+	}
+	for (const auto &video : m_videos) {
+		if (video.format != m_videos[0].format) {
+			return "";
+		}
+	}
+	return m_videos[0].format;
+}
+
+
+int RecordingIndex::frameCount() const {
+	if (m_videos.isEmpty()) {
+		return 0;
+	}
+	return m_videos[0].frameCount;
+}
+
+
+bool RecordingIndex::allOpened() const {
+	for (const auto &video : m_videos) {
+		if (!video.opened) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool RecordingIndex::frameCountsMatch() const {
+	for (const auto &video : m_videos) {
+		if (video.frameCount != m_videos[0].frameCount) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool RecordingIndex::frameRatesMatch() const {
+	for (const auto &video : m_videos) {
+		if (static_cast<int>(video.frameRate) !=
+					static_cast<int>(m_videos[0].frameRate)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool RecordingIndex::isCurrent() const {
+	QList<QFileInfo> files = listVideos();
+	if (files.size() != m_videos.size()) {
+		return false;
+	}
+	for (int i = 0; i < files.size(); i++) {
+		if (m_recordingPath + "/" + files[i].fileName() != m_videos[i].path ||
+					files[i].size() != m_videos[i].fileSize ||
+					files[i].lastModified().toMSecsSinceEpoch() !=
+					m_videos[i].modificationTime) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+VideoInfo RecordingIndex::probeVideo(const QString &videoPath) {
+	VideoInfo info;
+	QFileInfo fileInfo(videoPath);
+	info.path = videoPath;
+	info.camera = fileInfo.fileName().split(".").takeFirst();
+	info.format = fileInfo.fileName().split(".").takeLast();
+	info.fileSize = fileInfo.size();
+	info.modificationTime = fileInfo.lastModified().toMSecsSinceEpoch();
+	cv::VideoCapture cap(videoPath.toStdString());
+	if (!cap.isOpened()) {
+		return info;
+	}
+	info.opened = true;
+	info.frameCount = cap.get(cv::CAP_PROP_FRAME_COUNT);
+	info.frameRate = cap.get(cv::CAP_PROP_FPS);
+	info.width = cap.get(cv::CAP_PROP_FRAME_WIDTH);
+	info.height = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+	int fourcc = static_cast<int>(cap.get(cv::CAP_PROP_FOURCC));
+	for (int i = 0; i < 4; i++) {
+		char c = (fourcc >> 8*i) & 0xFF;
+		if (c != 0) {
+			info.codec.append(QChar(c));
+		}
+	}
+	cap.release();
+	return info;
+}
+
+
+QList<QFileInfo> RecordingIndex::listVideos() const {
+	//Same directory order and filtering as the old per-caller directory scans
+	QList<QFileInfo> files;
+	for (QDirIterator it(m_recordingPath); it.hasNext();) {
+		QString subpath = it.next();
+		QString suffix = subpath.split('/').takeLast();
+		if (suffix != "." && suffix != "..") {
+			if (m_validFormats.contains(suffix.split(".").takeLast())) {
+				files.append(QFileInfo(subpath));
+			}
+		}
+	}
+	return files;
+}
+
+
+QString RecordingIndex::sidecarPath() const {
+	return m_recordingPath + "/" + SidecarName;
+}
+
+
+QMap<QString, VideoInfo> RecordingIndex::loadSidecar() const {
+	QMap<QString, VideoInfo> videos;
+	QFile file(sidecarPath());
+	if (!file.open(QIODevice::ReadOnly)) {
+		return videos;
+	}
+	QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+	if (root["version"].toInt() != SidecarVersion) {
+		return videos;
+	}
+	QJsonObject entries = root["videos"].toObject();
+	for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+		QJsonObject entry = it.value().toObject();
+		VideoInfo info;
+		info.camera = it.key().split(".").takeFirst();
+		info.format = it.key().split(".").takeLast();
+		info.opened = entry["opened"].toBool();
+		info.frameCount = entry["frameCount"].toInt();
+		info.frameRate = entry["frameRate"].toDouble();
+		info.width = entry["width"].toInt();
+		info.height = entry["height"].toInt();
+		info.codec = entry["codec"].toString();
+		info.fileSize = entry["fileSize"].toInteger();
+		info.modificationTime = entry["modificationTime"].toInteger();
+		videos[it.key()] = info;
+	}
+	return videos;
+}
+
+
+void RecordingIndex::saveSidecar() const {
+	QJsonObject entries;
+	for (const auto &video : m_videos) {
+		QJsonObject entry;
+		entry["opened"] = video.opened;
+		entry["frameCount"] = video.frameCount;
+		entry["frameRate"] = video.frameRate;
+		entry["width"] = video.width;
+		entry["height"] = video.height;
+		entry["codec"] = video.codec;
+		entry["fileSize"] = video.fileSize;
+		entry["modificationTime"] = video.modificationTime;
+		entries[QFileInfo(video.path).fileName()] = entry;
+	}
+	QJsonObject root;
+	root["version"] = SidecarVersion;
+	root["videos"] = entries;
+	//Recordings may live on read only storage, the index then just stays in memory
+	QSaveFile file(sidecarPath());
+	if (file.open(QIODevice::WriteOnly)) {
+		file.write(QJsonDocument(root).toJson());
+		file.commit();
+	}
+}
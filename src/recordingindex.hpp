@@ -0,0 +1,68 @@
+/*******************************************************************************
+ * File:			  recordingindex.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef RECORDINGINDEX_H
+#define RECORDINGINDEX_H
+
+#include "globals.hpp"
+
+#include <QFileInfo>
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+
+
+struct VideoInfo {
+	QString camera;
+	QString path;
+	QString format;
+	bool opened = false;
+	int frameCount = 0;
+	double frameRate = 0.0;
+	int width = 0;
+	int height = 0;
+	QString codec;
+	qint64 fileSize = 0;
+	qint64 modificationTime = 0;
+};
+
+
+class RecordingIndex {
+	public:
+		static QSharedPointer<RecordingIndex> open(const QString &recordingPath,
+					const QList<QString> &validFormats);
+		explicit RecordingIndex(const QString &recordingPath,
+					const QList<QString> &validFormats);
+		const QString &recordingPath() const {return m_recordingPath;}
+		QList<VideoInfo> videos() const {return m_videos;}
+		VideoInfo video(const QString &camera) const;
+		QList<QString> cameraNames() const;
+		QString videoFormat() const;
+		int frameCount() const;
+		bool allOpened() const;
+		bool frameCountsMatch() const;
+		bool frameRatesMatch() const;
+		bool isCurrent() const;
+		static VideoInfo probeVideo(const QString &videoPath);
+
+	private:
+		QString m_recordingPath;
+		QList<QString> m_validFormats;
+		QList<VideoInfo> m_videos;
+
+		QList<QFileInfo> listVideos() const;
+		QString sidecarPath() const;
+		QMap<QString, VideoInfo> loadSidecar() const;
+		void saveSidecar() const;
+
+		static QMutex s_cacheMutex;
+		static QMap<QString, QSharedPointer<RecordingIndex>> s_cache;
+};
+
+#endif
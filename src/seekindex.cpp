@@ -0,0 +1,395 @@
+/*******************************************************************************
+ * File:			  seekindex.cpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#include "seekindex.hpp"
+#include "aviindex.hpp"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+static const char IndexMagic[4] = {'J','S','K','I'};
+static const qint32 IndexVersion = 2;
+
+QMutex SeekIndex::s_cacheMutex;
+QMap<QString, QSharedPointer<SeekIndex>> SeekIndex::s_cache;
+
+
+struct BoxRange {
+	qint64 begin;	//Content, behind the box header
+	qint64 end;
+};
+
+
+static quint32 be32(const QByteArray &data, qint64 position) {
+	return qFromBigEndian<quint32>(data.constData() + position);
+}
+
+
+static QList<BoxRange> childBoxes(const QByteArray &data, BoxRange parent,
+			const char *type) {
+	QList<BoxRange> boxes;
+	qint64 position = parent.begin;
+	while (position + 8 <= parent.end) {
+		qint64 size = be32(data, position);
+		qint64 headerSize = 8;
+		if (size == 1) {
+			if (position + 16 > parent.end) {
+				break;
+			}
+			size = qFromBigEndian<quint64>(data.constData() + position + 8);
+			headerSize = 16;
+		}
+		else if (size == 0) {
+			size = parent.end - position;
+		}
+		if (size < headerSize || position + size > parent.end) {
+			break;
+		}
+		if (std::memcmp(data.constData() + position + 4, type, 4) == 0) {
+			boxes.append({position + headerSize, position + size});
+		}
+		position += size;
+	}
+	return boxes;
+}
+
+
+static bool childBox(const QByteArray &data, BoxRange parent, const char *type,
+			BoxRange &child) {
+	QList<BoxRange> boxes = childBoxes(data, parent, type);
+	if (boxes.isEmpty()) {
+		return false;
+	}
+	child = boxes[0];
+	return true;
+}
+
+
+static bool readMoov(const QString &videoPath, QByteArray &moov) {
+	//moov may sit behind mdat, so walk the top level box headers only
+	QFile file(videoPath);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	qint64 position = 0;
+	while (position + 8 <= file.size()) {
+		char header[16];
+		if (!file.seek(position) || file.read(header, 8) != 8) {
+			return false;
+		}
+		qint64 size = qFromBigEndian<quint32>(header);
+		qint64 headerSize = 8;
+		if (size == 1) {
+			if (file.read(header + 8, 8) != 8) {
+				return false;
+			}
+			size = qFromBigEndian<quint64>(header + 8);
+			headerSize = 16;
+		}
+		else if (size == 0) {
+			size = file.size() - position;
+		}
+		if (size < headerSize) {
+			return false;
+		}
+		if (std::memcmp(header + 4, "moov", 4) == 0) {
+			file.seek(position + headerSize);
+			moov = file.read(size - headerSize);
+			return moov.size() == size - headerSize;
+		}
+		position += size;
+	}
+	return false;
+}
+
+
+QSharedPointer<SeekIndex> SeekIndex::open(const QString &videoPath) {
+	QString key = QFileInfo(videoPath).absoluteFilePath();
+	QMutexLocker locker(&s_cacheMutex);
+	auto cached = s_cache.constFind(key);
+	if (cached != s_cache.constEnd() && cached.value()->isCurrent()) {
+		return cached.value();
+	}
+	QSharedPointer<SeekIndex> index(new SeekIndex(videoPath));
+	s_cache[key] = index;
+	return index;
+}
+
+
+SeekIndex::SeekIndex(const QString &videoPath) : m_videoPath(videoPath) {
+	QFileInfo videoInfo(videoPath);
+	m_videoSize = videoInfo.size();
+	m_videoMTime = videoInfo.lastModified().toMSecsSinceEpoch();
+	//Indices live in the cache dir only, recordings are often on read only
+	//storage and calibration videos should not collect extra files
+	if (!load(cachePath()) && build()) {
+		save(cachePath());
+	}
+}
+
+
+int SeekIndex::keyFrameBefore(int frameIndex) const {
+	if (m_keyFrames.empty()) {
+		return frameIndex;
+	}
+	auto it = std::upper_bound(m_keyFrames.begin(), m_keyFrames.end(),
+				frameIndex);
+	if (it == m_keyFrames.begin()) {
+		return 0;
+	}
+	return *(it - 1);
+}
+
+
+std::vector<int> SeekIndex::keyFrames(int begin, int end) const {
+	std::vector<int> keyFrames;
+	auto it = std::lower_bound(m_keyFrames.begin(), m_keyFrames.end(), begin);
+	for (; it != m_keyFrames.end() && *it < end; ++it) {
+		keyFrames.push_back(*it);
+	}
+	return keyFrames;
+}
+
+
+bool SeekIndex::needsSeek(int frameIndex, int currentFrame) const {
+	//Decoding forward from the current position is never slower than a seek,
+	//unless there is a keyframe between the two
+	if (currentFrame < 0 || frameIndex < currentFrame) {
+		return true;
+	}
+	return keyFrameBefore(frameIndex) > currentFrame;
+}
+
+
+bool SeekIndex::seek(cv::VideoCapture *cap, int frameIndex,
+			int currentFrame) const {
+	int position = currentFrame;
+	if (needsSeek(frameIndex, currentFrame)) {
+		position = keyFrameBefore(frameIndex);
+		//Backends that can't land on the keyframe exactly (e.g. timestamp based
+		//seeking in files with B-frames) get the target frame set directly
+		if (!cap->set(cv::CAP_PROP_POS_FRAMES, position) ||
+					static_cast<int>(cap->get(cv::CAP_PROP_POS_FRAMES)) != position) {
+			return cap->set(cv::CAP_PROP_POS_FRAMES, frameIndex) &&
+						static_cast<int>(cap->get(cv::CAP_PROP_POS_FRAMES)) == frameIndex;
+		}
+	}
+	for (; position < frameIndex; position++) {
+		if (!cap->grab()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool SeekIndex::isCurrent() const {
+	QFileInfo videoInfo(m_videoPath);
+	return videoInfo.size() == m_videoSize &&
+				videoInfo.lastModified().toMSecsSinceEpoch() == m_videoMTime;
+}
+
+
+bool SeekIndex::build() {
+	return buildFromAvi() || buildFromMp4();
+}
+
+
+bool SeekIndex::buildFromAvi() {
+	//AVI has no frame reordering, only keyframe flags are needed
+	AviIndex aviIndex(m_videoPath);
+	if (!aviIndex.isValid()) {
+		return false;
+	}
+	const std::vector<AviFrame> &frames = aviIndex.frames();
+	m_keyFrames.clear();
+	for (size_t i = 0; i < frames.size(); i++) {
+		if (frames[i].keyFrame) {
+			m_keyFrames.push_back(i);
+		}
+	}
+	if (m_keyFrames.empty()) {
+		return false;
+	}
+	m_frameCount = frames.size();
+	return true;
+}
+
+
+bool SeekIndex::buildFromMp4() {
+	QByteArray moov;
+	if (!readMoov(m_videoPath, moov)) {
+		return false;
+	}
+	BoxRange stbl;
+	bool found = false;
+	for (const auto &trak : childBoxes(moov, {0, moov.size()}, "trak")) {
+		BoxRange mdia, hdlr, minf;
+		if (childBox(moov, trak, "mdia", mdia) &&
+					childBox(moov, mdia, "hdlr", hdlr) && hdlr.end - hdlr.begin >= 12 &&
+					std::memcmp(moov.constData() + hdlr.begin + 8, "vide", 4) == 0 &&
+					childBox(moov, mdia, "minf", minf) &&
+					childBox(moov, minf, "stbl", stbl)) {
+			found = true;
+			break;
+		}
+	}
+	if (!found) {
+		return false;
+	}
+
+	BoxRange stsz, stts, ctts, stss;
+	if ((!childBox(moov, stbl, "stsz", stsz) && !childBox(moov, stbl, "stz2", stsz)) ||
+				stsz.end - stsz.begin < 12 || !childBox(moov, stbl, "stts", stts)) {
+		return false;
+	}
+	int numSamples = be32(moov, stsz.begin + 8);
+	if (numSamples <= 0) {
+		return false;
+	}
+
+	//Decode timestamps from stts, composition offsets from ctts
+	std::vector<qint64> compositionTimes(numSamples, 0);
+	qint64 time = 0;
+	int sample = 0;
+	quint32 numEntries = be32(moov, stts.begin + 4);
+	for (quint32 i = 0; i < numEntries && stts.begin + 16 + i*8 <= stts.end; i++) {
+		quint32 count = be32(moov, stts.begin + 8 + i*8);
+		quint32 delta = be32(moov, stts.begin + 12 + i*8);
+		for (quint32 j = 0; j < count && sample < numSamples; j++) {
+			compositionTimes[sample++] = time;
+			time += delta;
+		}
+	}
+	for (; sample < numSamples; sample++) {
+		compositionTimes[sample] = time;
+	}
+	bool reordered = false;
+	if (childBox(moov, stbl, "ctts", ctts)) {
+		sample = 0;
+		numEntries = be32(moov, ctts.begin + 4);
+		for (quint32 i = 0; i < numEntries && ctts.begin + 16 + i*8 <= ctts.end; i++) {
+			quint32 count = be32(moov, ctts.begin + 8 + i*8);
+			qint32 offset = static_cast<qint32>(be32(moov, ctts.begin + 12 + i*8));
+			for (quint32 j = 0; j < count && sample < numSamples; j++) {
+				compositionTimes[sample++] += offset;
+			}
+		}
+		reordered = true;
+	}
+
+	std::vector<qint32> decodeOrder(numSamples);
+	std::iota(decodeOrder.begin(), decodeOrder.end(), 0);
+	if (reordered) {
+		std::stable_sort(decodeOrder.begin(), decodeOrder.end(),
+					[&compositionTimes](qint32 a, qint32 b) {
+			return compositionTimes[a] < compositionTimes[b];
+		});
+	}
+	//stss refers to samples in decode order, keyframes are kept in
+	//presentation order to match CAP_PROP_POS_FRAMES
+	std::vector<qint32> presentationIndex(numSamples);
+	for (int i = 0; i < numSamples; i++) {
+		presentationIndex[decodeOrder[i]] = i;
+	}
+
+	//Without stss every sample is a sync sample
+	m_keyFrames.clear();
+	if (childBox(moov, stbl, "stss", stss)) {
+		numEntries = be32(moov, stss.begin + 4);
+		for (quint32 i = 0; i < numEntries && stss.begin + 12 + i*4 <= stss.end; i++) {
+			int sampleNumber = be32(moov, stss.begin + 8 + i*4);
+			if (sampleNumber >= 1 && sampleNumber <= numSamples) {
+				m_keyFrames.push_back(presentationIndex[sampleNumber-1]);
+			}
+		}
+		std::sort(m_keyFrames.begin(), m_keyFrames.end());
+	}
+	else {
+		m_keyFrames.resize(numSamples);
+		std::iota(m_keyFrames.begin(), m_keyFrames.end(), 0);
+	}
+	if (m_keyFrames.empty()) {
+		return false;
+	}
+	m_frameCount = numSamples;
+	return true;
+}
+
+
+bool SeekIndex::load(const QString &indexPath) {
+	QFile file(indexPath);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	Header header;
+	if (file.read(reinterpret_cast<char*>(&header), sizeof(Header)) !=
+				sizeof(Header)) {
+		return false;
+	}
+	//Counts are checked against the file size before anything is allocated
+	qint64 payloadSize = file.size() - static_cast<qint64>(sizeof(Header));
+	if (std::memcmp(header.magic, IndexMagic, 4) != 0 ||
+				header.version != IndexVersion || header.videoSize != m_videoSize ||
+				header.videoMTime != m_videoMTime || header.frameCount <= 0 ||
+				header.frameCount > std::numeric_limits<qint32>::max() ||
+				header.keyFrameCount <= 0 || header.keyFrameCount > header.frameCount ||
+				header.keyFrameCount != payloadSize/4 || payloadSize%4 != 0) {
+		return false;
+	}
+	std::vector<qint32> keyFrames(header.keyFrameCount);
+	qint64 keyFramesSize = keyFrames.size()*sizeof(qint32);
+	if (file.read(reinterpret_cast<char*>(keyFrames.data()), keyFramesSize) !=
+				keyFramesSize || !std::is_sorted(keyFrames.begin(), keyFrames.end()) ||
+				keyFrames.front() < 0 || keyFrames.back() >= header.frameCount) {
+		return false;
+	}
+	m_keyFrames = keyFrames;
+	m_frameCount = header.frameCount;
+	return true;
+}
+
+
+bool SeekIndex::save(const QString &indexPath) const {
+	Header header;
+	std::memcpy(header.magic, IndexMagic, 4);
+	header.version = IndexVersion;
+	header.videoSize = m_videoSize;
+	header.videoMTime = m_videoMTime;
+	header.frameCount = m_frameCount;
+	header.keyFrameCount = m_keyFrames.size();
+	QDir().mkpath(QFileInfo(indexPath).absolutePath());
+	QSaveFile file(indexPath);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	file.write(reinterpret_cast<const char*>(m_keyFrames.data()),
+				m_keyFrames.size()*sizeof(qint32));
+	return file.commit();
+}
+
+
+QString SeekIndex::cachePath() const {
+	QString key = QCryptographicHash::hash(
+				QFileInfo(m_videoPath).absoluteFilePath().toUtf8(),
+				QCryptographicHash::Sha1).toHex();
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+				"/seekindex/" + key + ".seekidx";
+}
@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * File:			  seekindex.hpp
+ * Created: 	  17. October 2026
+ * Author:		  Timo Hueser
+ * Contact: 	  timo.hueser@gmail.com
+ * Copyright:   2022 Timo Hueser
+ * License:     LGPL v2.1
+ ******************************************************************************/
+
+#ifndef SEEKINDEX_H
+#define SEEKINDEX_H
+
+#include "globals.hpp"
+
+#include "opencv2/videoio/videoio.hpp"
+
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+
+#include <vector>
+
+
+class SeekIndex {
+	public:
+		static QSharedPointer<SeekIndex> open(const QString &videoPath);
+		explicit SeekIndex(const QString &videoPath);
+		bool isValid() const {return m_frameCount > 0;}
+		int frameCount() const {return m_frameCount;}
+		int keyFrameBefore(int frameIndex) const;
+		std::vector<int> keyFrames(int begin, int end) const;
+		bool needsSeek(int frameIndex, int currentFrame) const;
+		bool seek(cv::VideoCapture *cap, int frameIndex,
+					int currentFrame = -1) const;
+		bool isCurrent() const;
+
+	private:
+		struct Header {
+			char magic[4];
+			qint32 version;
+			qint64 videoSize;
+			qint64 videoMTime;
+			qint64 frameCount;
+			qint64 keyFrameCount;
+		};
+
+		QString m_videoPath;
+		qint64 m_videoSize = 0;
+		qint64 m_videoMTime = 0;
+		int m_frameCount = 0;
+		std::vector<qint32> m_keyFrames;	//Presentation indices, sorted
+
+		bool build();
+		bool buildFromAvi();
+		bool buildFromMp4();
+		bool load(const QString &indexPath);
+		bool save(const QString &indexPath) const;
+		QString cachePath() const;
+
+		static QMutex s_cacheMutex;
+		static QMap<QString, QSharedPointer<SeekIndex>> s_cache;
+};
+
+#endif